@@ -0,0 +1,101 @@
+"""Benchmark the nearest neighbors structure of the RRT family of planners.
+
+Plans the same random queries for the panda arm among boxes with
+OMPLPlanner.set_linear_nearest_neighbors(True) (LinearNearestNeighbors) and
+(False) (OMPL's default GNAT), and reports planning times and success rates.
+Run from the root of the repository after installing mplib:
+
+    python3 dev/benchmark_nearest_neighbors.py --planner RRT --queries 50
+"""
+
+import time
+from argparse import ArgumentParser
+
+import numpy as np
+
+from mplib import Planner
+from mplib.pymp import perf_counters
+from mplib.pymp.fcl import Box, CollisionObject
+from mplib.pymp.perf_counters import PerfCounter
+
+PANDA_SPEC = {
+    "urdf": "data/panda/panda.urdf",
+    "srdf": "data/panda/panda.srdf",
+    "user_link_names": [f"panda_link{i}" for i in range(9)]
+    + ["panda_hand", "panda_leftfinger", "panda_rightfinger"],
+    "user_joint_names": [f"panda_joint{i}" for i in range(1, 8)]
+    + ["panda_finger_joint1", "panda_finger_joint2"],
+    "move_group": "panda_hand",
+    "joint_vel_limits": np.ones(7),
+    "joint_acc_limits": np.ones(7),
+}
+
+# Box obstacles (size, position) around the arm
+BOXES = [
+    ([0.4, 0.4, 0.1], [0.5, 0.0, 0.3]),
+    ([0.1, 0.6, 0.6], [0.0, 0.5, 0.3]),
+    ([0.1, 0.6, 0.6], [0.0, -0.5, 0.3]),
+    ([0.6, 0.1, 0.3], [-0.4, 0.0, 0.6]),
+]
+
+
+def sample_valid_states(planner, rng, count):
+    """Samples collision-free move group states within the joint limits"""
+    world = planner.planning_world
+    limits = planner.joint_limits[planner.move_group_joint_indices]
+    states = []
+    while len(states) < count:
+        state = rng.uniform(limits[:, 0], limits[:, 1])
+        world.set_qpos_all(state)
+        if not world.collide():
+            states.append(state)
+    return states
+
+
+def main():
+    parser = ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--planner", default="RRTConnect", choices=["RRTConnect", "RRT"])
+    parser.add_argument("--queries", type=int, default=50)
+    parser.add_argument("--time", type=float, default=5.0, help="time limit per query")
+    parser.add_argument("--range", type=float, default=0.1)
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+
+    planner = Planner(**PANDA_SPEC)
+    for i, (size, position) in enumerate(BOXES):
+        planner.planning_world.add_normal_object(
+            f"box{i}", CollisionObject(Box(size), position)
+        )
+    rng = np.random.default_rng(args.seed)
+    states = sample_valid_states(planner, rng, 2 * args.queries)
+    queries = list(zip(states[::2], states[1::2]))
+
+    perf_counters.set_enabled(True)
+    results = {True: [], False: []}  # (success, seconds, states checked) per query
+    for start, goal in queries:
+        # Alternate the settings per query so that both see the same conditions
+        for linear in [True, False]:
+            planner.planner.set_linear_nearest_neighbors(linear)
+            begin = time.perf_counter()
+            status, _ = planner.planner.plan(
+                start, [goal], args.planner, time=args.time, range=args.range
+            )
+            seconds = time.perf_counter() - begin
+            checks = planner.planner.get_last_plan_counts().get_count(
+                PerfCounter.STATE_VALIDITY_CHECK
+            )
+            results[linear].append((status == "Exact solution", seconds, checks))
+
+    print(f"{args.planner}, {args.queries} queries, time limit {args.time} s")
+    print(f"{'nearest neighbors':<20}{'success':>10}{'mean s':>10}{'median s':>10}"
+          f"{'checks/s':>12}")
+    for linear, name in [(True, "linear"), (False, "GNAT")]:
+        success, seconds, checks = map(np.array, zip(*results[linear]))
+        # Times of the queries solved with both settings, for a fair comparison
+        both = np.array([a[0] and b[0] for a, b in zip(results[True], results[False])])
+        print(f"{name:<20}{success.mean():>10.0%}{seconds[both].mean():>10.4f}"
+              f"{np.median(seconds[both]):>10.4f}{checks.sum() / seconds.sum():>12.0f}")
+
+
+if __name__ == "__main__":
+    main()
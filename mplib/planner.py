@@ -7,7 +7,7 @@ import toppra.algorithm as algo
 import toppra.constraint as constraint
 from transforms3d.quaternions import quat2mat
 
-from .pymp import articulation, ompl, planning_world
+from .pymp import articulation, ompl, perf_counters, planning_world, trace
 
 
 class Planner:
@@ -90,6 +90,8 @@ class Planner:
         self.joint_types = self.pinocchio_model.get_joint_types()
         self.joint_limits = np.concatenate(self.pinocchio_model.get_joint_limits())
         self.planner = ompl.OMPLPlanner(world=self.planning_world)
+        self.replanning_session = ompl.ReplanningSession(self.planner)
+        self.replan_cache = None  # goal pose and IK goals of replan()
         self.joint_vel_limits = joint_vel_limits
         self.joint_acc_limits = joint_acc_limits
         self.move_group_link_id = self.link_name_2_idx[self.move_group]
@@ -299,7 +301,7 @@ class Planner:
             if success:
                 # check collision
                 self.planning_world.set_qpos_all(ik_qpos[move_joint_idx])
-                if len(self.planning_world.collide_full()) > 0:
+                if self.planning_world.collide():
                     success = False
 
             if success:
@@ -433,6 +435,7 @@ class Planner:
         :param goal_pose: goal pose (xyz, wxyz), (7,) np.floating np.ndarray.
         :param current_qpos: current qpos, (ndof,) np.floating np.ndarray.
         :param mask: qpos mask to disable planning, (ndof,) bool np.ndarray.
+                     Masked joints stay at their current qpos.
         :param planner_name: name of planner to use. ["RRTConnect", "PRMstar",
                              "LazyPRMstar", "RRTstar", "RRTsharp", "RRTXstatic",
                              "InformedRRTstar"]
@@ -462,6 +465,8 @@ class Planner:
                         * acceleration: qacc of each waypoint, (n_step, ndof) np.float64
                         * duration: optimal duration of the generated path, np.float64
                         Note that ndof is n_active_dof
+                        If perf_counters are enabled and the planner ran:
+                        * perf_counts: perf_counters.PerfCounts of the planner call
         """
         if fix_joint_limits:
             current_qpos = np.clip(
@@ -476,7 +481,8 @@ class Planner:
                 print(f"{collision.link_name1} and {collision.link_name2} collide!")
 
         move_joint_idx = self.move_group_joint_indices
-        ik_status, goal_qpos = self.IK(goal_pose, current_qpos, mask)
+        with trace.Span("ik"):
+            ik_status, goal_qpos = self.IK(goal_pose, current_qpos, mask)
         if ik_status != "Success":
             return {"status": ik_status}
 
@@ -490,6 +496,7 @@ class Planner:
             goal_qpos_.append(goal_qpos[i][move_joint_idx])
         self.robot.set_qpos(current_qpos, True)
 
+        fixed_joints = np.asarray(mask, dtype=bool)[move_joint_idx] if len(mask) else []
         status, path = self.planner.plan(
             current_qpos[move_joint_idx],
             goal_qpos_,
@@ -500,7 +507,11 @@ class Planner:
             pathlen_obj_weight=pathlen_obj_weight,
             pathlen_obj_only=pathlen_obj_only,
             verbose=verbose,
+            fixed_joints=fixed_joints,
         )
+        stats = {}
+        if perf_counters.is_enabled():
+            stats["perf_counts"] = self.planner.get_last_plan_counts()
 
         if status == "Exact solution":
             if verbose:
@@ -508,7 +519,8 @@ class Planner:
             else:
                 ta.setup_logging("WARNING")
 
-            times, pos, vel, acc, duration = self.TOPP(path, time_step)
+            with trace.Span("topp"):
+                times, pos, vel, acc, duration = self.TOPP(path, time_step)
             return {
                 "status": "Success",
                 "time": times,
@@ -516,13 +528,179 @@ class Planner:
                 "velocity": vel,
                 "acceleration": acc,
                 "duration": duration,
+                **stats,
             }
         else:
             return {
                 "status": f"{planner_name} failed. {status}",
                 "path": path,
+                **stats,
             }
 
+    def plan_batch(
+        self,
+        goal_poses: Sequence[np.ndarray],
+        current_qpos: np.ndarray,
+        *,
+        planner_name: str = "RRTConnect",
+        time_step: float = 0.1,
+        rrt_range: float = 0.1,
+        rrt_goal_bias: float = 0.05,
+        planning_time: float = 1,
+        pathlen_obj_weight: float = 10.0,
+        pathlen_obj_only: bool = False,
+        fix_joint_limits: bool = True,
+        num_threads: int = 0,
+        verbose: bool = False,
+    ) -> list[dict[str, str | np.ndarray | np.float64]]:
+        """Plan paths to many goal poses (e.g., candidate grasps) in parallel.
+        IK of each goal pose is solved as in plan(), then the queries are planned
+        by num_threads workers (see OMPLPlanner.plan_batch()).
+
+        :param goal_poses: goal poses (xyz, wxyz), each (7,) np.floating np.ndarray.
+        :param current_qpos: current qpos, (ndof,) np.floating np.ndarray.
+        :param num_threads: number of planning threads, 0 to use all hardware
+                            threads.
+        :param verbose: whether to display some internal outputs.
+        :return results: one dictionary per goal pose, with the keys of plan()
+                         and if planned:
+                         * planning_time: planner wall-clock time in seconds
+                         * path_length: joint-space length of the planned path
+                         * perf_counts: perf_counters.PerfCounts of the query, if
+                           perf_counters are enabled
+        Other parameters are the same as in plan().
+        """
+        if fix_joint_limits:
+            current_qpos = np.clip(
+                current_qpos, self.joint_limits[:, 0], self.joint_limits[:, 1]
+            )
+
+        move_joint_idx = self.move_group_joint_indices
+        results = [{} for _ in goal_poses]
+        queries, goal_sets = [], []
+        for i, goal_pose in enumerate(goal_poses):
+            ik_status, goal_qpos = self.IK(goal_pose, current_qpos)
+            if ik_status != "Success":
+                results[i]["status"] = ik_status
+                continue
+            queries.append(i)
+            goal_sets.append([q[move_joint_idx] for q in goal_qpos])
+        self.robot.set_qpos(current_qpos, True)
+        if len(queries) == 0:
+            return results
+
+        options = ompl.BatchPlanOptions()
+        options.planner_name = planner_name
+        options.time = planning_time
+        options.range = rrt_range
+        options.goal_bias = rrt_goal_bias
+        options.pathlen_obj_weight = pathlen_obj_weight
+        options.pathlen_obj_only = pathlen_obj_only
+        options.num_threads = num_threads
+        batch = self.planner.plan_batch(
+            [current_qpos[move_joint_idx]], goal_sets, options
+        )
+
+        ta.setup_logging("INFO" if verbose else "WARNING")
+        for i, result in zip(queries, batch):
+            stats = {
+                "planning_time": result.planning_time,
+                "path_length": result.path_length,
+            }
+            if perf_counters.is_enabled():
+                stats["perf_counts"] = result.perf_counts
+            if not result.success:
+                results[i] = {
+                    "status": f"{planner_name} failed. {result.status}",
+                    "path": result.path,
+                    **stats,
+                }
+                continue
+            times, pos, vel, acc, duration = self.TOPP(result.path, time_step)
+            results[i] = {
+                "status": "Success",
+                "time": times,
+                "position": pos,
+                "velocity": vel,
+                "acceleration": acc,
+                "duration": duration,
+                **stats,
+            }
+        return results
+
+    def replan(
+        self,
+        goal_pose: np.ndarray,
+        current_qpos: np.ndarray,
+        *,
+        deadline: float = 0.02,
+        planner_name: str = "RRTConnect",
+        time_step: float = 0.1,
+        rrt_range: float = 0.1,
+        fix_joint_limits: bool = True,
+        verbose: bool = False,
+    ) -> dict[str, str | np.ndarray | np.float64]:
+        """Plan path to goal_pose like plan(), reusing the previous solution.
+        Meant to be called repeatedly (e.g., at 10 Hz) while the scene changes.
+        IK solutions are kept while goal_pose does not change, and the previous path
+        is kept and only repaired where the scene makes it invalid (see
+        ompl.ReplanningSession). The remaining path from current_qpos is time
+        parameterized again on every call, so the trajectory starts at current_qpos.
+
+        :param goal_pose: goal pose (xyz, wxyz), (7,) np.floating np.ndarray.
+        :param current_qpos: current qpos, (ndof,) np.floating np.ndarray.
+        :param deadline: planning time limit in seconds, shared by all repairs.
+                         IK (when goal_pose changes) and time parameterization
+                         are not included.
+        :return result: A dictionary with the keys of plan() and mode
+                        (ompl.ReplanMode) if successful.
+        Other parameters are the same as in plan().
+        """
+        if fix_joint_limits:
+            current_qpos = np.clip(
+                current_qpos, self.joint_limits[:, 0], self.joint_limits[:, 1]
+            )
+
+        move_joint_idx = self.move_group_joint_indices
+        cache = self.replan_cache
+        if cache is None or not np.allclose(cache["goal_pose"], goal_pose):
+            ik_status, goal_qpos = self.IK(goal_pose, current_qpos)
+            self.robot.set_qpos(current_qpos, True)
+            if ik_status != "Success":
+                self.replan_cache = None
+                return {"status": ik_status}
+            cache = self.replan_cache = {
+                "goal_pose": np.array(goal_pose),
+                "goal_qpos": [q[move_joint_idx] for q in goal_qpos],
+            }
+
+        result = self.replanning_session.replan(
+            current_qpos[move_joint_idx],
+            cache["goal_qpos"],
+            deadline,
+            planner_name=planner_name,
+            range=rrt_range,
+        )
+        self.robot.set_qpos(current_qpos, True)
+        if result.status != "Exact solution":
+            return {
+                "status": f"{planner_name} failed. {result.status}",
+                "path": result.path,
+            }
+
+        # result.path starts at current_qpos even when the previous path is reused
+        ta.setup_logging("INFO" if verbose else "WARNING")
+        times, pos, vel, acc, duration = self.TOPP(result.path, time_step)
+        return {
+            "status": "Success",
+            "time": times,
+            "position": pos,
+            "velocity": vel,
+            "acceleration": acc,
+            "duration": duration,
+            "mode": result.mode,
+        }
+
     def plan_screw(
         self,
         goal_pose: np.ndarray,
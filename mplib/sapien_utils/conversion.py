@@ -18,6 +18,7 @@ from sapien.physx import (
     PhysxRigidBaseComponent,
 )
 from transforms3d.euler import euler2quat
+from transforms3d.quaternions import mat2quat
 
 from ..planner import Planner
 from ..pymp.articulation import ArticulatedModel
@@ -55,6 +56,10 @@ class SapienPlanningWorld(PlanningWorld):
         super().__init__([], [])
         self._sim_scene = sim_scene
         self._multi_shapes_objs = {}  # FIXME: make mplib compatible
+        # Normal objects synced by update_from_simulation() and their entities
+        self._sync_entities: list[Entity] = []
+        self._sync_object_names: list[str] = []
+        sync_entity_ids: list[int] = []
 
         articulations: list[PhysxArticulation] = sim_scene.get_all_articulations()
         actors: list[Entity] = sim_scene.get_all_actors()
@@ -116,10 +121,23 @@ class SapienPlanningWorld(PlanningWorld):
             # )
             if len(col_objs) > 1:
                 self._multi_shapes_objs[entity.name] = col_objs
-                for i, col_obj in enumerate(col_objs):
-                    self.add_normal_object(f"{entity.name}_{i}", col_obj)
+                names = [f"{entity.name}_{i}" for i in range(len(col_objs))]
             else:
-                self.add_normal_object(entity.name, col_objs[0])
+                names = [entity.name]
+
+            entity_id = len(self._sync_entities)
+            self._sync_entities.append(entity)
+            for name, col_obj in zip(names, col_objs):
+                self.add_normal_object(name, col_obj)
+                # Pose of col_obj relative to entity (shape.local_pose and the
+                # Capsule/Cylinder axis conversion), applied by set_object_poses()
+                offset = entity.pose.inv() * Pose(
+                    col_obj.get_translation(), mat2quat(col_obj.get_rotation())
+                )
+                self.set_normal_object_offset(name, np.hstack((offset.p, offset.q)))
+                self._sync_object_names.append(name)
+                sync_entity_ids.append(entity_id)
+        self._sync_entity_ids = np.array(sync_entity_ids, dtype=int)
 
     def update_from_simulation(self, update_attached_object: bool = True) -> None:
         """Updates planning_world articulations/objects pose with current Scene state
@@ -131,64 +149,14 @@ class SapienPlanningWorld(PlanningWorld):
             # set_qpos to update poses
             self.get_articulation(articulation.name).set_qpos(articulation.qpos)
 
-        for entity in self._sim_scene.get_all_actors():
-            component = entity.find_component_by_type(PhysxRigidBaseComponent)
-            assert (
-                component is not None
-            ), f"No PhysxRigidBaseComponent found in {entity.name}: {entity.components=}"
-            assert not isinstance(
-                component, PhysxArticulationLinkComponent
-            ), f"Component should not be PhysxArticulationLinkComponent: {component=}"
-
-            shapes = component.collision_shapes
-            assert len(shapes) >= 1, (
-                f"Should have 1+ collision shape, got {len(shapes)} shapes for "
-                f"entity '{entity.name}'"
-            )
-            # TODO: multiple collision shapes
-            # assert len(shapes) == 1, (
-            #     f"Should only have 1 collision shape, got {len(shapes)} shapes for "
-            #     f"entity '{entity.name}'"
-            # )
-            if len(shapes) > 1:
-                for i, (shape, col_obj) in enumerate(
-                    zip(shapes, self._multi_shapes_objs[entity.name])
-                ):
-                    pose: Pose = entity.pose * shape.local_pose
-                    # NOTE: Convert poses for Capsule/Cylinder
-                    if isinstance(
-                        shape, (PhysxCollisionShapeCapsule, PhysxCollisionShapeCylinder)
-                    ):
-                        pose = pose * Pose(q=euler2quat(0, np.pi / 2, 0))
-                    col_obj.set_transformation(np.hstack((pose.p, pose.q)))
-                continue
-
-            shape = shapes[0]
-
-            pose: Pose = entity.pose * shape.local_pose
-            # NOTE: Convert poses for Capsule/Cylinder
-            if isinstance(
-                shape, (PhysxCollisionShapeCapsule, PhysxCollisionShapeCylinder)
-            ):
-                pose = pose * Pose(q=euler2quat(0, np.pi / 2, 0))
-
-            # handle attached object
-            if self.is_normal_object_attached(entity.name):
-                attached_body = self.get_attached_object(entity.name)
-                if update_attached_object:
-                    parent_posevec = (
-                        attached_body.get_attached_articulation()
-                        .get_pinocchio_model()
-                        .get_link_pose(attached_body.get_attached_link_id())
-                    )
-                    parent_pose = Pose(parent_posevec[:3], parent_posevec[3:])
-                    pose = parent_pose.inv() * pose  # new attached pose
-                    attached_body.set_pose(np.hstack((pose.p, pose.q)))
-                attached_body.update_pose()
-            else:
-                self.get_normal_object(entity.name).set_transformation(
-                    np.hstack((pose.p, pose.q))
-                )
+        entity_poses = np.array(
+            [np.hstack((e.pose.p, e.pose.q)) for e in self._sync_entities]
+        ).reshape(-1, 7)
+        self.set_object_poses(
+            self._sync_object_names,
+            entity_poses[self._sync_entity_ids],
+            update_attached_object,
+        )
 
     def _get_col_obj(
         self,
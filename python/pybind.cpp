@@ -6,8 +6,10 @@
 #include "pybind_fcl.hpp"
 #include "pybind_kdl.hpp"
 #include "pybind_ompl.hpp"
+#include "pybind_perf_counters.hpp"
 #include "pybind_pinocchio.hpp"
 #include "pybind_planning_world.hpp"
+#include "pybind_trace.hpp"
 
 namespace py = pybind11;
 
@@ -21,6 +23,8 @@ PYBIND11_MODULE(pymp, m) {
   build_pyarticulation(m);
   build_attached_body(m);
   build_collision_matrix(m);
+  build_perf_counters(m);
+  build_trace(m);
   build_planning_world(m);
   build_pyompl(m);
   // build_pytopp(m);
@@ -68,7 +68,12 @@ inline void build_pyarticulation(py::module &m_all) {
       .def("get_qpos", &ArticulatedModel::getQpos)
       .def("set_qpos", &ArticulatedModel::setQpos, py::arg("qpos"),
            py::arg("full") = false)
+      .def("get_link_poses", &ArticulatedModel::getLinkPoses,
+           py::return_value_policy::reference_internal)
+      .def("get_collision_poses", &ArticulatedModel::getCollisionPoses,
+           py::return_value_policy::reference_internal)
       .def("get_qpos_dim", &ArticulatedModel::getQposDim)
+      .def("get_state_version", &ArticulatedModel::getStateVersion)
       .def("update_SRDF", &ArticulatedModel::updateSRDF, py::arg("SRDF"));
 }
 
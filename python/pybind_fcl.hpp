@@ -14,6 +14,7 @@
 #include "fcl_model.h"
 #include "planning_world.h"
 #include "pybind_macros.hpp"
+#include "shared_geometry.h"
 #include "types.h"
 #include "urdf_utils.h"
 
@@ -22,6 +23,7 @@ namespace py = pybind11;
 namespace mplib {
 
 using FCLModel = fcl::FCLModelTpl<S>;
+using SharedGeometryStore = fcl::SharedGeometryStoreTpl<S>;
 using ArticulatedModelPtr = ArticulatedModelTplPtr<S>;
 using WorldCollisionResult = WorldCollisionResultTpl<S>;
 using WorldDistanceResult = WorldDistanceResultTpl<S>;
@@ -40,6 +42,7 @@ using Sphere = fcl::Sphere<S>;
 using TriangleP = fcl::TriangleP<S>;
 using BVHModel_OBBRSS = fcl::BVHModel<fcl::OBBRSS<S>>;
 using OcTree = fcl::OcTree<S>;
+using SourceOcTree = fcl::SourceOcTreeTpl<S>;
 
 using CollisionObject = fcl::CollisionObject<S>;
 using CollisionObjectPtr = fcl::CollisionObjectPtr<S>;
@@ -220,8 +223,13 @@ inline void build_pyfcl(py::module &m_all) {
 
   auto PyOcTree =
       py::class_<OcTree, std::shared_ptr<OcTree>>(m, "OcTree", PyCollisionGeometry);
-  PyOcTree.def(py::init<S>(), py::arg("resolution"))
-      .def(py::init([](const MatrixX3<S> &vertices, double resolution) {
+  // Created as SourceOcTree so that octrees can be added to a SharedGeometryStore
+  PyOcTree
+      .def(py::init([](S resolution) -> OcTree * {
+             return new SourceOcTree(resolution);
+           }),
+           py::arg("resolution"))
+      .def(py::init([](const MatrixX3<S> &vertices, double resolution) -> OcTree * {
              octomap::OcTree *tree = new octomap::OcTree(resolution);
 
              // insert some measurements of occupied cells
@@ -231,8 +239,7 @@ inline void build_pyfcl(py::module &m_all) {
                    true);
 
              auto tree_ptr = std::shared_ptr<const octomap::OcTree>(tree);
-             OcTree *octree = new OcTree(tree_ptr);
-             return octree;
+             return new SourceOcTree(tree_ptr);
            }),
            py::arg("vertices"), py::arg("resolution"));
 
@@ -454,6 +461,7 @@ inline void build_pyfcl(py::module &m_all) {
       .def("get_collision_pairs", &FCLModel::getCollisionPairs)
       .def("get_collision_objects", &FCLModel::getCollisionObjects)
       .def("get_collision_link_names", &FCLModel::getCollisionLinkNames)
+      .def("get_mesh_geometries", &FCLModel::getMeshGeometries)
       .def("set_link_order", &FCLModel::setLinkOrder, py::arg("names"))
       .def("remove_collision_pairs_from_srdf", &FCLModel::removeCollisionPairsFromSRDF,
            py::arg("srdf_filename"))
@@ -465,6 +473,23 @@ inline void build_pyfcl(py::module &m_all) {
       .def("collide_full", &FCLModel::collideFull,
            py::arg("request") = CollisionRequest());
 
+  // Shared-memory geometry store
+  auto PySharedGeometryStore =
+      py::class_<SharedGeometryStore, std::shared_ptr<SharedGeometryStore>>(
+          m, "SharedGeometryStore");
+  PySharedGeometryStore
+      .def_static("create", &SharedGeometryStore::create, py::arg("name"),
+                  py::arg("geometries"))
+      .def_static("open", &SharedGeometryStore::open, py::arg("name"))
+      .def_static("unlink", &SharedGeometryStore::unlink, py::arg("name"))
+      .def_static("get_mesh_key", &SharedGeometryStore::getMeshKey,
+                  py::arg("mesh_path"), py::arg("scale"), py::arg("convex") = false)
+      .def("get_name", &SharedGeometryStore::getName)
+      .def("get_size", &SharedGeometryStore::getSize)
+      .def("get_keys", &SharedGeometryStore::getKeys)
+      .def("has_geometry", &SharedGeometryStore::hasGeometry, py::arg("key"))
+      .def("get_geometry", &SharedGeometryStore::getGeometry, py::arg("key"));
+
   // Extra function
   m.def("load_mesh_as_BVH", load_mesh_as_BVH<S>, py::arg("mesh_path"),
         py::arg("scale"));
@@ -10,24 +10,104 @@
 
 #include "ompl_planner.h"
 #include "pybind_macros.hpp"
+#include "replanning_session.h"
 
 namespace py = pybind11;
 
 namespace mplib {
 
 using OMPLPlanner = ompl::OMPLPlannerTpl<S>;
+using MotionValidatorType = ompl::MotionValidatorType;
+using BatchPlanOptions = ompl::BatchPlanOptions;
+using BatchPlanResult = ompl::BatchPlanResultTpl<S>;
+using ReplanMode = ompl::ReplanMode;
+using ReplanResult = ompl::ReplanResultTpl<S>;
+using ReplanningSession = ompl::ReplanningSessionTpl<S>;
 
 inline void build_pyompl(py::module &m_all) {
   auto m = m_all.def_submodule("ompl");
 
+  auto PyMotionValidatorType = py::enum_<MotionValidatorType>(m, "MotionValidatorType");
+  PyMotionValidatorType.value("SWEPT", MotionValidatorType::SWEPT)
+      .value("CERTIFIED", MotionValidatorType::CERTIFIED);
+
+  auto PyBatchPlanOptions =
+      py::class_<BatchPlanOptions, std::shared_ptr<BatchPlanOptions>>(
+          m, "BatchPlanOptions");
+  PyBatchPlanOptions.def(py::init<>())
+      .def_readwrite("planner_name", &BatchPlanOptions::planner_name)
+      .def_readwrite("time", &BatchPlanOptions::time)
+      .def_readwrite("range", &BatchPlanOptions::range)
+      .def_readwrite("goal_bias", &BatchPlanOptions::goal_bias)
+      .def_readwrite("pathlen_obj_weight", &BatchPlanOptions::pathlen_obj_weight)
+      .def_readwrite("pathlen_obj_only", &BatchPlanOptions::pathlen_obj_only)
+      .def_readwrite("num_threads", &BatchPlanOptions::num_threads);
+
+  auto PyBatchPlanResult =
+      py::class_<BatchPlanResult, std::shared_ptr<BatchPlanResult>>(
+          m, "BatchPlanResult");
+  PyBatchPlanResult.def(py::init<>())
+      .def_readwrite("status", &BatchPlanResult::status)
+      .def_readwrite("path", &BatchPlanResult::path)
+      .def_readwrite("success", &BatchPlanResult::success)
+      .def_readwrite("planning_time", &BatchPlanResult::planning_time)
+      .def_readwrite("path_length", &BatchPlanResult::path_length)
+      .def_readwrite("thread_id", &BatchPlanResult::thread_id)
+      .def_readwrite("perf_counts", &BatchPlanResult::perf_counts);
+
   auto PyOMPLPlanner =
       py::class_<OMPLPlanner, std::shared_ptr<OMPLPlanner>>(m, "OMPLPlanner");
   PyOMPLPlanner.def(py::init<const PlanningWorldTplPtr<S> &>(), py::arg("world"))
+      .def("set_max_displacement", &OMPLPlanner::setMaxDisplacement,
+           py::arg("max_displacement"))
+      .def("get_motion_validator", &OMPLPlanner::getMotionValidator)
+      .def("set_motion_validator", &OMPLPlanner::setMotionValidator, py::arg("type"))
+      .def("set_linear_nearest_neighbors", &OMPLPlanner::setLinearNearestNeighbors,
+           py::arg("enabled"))
       .def("plan", &OMPLPlanner::plan, py::arg("start_state"), py::arg("goal_states"),
            py::arg("planner_name") = "RRTConnect", py::arg("time") = 1.0,
            py::arg("range") = 0.0, py::arg("goal_bias") = 0.05,
            py::arg("pathlen_obj_weight") = 10.0, py::arg("pathlen_obj_only") = false,
+           py::arg("verbose") = false, py::arg("fixed_joints") = std::vector<bool>())
+      .def("get_last_plan_counts", &OMPLPlanner::getLastPlanCounts)
+      .def("plan_batch", &OMPLPlanner::planBatch, py::arg("start_states"),
+           py::arg("goal_sets"), py::arg("options") = BatchPlanOptions(),
+           py::call_guard<py::gil_scoped_release>())
+      .def("plan_with_time", &OMPLPlanner::planWithTime, py::arg("start_state"),
+           py::arg("start_time"), py::arg("goal_states"), py::arg("velocity_limits"),
+           py::arg("max_duration"), py::arg("planner_name") = "RRTConnect",
+           py::arg("time") = 1.0, py::arg("range") = 0.0, py::arg("verbose") = false)
+      .def("plan_prioritized", &OMPLPlanner::planPrioritized, py::arg("start_state"),
+           py::arg("start_time"), py::arg("goal_states"), py::arg("velocity_limits"),
+           py::arg("max_duration"), py::arg("time") = 1.0, py::arg("range") = 0.0,
            py::arg("verbose") = false);
+
+  auto PyReplanMode = py::enum_<ReplanMode>(m, "ReplanMode");
+  PyReplanMode.value("REUSED", ReplanMode::REUSED)
+      .value("REPAIRED", ReplanMode::REPAIRED)
+      .value("REPLANNED", ReplanMode::REPLANNED);
+
+  auto PyReplanResult =
+      py::class_<ReplanResult, std::shared_ptr<ReplanResult>>(m, "ReplanResult");
+  PyReplanResult.def(py::init<>())
+      .def_readwrite("status", &ReplanResult::status)
+      .def_readwrite("path", &ReplanResult::path)
+      .def_readwrite("mode", &ReplanResult::mode)
+      .def_readwrite("repaired_segments", &ReplanResult::repaired_segments)
+      .def_readwrite("planning_time", &ReplanResult::planning_time);
+
+  auto PyReplanningSession =
+      py::class_<ReplanningSession, std::shared_ptr<ReplanningSession>>(
+          m, "ReplanningSession");
+  PyReplanningSession
+      .def(py::init<const std::shared_ptr<OMPLPlanner> &, S>(), py::arg("planner"),
+           py::arg("resolution") = 0.01)
+      .def("replan", &ReplanningSession::replan, py::arg("current_state"),
+           py::arg("goal_states"), py::arg("deadline"),
+           py::arg("planner_name") = "RRTConnect", py::arg("range") = 0.0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_path", &ReplanningSession::getPath)
+      .def("reset", &ReplanningSession::reset);
 }
 
 }  // namespace mplib
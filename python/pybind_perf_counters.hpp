@@ -0,0 +1,53 @@
+#pragma once
+
+#include <pybind11/operators.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "perf_counters.h"
+
+namespace py = pybind11;
+
+namespace mplib {
+
+inline void build_perf_counters(py::module &m_all) {
+  auto m = m_all.def_submodule("perf_counters");
+
+  auto PyPerfCounter = py::enum_<PerfCounter>(m, "PerfCounter");
+  PyPerfCounter.value("NARROWPHASE_SELF", PerfCounter::NARROWPHASE_SELF)
+      .value("NARROWPHASE_SELF_ARTICULATION",
+             PerfCounter::NARROWPHASE_SELF_ARTICULATION)
+      .value("NARROWPHASE_SELF_ATTACH", PerfCounter::NARROWPHASE_SELF_ATTACH)
+      .value("NARROWPHASE_ATTACH_ATTACH", PerfCounter::NARROWPHASE_ATTACH_ATTACH)
+      .value("NARROWPHASE_ARTICULATION_ARTICULATION",
+             PerfCounter::NARROWPHASE_ARTICULATION_ARTICULATION)
+      .value("NARROWPHASE_ARTICULATION_SCENEOBJECT",
+             PerfCounter::NARROWPHASE_ARTICULATION_SCENEOBJECT)
+      .value("NARROWPHASE_ATTACH_ARTICULATION",
+             PerfCounter::NARROWPHASE_ATTACH_ARTICULATION)
+      .value("NARROWPHASE_ATTACH_SCENEOBJECT",
+             PerfCounter::NARROWPHASE_ATTACH_SCENEOBJECT)
+      .value("BROADPHASE_CULL", PerfCounter::BROADPHASE_CULL)
+      .value("FORWARD_KINEMATICS", PerfCounter::FORWARD_KINEMATICS)
+      .value("STATE_VALIDITY_CHECK", PerfCounter::STATE_VALIDITY_CHECK)
+      .value("MOTION_CHECK", PerfCounter::MOTION_CHECK)
+      .value("MOTION_CERTIFICATE", PerfCounter::MOTION_CERTIFICATE)
+      .value("SELF_COLLISION_CACHE_HIT", PerfCounter::SELF_COLLISION_CACHE_HIT);
+
+  auto PyPerfCounts = py::class_<PerfCounts>(m, "PerfCounts");
+  PyPerfCounts.def(py::init<>())
+      .def("get_count", &PerfCounts::getCount, py::arg("counter"))
+      .def("get_nanoseconds", &PerfCounts::getNanoseconds, py::arg("counter"))
+      .def_property_readonly("counts", &PerfCounts::getCountsByName)
+      .def_property_readonly("nanoseconds", &PerfCounts::getNanosecondsByName)
+      .def(py::self - py::self)
+      .def(py::self += py::self);
+
+  m.def("set_enabled", &PerfCounters::setEnabled, py::arg("enabled"))
+      .def("is_enabled", &PerfCounters::isEnabled)
+      .def("get", &PerfCounters::get)
+      .def("get_thread", &PerfCounters::getThread)
+      .def("reset", &PerfCounters::reset);
+}
+
+}  // namespace mplib
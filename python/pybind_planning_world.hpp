@@ -9,6 +9,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "path_monitor.h"
 #include "planning_world.h"
 #include "pybind_macros.hpp"
 #include "random_utils.h"
@@ -20,7 +21,13 @@ namespace mplib {
 
 using PlanningWorld = PlanningWorldTpl<S>;
 using WorldCollisionResult = WorldCollisionResultTpl<S>;
+using WorldCollisionReport = WorldCollisionReportTpl<S>;
 using WorldDistanceResult = WorldDistanceResultTpl<S>;
+using WorldDistanceGradient = WorldDistanceGradientTpl<S>;
+using WorldDistanceReport = WorldDistanceReportTpl<S>;
+using TrajectoryValidationResult = TrajectoryValidationResultTpl<S>;
+using CartesianPathResult = CartesianPathResultTpl<S>;
+using PathMonitor = PathMonitorTpl<S>;
 
 using ArticulatedModelPtr = ArticulatedModelTplPtr<S>;
 using CollisionRequest = fcl::CollisionRequest<S>;
@@ -33,6 +40,29 @@ inline void build_planning_world(py::module &m_all) {
 
   auto m = m_all.def_submodule("planning_world");
 
+  auto PyCollisionReportLevel =
+      py::enum_<CollisionReportLevel>(m, "CollisionReportLevel");
+  PyCollisionReportLevel.value("BOOL", CollisionReportLevel::BOOL)
+      .value("PAIRS", CollisionReportLevel::PAIRS)
+      .value("CONTACTS", CollisionReportLevel::CONTACTS)
+      .value("FULL", CollisionReportLevel::FULL);
+
+  auto PyObjectHandle = py::class_<ObjectHandle>(m, "ObjectHandle");
+  PyObjectHandle.def(py::init<>())
+      .def_readonly("index", &ObjectHandle::index)
+      .def_readonly("generation", &ObjectHandle::generation)
+      .def("is_set", &ObjectHandle::isSet)
+      .def(py::self == py::self)
+      .def(py::self != py::self)
+      .def("__hash__",
+           [](const ObjectHandle &handle) {
+             return py::hash(py::make_tuple(handle.index, handle.generation));
+           })
+      .def("__repr__", [](const ObjectHandle &handle) {
+        return "<ObjectHandle " + std::to_string(handle.index) + ":" +
+               std::to_string(handle.generation) + ">";
+      });
+
   auto PyPlanningWorld =
       py::class_<PlanningWorld, std::shared_ptr<PlanningWorld>>(m, "PlanningWorld");
   PyPlanningWorld
@@ -44,8 +74,11 @@ inline void build_planning_world(py::module &m_all) {
            py::arg("normal_objects") = std::vector<CollisionObjectPtr>(),
            py::arg("normal_object_names") = std::vector<std::string>())
 
+      .def("clone", &PlanningWorld::clone)
       .def("get_articulation_names", &PlanningWorld::getArticulationNames)
       .def("get_planned_articulations", &PlanningWorld::getPlannedArticulations)
+      .def("get_planned_articulation_names",
+           &PlanningWorld::getPlannedArticulationNames)
       .def("get_articulation", &PlanningWorld::getArticulation, py::arg("name"))
       .def("has_articulation", &PlanningWorld::hasArticulation, py::arg("name"))
       .def("add_articulation", &PlanningWorld::addArticulation, py::arg("name"),
@@ -57,13 +90,47 @@ inline void build_planning_world(py::module &m_all) {
            py::arg("name"), py::arg("planned"))
 
       .def("get_normal_object_names", &PlanningWorld::getNormalObjectNames)
-      .def("get_normal_object", &PlanningWorld::getNormalObject, py::arg("name"))
+      .def("get_normal_object",
+           py::overload_cast<const std::string &>(&PlanningWorld::getNormalObject,
+                                                  py::const_),
+           py::arg("name"))
+      .def("get_normal_object",
+           py::overload_cast<const ObjectHandle &>(&PlanningWorld::getNormalObject,
+                                                   py::const_),
+           py::arg("handle"))
+      .def("get_normal_object_handle", &PlanningWorld::getNormalObjectHandle,
+           py::arg("name"))
       .def("has_normal_object", &PlanningWorld::hasNormalObject, py::arg("name"))
       .def("add_normal_object", &PlanningWorld::addNormalObject, py::arg("name"),
            py::arg("collision_object"))
       .def("add_point_cloud", &PlanningWorld::addPointCloud, py::arg("name"),
            py::arg("vertices"), py::arg("resolution") = 0.01)
+      .def("get_shareable_geometries", &PlanningWorld::getShareableGeometries)
+      .def("add_shared_object", &PlanningWorld::addSharedObject, py::arg("name"),
+           py::arg("store"), py::arg("pose"))
       .def("remove_normal_object", &PlanningWorld::removeNormalObject, py::arg("name"))
+      .def("set_normal_object_offset", &PlanningWorld::setNormalObjectOffset,
+           py::arg("name"), py::arg("offset"))
+      .def("set_object_poses",
+           py::overload_cast<const std::vector<std::string> &, const MatrixX7<S> &,
+                             bool>(&PlanningWorld::setObjectPoses),
+           py::arg("names"), py::arg("poses"), py::arg("update_attached_object") = true)
+      .def("set_object_poses",
+           py::overload_cast<const std::vector<ObjectHandle> &, const MatrixX7<S> &,
+                             bool>(&PlanningWorld::setObjectPoses),
+           py::arg("handles"), py::arg("poses"),
+           py::arg("update_attached_object") = true)
+      .def("set_object_trajectory", &PlanningWorld::setObjectTrajectory,
+           py::arg("name"), py::arg("times"), py::arg("poses"))
+      .def("remove_object_trajectory", &PlanningWorld::removeObjectTrajectory,
+           py::arg("name"))
+      .def("get_dynamic_object_names", &PlanningWorld::getDynamicObjectNames)
+      .def("set_articulation_trajectory", &PlanningWorld::setArticulationTrajectory,
+           py::arg("name"), py::arg("times"), py::arg("qposes"))
+      .def("remove_articulation_trajectory",
+           &PlanningWorld::removeArticulationTrajectory, py::arg("name"))
+      .def("get_time", &PlanningWorld::getTime)
+      .def("set_time", &PlanningWorld::setTime, py::arg("time"))
 
       .def("is_normal_object_attached", &PlanningWorld::isNormalObjectAttached,
            py::arg("name"))
@@ -106,13 +173,47 @@ inline void build_planning_world(py::module &m_all) {
 
       .def("get_allowed_collision_matrix", &PlanningWorld::getAllowedCollisionMatrix)
 
-      .def("collide", &PlanningWorld::collide, py::arg("request") = CollisionRequest())
-      .def("self_collide", &PlanningWorld::selfCollide,
+      .def("collide",
+           py::overload_cast<const CollisionRequest &>(&PlanningWorld::collide,
+                                                       py::const_),
            py::arg("request") = CollisionRequest())
-      .def("collide_with_others", &PlanningWorld::collideWithOthers,
+      .def("collide",
+           py::overload_cast<const std::vector<ObjectHandle> &,
+                             const CollisionRequest &>(&PlanningWorld::collide,
+                                                       py::const_),
+           py::arg("scene_objects"), py::arg("request") = CollisionRequest())
+      .def("collide_at_time", &PlanningWorld::collideAtTime, py::arg("time"),
            py::arg("request") = CollisionRequest())
+      .def("self_collide", &PlanningWorld::selfCollide,
+           py::arg("request") = CollisionRequest(),
+           py::arg("level") = CollisionReportLevel::FULL)
+      .def("collide_with_others",
+           py::overload_cast<const CollisionRequest &, CollisionReportLevel>(
+               &PlanningWorld::collideWithOthers, py::const_),
+           py::arg("request") = CollisionRequest(),
+           py::arg("level") = CollisionReportLevel::FULL)
+      .def("collide_with_others",
+           py::overload_cast<const std::vector<ObjectHandle> &,
+                             const CollisionRequest &, CollisionReportLevel>(
+               &PlanningWorld::collideWithOthers, py::const_),
+           py::arg("scene_objects"), py::arg("request") = CollisionRequest(),
+           py::arg("level") = CollisionReportLevel::FULL)
       .def("collide_full", &PlanningWorld::collideFull,
-           py::arg("request") = CollisionRequest())
+           py::arg("request") = CollisionRequest(),
+           py::arg("level") = CollisionReportLevel::FULL)
+      .def("collide_report", &PlanningWorld::collideReport,
+           py::arg("request") = CollisionRequest(),
+           py::arg("level") = CollisionReportLevel::FULL)
+
+      .def("get_displacement_bounds", &PlanningWorld::getDisplacementBounds)
+      .def("validate_trajectory", &PlanningWorld::validateTrajectory, py::arg("qs"),
+           py::arg("resolution"), py::arg("num_threads") = 0,
+           py::call_guard<py::gil_scoped_release>())
+      .def("compute_cartesian_path", &PlanningWorld::computeCartesianPath,
+           py::arg("art_name"), py::arg("link_index"), py::arg("waypoints"),
+           py::arg("eef_step"), py::arg("jump_threshold") = 0.0,
+           py::arg("resolution") = 0.01, py::arg("num_threads") = 0,
+           py::call_guard<py::gil_scoped_release>())
 
       .def("distance", &PlanningWorld::distance, py::arg("request") = DistanceRequest())
       .def("self_distance", &PlanningWorld::distanceSelf,
@@ -120,7 +221,12 @@ inline void build_planning_world(py::module &m_all) {
       .def("distance_with_others", &PlanningWorld::distanceOthers,
            py::arg("request") = DistanceRequest())
       .def("distance_full", &PlanningWorld::distanceFull,
-           py::arg("request") = DistanceRequest());
+           py::arg("request") = DistanceRequest())
+      .def("distance_gradient", &PlanningWorld::distanceGradient, py::arg("k") = 1,
+           py::arg("request") = DistanceRequest())
+      .def("distance_within", &PlanningWorld::distanceWithin, py::arg("cutoff"),
+           py::arg("max_pairs") = 0, py::arg("request") = DistanceRequest(),
+           py::arg("num_threads") = 0, py::call_guard<py::gil_scoped_release>());
 
   auto PyWorldCollisionResult =
       py::class_<WorldCollisionResult, std::shared_ptr<WorldCollisionResult>>(
@@ -133,6 +239,37 @@ inline void build_planning_world(py::module &m_all) {
       .def_readwrite("link_name1", &WorldCollisionResult::link_name1)
       .def_readwrite("link_name2", &WorldCollisionResult::link_name2);
 
+  auto PyWorldCollisionType =
+      py::enum_<WorldCollisionType>(m, "WorldCollisionType", py::arithmetic());
+  PyWorldCollisionType.value("SELF", WorldCollisionType::SELF)
+      .value("SELF_ARTICULATION", WorldCollisionType::SELF_ARTICULATION)
+      .value("SELF_ATTACH", WorldCollisionType::SELF_ATTACH)
+      .value("ATTACH_ATTACH", WorldCollisionType::ATTACH_ATTACH)
+      .value("ARTICULATION_ARTICULATION", WorldCollisionType::ARTICULATION_ARTICULATION)
+      .value("ARTICULATION_SCENEOBJECT", WorldCollisionType::ARTICULATION_SCENEOBJECT)
+      .value("ATTACH_ARTICULATION", WorldCollisionType::ATTACH_ARTICULATION)
+      .value("ATTACH_SCENEOBJECT", WorldCollisionType::ATTACH_SCENEOBJECT);
+
+  // Eigen members are exposed as read-only numpy views (no copy)
+  auto PyWorldCollisionReport =
+      py::class_<WorldCollisionReport, std::shared_ptr<WorldCollisionReport>>(
+          m, "WorldCollisionReport");
+  PyWorldCollisionReport.def(py::init<>())
+      .def_readonly("names", &WorldCollisionReport::names)
+      .def_readonly("object_ids", &WorldCollisionReport::object_ids)
+      .def_readonly("link_ids", &WorldCollisionReport::link_ids)
+      .def_readonly("collision_types", &WorldCollisionReport::collision_types)
+      .def_readonly("max_penetration_depths",
+                    &WorldCollisionReport::max_penetration_depths)
+      .def_readonly("contact_collision_ids",
+                    &WorldCollisionReport::contact_collision_ids)
+      .def_readonly("contact_points", &WorldCollisionReport::contact_points)
+      .def_readonly("contact_normals", &WorldCollisionReport::contact_normals)
+      .def_readonly("penetration_depths", &WorldCollisionReport::penetration_depths)
+      .def("__len__", [](const WorldCollisionReport &report) {
+        return report.collision_types.size();
+      });
+
   auto PyWorldDistanceResult =
       py::class_<WorldDistanceResult, std::shared_ptr<WorldDistanceResult>>(
           m, "WorldDistanceResult");
@@ -144,6 +281,60 @@ inline void build_planning_world(py::module &m_all) {
       .def_readwrite("object_name2", &WorldDistanceResult::object_name2)
       .def_readwrite("link_name1", &WorldDistanceResult::link_name1)
       .def_readwrite("link_name2", &WorldDistanceResult::link_name2);
+
+  auto PyWorldDistanceGradient =
+      py::class_<WorldDistanceGradient, std::shared_ptr<WorldDistanceGradient>>(
+          m, "WorldDistanceGradient");
+  PyWorldDistanceGradient.def(py::init<>())
+      .def_readwrite("results", &WorldDistanceGradient::results)
+      .def_readwrite("distances", &WorldDistanceGradient::distances)
+      .def_readwrite("gradients", &WorldDistanceGradient::gradients);
+
+  auto PyWorldDistanceReport =
+      py::class_<WorldDistanceReport, std::shared_ptr<WorldDistanceReport>>(
+          m, "WorldDistanceReport");
+  PyWorldDistanceReport.def(py::init<>())
+      .def_readonly("names", &WorldDistanceReport::names)
+      .def_readonly("object_ids", &WorldDistanceReport::object_ids)
+      .def_readonly("link_ids", &WorldDistanceReport::link_ids)
+      .def_readonly("distance_types", &WorldDistanceReport::distance_types)
+      .def_readonly("distances", &WorldDistanceReport::distances)
+      .def_readonly("points1", &WorldDistanceReport::points1)
+      .def_readonly("points2", &WorldDistanceReport::points2)
+      .def_readonly("normals", &WorldDistanceReport::normals)
+      .def("__len__", [](const WorldDistanceReport &report) {
+        return report.distances.size();
+      });
+
+  auto PyTrajectoryValidationResult =
+      py::class_<TrajectoryValidationResult,
+                 std::shared_ptr<TrajectoryValidationResult>>(
+          m, "TrajectoryValidationResult");
+  PyTrajectoryValidationResult.def(py::init<>())
+      .def_readwrite("valid", &TrajectoryValidationResult::valid)
+      .def_readwrite("index", &TrajectoryValidationResult::index)
+      .def_readwrite("fraction", &TrajectoryValidationResult::fraction)
+      .def_readwrite("qpos", &TrajectoryValidationResult::qpos)
+      .def_readwrite("collision", &TrajectoryValidationResult::collision);
+
+  auto PyCartesianPathResult =
+      py::class_<CartesianPathResult, std::shared_ptr<CartesianPathResult>>(
+          m, "CartesianPathResult");
+  PyCartesianPathResult.def(py::init<>())
+      .def_readwrite("path", &CartesianPathResult::path)
+      .def_readwrite("fraction", &CartesianPathResult::fraction);
+
+  auto PyPathMonitor =
+      py::class_<PathMonitor, std::shared_ptr<PathMonitor>>(m, "PathMonitor");
+  PyPathMonitor
+      .def(py::init<const PlanningWorldTplPtr<S> &, const MatrixX<S> &, S>(),
+           py::arg("world"), py::arg("path"), py::arg("resolution") = 0.01)
+      .def("get_path", &PathMonitor::getPath)
+      .def("get_segment_count", &PathMonitor::getSegmentCount)
+      .def("update", &PathMonitor::update)
+      .def("get_invalid_segments", &PathMonitor::getInvalidSegments)
+      .def("get_checked_segments", &PathMonitor::getCheckedSegments)
+      .def("get_changed_objects", &PathMonitor::getChangedObjects);
 }
 
 }  // namespace mplib
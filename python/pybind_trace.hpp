@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+#include "trace.h"
+
+namespace py = pybind11;
+
+namespace mplib {
+
+/// @brief Python context manager recording a span (if the Tracer is recording)
+struct PyTraceSpan {
+  std::string name;
+  double begin_us {};
+  bool enabled {};
+};
+
+inline void build_trace(py::module &m_all) {
+  auto m = m_all.def_submodule("trace");
+
+  m.def("is_compiled_in", &Tracer::isCompiledIn)
+      .def("start", &Tracer::start, py::arg("filename"))
+      .def("stop", &Tracer::stop)
+      .def("is_recording", &Tracer::isRecording);
+
+  auto PySpan = py::class_<PyTraceSpan>(m, "Span");
+  PySpan
+      .def(py::init([](const std::string &name) { return PyTraceSpan {name}; }),
+           py::arg("name"))
+      .def("__enter__",
+           [](PyTraceSpan &span) {
+             span.enabled = Tracer::isRecording();
+             if (span.enabled) span.begin_us = Tracer::now();
+             return &span;
+           },
+           py::return_value_policy::reference_internal)
+      .def("__exit__", [](PyTraceSpan &span, const py::args &) {
+        if (span.enabled) Tracer::addSpan(span.name, span.begin_us, Tracer::now());
+        span.enabled = false;
+      });
+}
+
+}  // namespace mplib
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+namespace mplib::server {
+
+/**
+ * Binary protocol of the planning server over a Unix domain stream socket.
+ * Every message (request or response) is a MessageHeader followed by payload_size
+ * bytes of payload, in native byte order without padding. In payloads, reals are
+ * float64, counts and lengths are uint32, arrays are a count followed by the reals
+ * and strings are a length followed by the bytes.
+ *
+ * A client may send several requests without waiting. Requests of a connection are
+ * served in order and each response is sent as soon as it is computed.
+ *
+ * Requests (qpos of the move group unless noted):
+ *  - INFO: empty.
+ *    -> dof (uint32), move group joint names (dof strings), move group link (string)
+ *  - PLAN: planning time (real), range (real, 0 for default), planner name (string),
+ *    start qpos (array), number of goals (uint32), goal qpos (arrays).
+ *    -> OK (exact solution): rows, cols (uint32), path (rows * cols reals,
+ *       row-major). FAILED: planner status (string)
+ *  - IK: target pose of the move group link (7 reals, xyz and wxyz), initial full
+ *    qpos of all user joints (array).
+ *    -> OK: full qpos (array). FAILED: empty
+ *  - COLLIDE: qpos (array).
+ *    -> number of collisions (uint32), then per collision object name 1, link name 1,
+ *       object name 2, link name 2 (strings)
+ *
+ * Malformed requests get a BAD_REQUEST response whose payload is the error message
+ * (string).
+ */
+constexpr uint32_t kProtocolMagic = 0x534c504d;  // "MPLS" in little-endian
+constexpr uint32_t kMaxPayloadSize = 64u << 20;
+
+enum class RequestType : uint16_t { INFO = 0, PLAN = 1, IK = 2, COLLIDE = 3 };
+
+enum class Status : uint16_t { OK = 0, FAILED = 1, BAD_REQUEST = 2 };
+
+struct MessageHeader {
+  uint32_t magic;         // kProtocolMagic
+  uint32_t request_id;    // chosen by the client, echoed in the response
+  uint16_t type;          // RequestType
+  uint16_t status;        // Status of responses, 0 in requests
+  uint32_t payload_size;  // at most kMaxPayloadSize
+};
+
+static_assert(sizeof(MessageHeader) == 16, "MessageHeader should not be padded");
+
+}  // namespace mplib::server
@@ -0,0 +1,244 @@
+/**
+ * Planning server: loads a robot once and serves plan, IK and collision requests
+ * over a Unix domain socket (see planning_protocol.h).
+ *
+ * Usage:
+ *   mplib_server --urdf robot.urdf --srdf robot.srdf --move-group link
+ *                --socket /tmp/mplib.sock [--threads N] [--convex]
+ *
+ * Each worker thread owns a copy of the planning world (PlanningWorld::clone()) and
+ * its OMPLPlanner, and serves one request at a time. Idle connections are polled by
+ * the main thread and handed to a free worker when a request arrives, so any number
+ * of connections share the workers.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "planning_service.h"
+
+namespace mplib::server {
+
+namespace {
+
+const std::string kArticulationName = "robot";
+
+/// @brief Connections with a pending request, not yet served
+class ConnectionQueue {
+ public:
+  void push(int fd) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fds_.push_back(fd);
+    }
+    cv_.notify_one();
+  }
+
+  int pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !fds_.empty(); });
+    const int fd = fds_.front();
+    fds_.pop_front();
+    return fd;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<int> fds_;
+};
+
+/// @brief Connections returned by the workers, to be polled again by the main thread
+class IdleConnections {
+ public:
+  IdleConnections() {
+    if (pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC) != 0)
+      throw std::runtime_error(std::string("Cannot create pipe: ") +
+                               std::strerror(errno));
+  }
+
+  /// @brief Returns a served connection and wakes up the main thread
+  void push(int fd) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fds_.push_back(fd);
+    }
+    // Fails only if the pipe is full, which wakes up the main thread as well
+    const char byte = 0;
+    [[maybe_unused]] const auto n = write(wake_fds_[1], &byte, 1);
+  }
+
+  /// @brief Takes the returned connections
+  std::vector<int> take() {
+    char bytes[64];
+    while (read(wake_fds_[0], bytes, sizeof(bytes)) > 0) continue;
+    std::vector<int> ret;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ret.swap(fds_);
+    return ret;
+  }
+
+  /// @brief Readable when connections are returned
+  int getWakeFd() const { return wake_fds_[0]; }
+
+ private:
+  std::mutex mutex_;
+  std::vector<int> fds_;
+  int wake_fds_[2];
+};
+
+std::atomic<int> listen_fd {-1};
+
+void handleSignal(int) {
+  if (listen_fd >= 0) shutdown(listen_fd, SHUT_RDWR);
+}
+
+struct Options {
+  std::string urdf, srdf, move_group, socket_path;
+  size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  bool convex = false;
+};
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) throw std::invalid_argument("Missing value of " + arg);
+      return argv[++i];
+    };
+    if (arg == "--urdf")
+      options.urdf = value();
+    else if (arg == "--srdf")
+      options.srdf = value();
+    else if (arg == "--move-group")
+      options.move_group = value();
+    else if (arg == "--socket")
+      options.socket_path = value();
+    else if (arg == "--threads")
+      options.num_threads = std::max(std::stoul(value()), 1ul);
+    else if (arg == "--convex")
+      options.convex = true;
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  if (options.urdf.empty() || options.move_group.empty() ||
+      options.socket_path.empty())
+    throw std::invalid_argument("--urdf, --move-group and --socket are required");
+  return options;
+}
+
+int run(int argc, char **argv) {
+  const auto options = parseOptions(argc, argv);
+
+  // Models are loaded once, workers get copies sharing the collision geometries
+  auto robot = std::make_shared<ArticulatedModel>(
+      options.urdf, options.srdf, Vector3<S>(0, 0, -9.81), std::vector<std::string>(),
+      std::vector<std::string>(), false, options.convex);
+  robot->setMoveGroup(options.move_group);
+  const auto &link_names = robot->getUserLinkNames();
+  const size_t move_group_link =
+      std::find(link_names.begin(), link_names.end(), options.move_group) -
+      link_names.begin();
+  const PlanningWorld world({robot}, {kArticulationName});
+
+  std::vector<WorldContext> contexts;
+  for (size_t i = 0; i < options.num_threads; i++)
+    contexts.push_back(createWorldContext(world, kArticulationName, move_group_link));
+
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if (options.socket_path.size() >= sizeof(address.sun_path))
+    throw std::invalid_argument("Socket path is too long");
+  std::strcpy(address.sun_path, options.socket_path.c_str());
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(options.socket_path.c_str());
+  const auto *addr = reinterpret_cast<sockaddr *>(&address);
+  if (fd < 0 || bind(fd, addr, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+    throw std::runtime_error("Cannot listen on " + options.socket_path + ": " +
+                             std::strerror(errno));
+  listen_fd = fd;
+  std::signal(SIGINT, handleSignal);
+  std::signal(SIGTERM, handleSignal);
+
+  // A worker serves one request, then returns the connection to be polled again
+  ConnectionQueue queue;
+  IdleConnections idle;
+  for (auto &context : contexts)
+    std::thread([&queue, &idle, &context] {
+      while (true) {
+        const int client = queue.pop();
+        if (serveRequest(context, client))
+          idle.push(client);
+        else
+          close(client);
+      }
+    }).detach();
+  std::cout << "Serving " << options.move_group << " on " << options.socket_path
+            << " with " << contexts.size() << " threads" << std::endl;
+
+  // Accepts connections and polls the idle ones until a signal shuts the socket down
+  std::vector<int> clients;
+  std::vector<pollfd> fds;
+  while (true) {
+    fds.assign({{fd, POLLIN, 0}, {idle.getWakeFd(), POLLIN, 0}});
+    for (int client : clients) fds.push_back({client, POLLIN, 0});
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    // Connections with a request (or closed) go to the workers
+    std::vector<int> waiting;
+    for (size_t i = 2; i < fds.size(); i++)
+      if (fds[i].revents)
+        queue.push(fds[i].fd);
+      else
+        waiting.push_back(fds[i].fd);
+    clients = std::move(waiting);
+    if (fds[1].revents)
+      for (int client : idle.take()) clients.push_back(client);
+    if (fds[0].revents) {
+      const int client = accept(fd, nullptr, nullptr);
+      if (client >= 0)
+        clients.push_back(client);
+      else if (errno != EINTR && errno != EAGAIN)
+        break;
+    }
+  }
+  close(fd);
+  unlink(options.socket_path.c_str());
+  std::cout << "Stopped" << std::endl;
+  // Workers may be serving requests, exit without waiting for them
+  std::_Exit(0);
+}
+
+}  // namespace
+
+}  // namespace mplib::server
+
+int main(int argc, char **argv) {
+  try {
+    return mplib::server::run(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,251 @@
+#include "planning_service.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "planning_protocol.h"
+
+namespace mplib::server {
+
+namespace {
+
+/// @brief Reads values from a request payload, throws if it is too short
+class PayloadReader {
+ public:
+  explicit PayloadReader(const std::vector<char> &payload) : payload_(payload) {}
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string readString() {
+    const auto size = read<uint32_t>();
+    return std::string(take(size), size);
+  }
+
+  VectorX<S> readArray() {
+    const auto size = read<uint32_t>();
+    // Check the untrusted count before allocating
+    const auto *data = take(size * sizeof(S));
+    VectorX<S> ret(size);
+    std::memcpy(ret.data(), data, size * sizeof(S));
+    return ret;
+  }
+
+  /// @brief Reads a count of items that each take at least item_size bytes
+  size_t readCount(size_t item_size) {
+    const auto count = read<uint32_t>();
+    if (count > (payload_.size() - offset_) / item_size)
+      throw std::invalid_argument("Request payload is too short");
+    return count;
+  }
+
+ private:
+  const std::vector<char> &payload_;
+  size_t offset_ {};
+
+  const char *take(size_t size) {
+    if (size > payload_.size() - offset_)
+      throw std::invalid_argument("Request payload is too short");
+    offset_ += size;
+    return payload_.data() + offset_ - size;
+  }
+};
+
+/// @brief Appends values to a response payload
+class PayloadWriter {
+ public:
+  template <typename T>
+  void write(const T &value) {
+    append(&value, sizeof(T));
+  }
+
+  void writeString(const std::string &value) {
+    write(static_cast<uint32_t>(value.size()));
+    append(value.data(), value.size());
+  }
+
+  void writeArray(const VectorX<S> &values) {
+    write(static_cast<uint32_t>(values.size()));
+    append(values.data(), values.size() * sizeof(S));
+  }
+
+  const std::vector<char> &getPayload() const { return payload_; }
+
+ private:
+  std::vector<char> payload_;
+
+  void append(const void *data, size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+    payload_.insert(payload_.end(), bytes, bytes + size);
+  }
+};
+
+
+bool readAll(int fd, void *data, size_t size) {
+  auto *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    const auto n = read(fd, bytes, size);
+    if (n <= 0) return false;
+    bytes += n, size -= n;
+  }
+  return true;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const auto *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    const auto n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    bytes += n, size -= n;
+  }
+  return true;
+}
+
+/// @brief Sets the move group qpos of the robot, keeping the other joints
+void setMoveGroupQpos(WorldContext &context, const VectorX<S> &qpos) {
+  if (static_cast<size_t>(qpos.size()) != context.robot->getQposDim())
+    throw std::invalid_argument("Expected " +
+                                std::to_string(context.robot->getQposDim()) +
+                                " joint values, got " + std::to_string(qpos.size()));
+  context.robot->setQpos(qpos);
+}
+
+Status handleInfo(WorldContext &context, PayloadReader &, PayloadWriter &writer) {
+  const auto &joint_names = context.robot->getUserJointNames();
+  const auto &indices = context.robot->getMoveGroupJointIndices();
+  writer.write(static_cast<uint32_t>(indices.size()));
+  for (auto i : indices) writer.writeString(joint_names[i]);
+  writer.writeString(context.robot->getUserLinkNames()[context.move_group_link]);
+  return Status::OK;
+}
+
+Status handlePlan(WorldContext &context, PayloadReader &reader,
+                  PayloadWriter &writer) {
+  const auto time = reader.read<double>();
+  const auto range = reader.read<double>();
+  const auto planner_name = reader.readString();
+  const auto start = reader.readArray();
+  // Each goal takes at least its uint32 length
+  std::vector<VectorX<S>> goals(reader.readCount(sizeof(uint32_t)));
+  for (auto &goal : goals) goal = reader.readArray();
+  if (goals.empty()) throw std::invalid_argument("No goal state");
+  setMoveGroupQpos(context, start);
+  // The planner only checks the size of the first goal
+  for (const auto &goal : goals)
+    if (static_cast<size_t>(goal.size()) != context.robot->getQposDim())
+      throw std::invalid_argument("Expected " +
+                                  std::to_string(context.robot->getQposDim()) +
+                                  " joint values of each goal, got " +
+                                  std::to_string(goal.size()));
+
+  const auto [status, path] =
+      context.planner->plan(start, goals, planner_name, time, range);
+  // Approximate solutions do not reach the goal
+  if (status != "Exact solution") {
+    writer.writeString(status);
+    return Status::FAILED;
+  }
+  writer.write(static_cast<uint32_t>(path.rows()));
+  writer.write(static_cast<uint32_t>(path.cols()));
+  for (Eigen::Index i = 0; i < path.rows(); i++)
+    for (Eigen::Index j = 0; j < path.cols(); j++) writer.write(path(i, j));
+  return Status::OK;
+}
+
+Status handleIK(WorldContext &context, PayloadReader &reader, PayloadWriter &writer) {
+  Vector7<S> pose;
+  for (int i = 0; i < 7; i++) pose[i] = reader.read<double>();
+  const auto q_init = reader.readArray();
+  const auto pinocchio_model = context.robot->getPinocchioModel();
+  if (static_cast<size_t>(q_init.size()) != context.robot->getUserJointNames().size())
+    throw std::invalid_argument("Expected the qpos of all user joints");
+
+  // Only the move group joints are solved for
+  std::vector<bool> mask(q_init.size(), true);
+  for (auto i : context.robot->getMoveGroupJointIndices()) mask[i] = false;
+  const auto [qpos, success, error] =
+      pinocchio_model->computeIKCLIK(context.move_group_link, pose, q_init, mask);
+  if (!success) return Status::FAILED;
+  writer.writeArray(qpos);
+  return Status::OK;
+}
+
+Status handleCollide(WorldContext &context, PayloadReader &reader,
+                     PayloadWriter &writer) {
+  setMoveGroupQpos(context, reader.readArray());
+  const auto collisions = context.world->collideFull();
+  writer.write(static_cast<uint32_t>(collisions.size()));
+  for (const auto &collision : collisions) {
+    writer.writeString(collision.object_name1);
+    writer.writeString(collision.link_name1);
+    writer.writeString(collision.object_name2);
+    writer.writeString(collision.link_name2);
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+WorldContext createWorldContext(const PlanningWorld &world, const std::string &art_name,
+                                size_t move_group_link) {
+  WorldContext context;
+  context.world = world.clone();
+  context.robot = context.world->getArticulation(art_name);
+  context.planner = std::make_shared<OMPLPlanner>(context.world);
+  context.move_group_link = move_group_link;
+  return context;
+}
+
+bool serveRequest(WorldContext &context, int fd) {
+  MessageHeader header;
+  if (!readAll(fd, &header, sizeof(header))) return false;
+  if (header.magic != kProtocolMagic || header.payload_size > kMaxPayloadSize)
+    return false;  // cannot find the next message
+  std::vector<char> payload(header.payload_size);
+  if (!readAll(fd, payload.data(), payload.size())) return false;
+
+  PayloadReader reader(payload);
+  PayloadWriter writer;
+  Status status;
+  try {
+    switch (static_cast<RequestType>(header.type)) {
+      case RequestType::INFO:
+        status = handleInfo(context, reader, writer);
+        break;
+      case RequestType::PLAN:
+        status = handlePlan(context, reader, writer);
+        break;
+      case RequestType::IK:
+        status = handleIK(context, reader, writer);
+        break;
+      case RequestType::COLLIDE:
+        status = handleCollide(context, reader, writer);
+        break;
+      default:
+        throw std::invalid_argument("Unknown request type " +
+                                    std::to_string(header.type));
+    }
+  } catch (const std::exception &e) {
+    writer = PayloadWriter();
+    writer.writeString(e.what());
+    status = Status::BAD_REQUEST;
+  }
+
+  const auto &response = writer.getPayload();
+  header.status = static_cast<uint16_t>(status);
+  header.payload_size = response.size();
+  return writeAll(fd, &header, sizeof(header)) &&
+         writeAll(fd, response.data(), response.size());
+}
+
+}  // namespace mplib::server
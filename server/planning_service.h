@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "articulated_model.h"
+#include "ompl_planner.h"
+#include "planning_world.h"
+
+namespace mplib::server {
+
+using S = double;
+using ArticulatedModel = ArticulatedModelTpl<S>;
+using PlanningWorld = PlanningWorldTpl<S>;
+using OMPLPlanner = ompl::OMPLPlannerTpl<S>;
+
+/// @brief Planning state owned by one worker thread
+struct WorldContext {
+  std::shared_ptr<PlanningWorld> world;
+  std::shared_ptr<ArticulatedModel> robot;
+  std::shared_ptr<OMPLPlanner> planner;
+  size_t move_group_link;
+};
+
+/**
+ * @brief Creates the context of a worker with its own copy of world
+ * @param world: planning world with the robot as a planned articulation
+ * @param art_name: name of the robot in world
+ * @param move_group_link: index of the move group link in the user link names
+ */
+WorldContext createWorldContext(const PlanningWorld &world, const std::string &art_name,
+                                size_t move_group_link);
+
+/**
+ * @brief Reads one request from fd (see planning_protocol.h) and writes its response.
+ *  Malformed payloads get a BAD_REQUEST response.
+ * @returns false if the connection is closed or a message cannot be read or written.
+ *  fd is not closed.
+ */
+bool serveRequest(WorldContext &context, int fd);
+
+}  // namespace mplib::server
@@ -1,8 +1,14 @@
 #include "articulated_model.h"
 
 #include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <tuple>
 
 #include "macros_utils.h"
+#include "math_utils.h"
+#include "perf_counters.h"
 
 namespace mplib {
 
@@ -33,6 +39,7 @@ ArticulatedModelTpl<S>::ArticulatedModelTpl(const std::string &urdf_filename,
   fcl_model_->removeCollisionPairsFromSRDF(srdf_filename);
   current_qpos_ = VectorX<S>::Constant(pinocchio_model_->getModel().nv, 0);
   setMoveGroup(user_link_names_);
+  setQpos(current_qpos_, true);
 }
 
 template <typename S>
@@ -62,10 +69,20 @@ std::unique_ptr<ArticulatedModelTpl<S>> ArticulatedModelTpl<S>::createFromURDFSt
   articulation->current_qpos_ =
       VectorX<S>::Constant(pinocchio_model->getModel().nv, 0);
   articulation->setMoveGroup(user_link_names);
+  articulation->setQpos(articulation->current_qpos_, true);
 
   return articulation;
 }
 
+template <typename S>
+std::unique_ptr<ArticulatedModelTpl<S>> ArticulatedModelTpl<S>::clone() const {
+  auto articulation = std::make_unique<ArticulatedModelTpl<S>>(*this);
+  articulation->pinocchio_model_ =
+      std::make_shared<PinocchioModelTpl<S>>(*pinocchio_model_);
+  articulation->fcl_model_ = fcl_model_->clone();
+  return articulation;
+}
+
 template <typename S>
 std::vector<std::string> ArticulatedModelTpl<S>::getMoveGroupJointNames() const {
   std::vector<std::string> ret;
@@ -95,6 +112,19 @@ void ArticulatedModelTpl<S>::setMoveGroup(
   move_group_user_joints_.erase(end_unique, move_group_user_joints_.end());
   qpos_dim_ = 0;
   for (auto i : move_group_user_joints_) qpos_dim_ += pinocchio_model_->getJointDim(i);
+  displacement_chains_.clear();  // qpos columns changed
+}
+
+template <typename S>
+VectorX<S> ArticulatedModelTpl<S>::getMoveGroupQpos(const VectorX<S> &qpos) const {
+  VectorX<S> ret(qpos_dim_);
+  size_t len = 0;
+  for (auto i : move_group_user_joints_) {
+    auto start_idx = pinocchio_model_->getJointId(i),
+         dim_i = pinocchio_model_->getJointDim(i);
+    for (size_t j = 0; j < dim_i; j++) ret[len++] = qpos[start_idx + j];
+  }
+  return ret;
 }
 
 template <typename S>
@@ -114,9 +144,13 @@ void ArticulatedModelTpl<S>::setQpos(const VectorX<S> &qpos, bool full) {
   }
   pinocchio_model_->computeForwardKinematics(current_qpos_);
   // std::cout << "current_qpos " << current_qpos << std::endl;
+  const auto num_links = user_link_names_.size();
+  link_poses_.resize(num_links, 7);
   std::vector<Transform3<S>> link_pose;
-  for (size_t i = 0; i < user_link_names_.size(); i++) {
+  link_pose.reserve(num_links);
+  for (size_t i = 0; i < num_links; i++) {
     Vector7<S> pose_i = pinocchio_model_->getLinkPose(i);
+    link_poses_.row(i) = pose_i.transpose();
     Transform3<S> tmp_i;
     tmp_i.linear() = Quaternion<S>(pose_i[3], pose_i[4], pose_i[5], pose_i[6]).matrix();
     tmp_i.translation() = pose_i.head(3);
@@ -124,6 +158,163 @@ void ArticulatedModelTpl<S>::setQpos(const VectorX<S> &qpos, bool full) {
     link_pose.push_back(tmp_i);
   }
   fcl_model_->updateCollisionObjects(link_pose);
+  fcl_pose_version_ = fcl_model_->getPoseVersion();
+
+  const auto &collision_objects = fcl_model_->getCollisionObjects();
+  collision_poses_.resize(collision_objects.size(), 7);
+  for (size_t i = 0; i < collision_objects.size(); i++)
+    collision_poses_.row(i) =
+        transform_to_posevec(collision_objects[i]->getTransform()).transpose();
+  state_version_++;
+}
+
+template <typename S>
+void ArticulatedModelTpl<S>::collideSelfPair(size_t pair_index,
+                                             const fcl::CollisionRequest<S> &request,
+                                             fcl::CollisionResult<S> &result) const {
+  const auto &col_pairs = fcl_model_->getCollisionPairs();
+  ASSERT(pair_index < col_pairs.size(), "The collision pair index is out of bound!");
+  if (pair_index >= cached_collision_pairs_.size() ||
+      cached_collision_pairs_[pair_index] != col_pairs[pair_index])
+    buildSelfCollisionCache();
+
+  // Poses no longer follow current_qpos_ if collision objects were moved directly
+  const bool synced = fcl_model_->getPoseVersion() == fcl_pose_version_;
+  if (!synced)
+    for (auto &entry : self_collision_cache_) entry.valid = false;
+
+  auto &entry = self_collision_cache_[pair_index];
+  const auto &qpos_indices = pair_qpos_indices_[pair_index];
+  const bool cacheable = synced && !request.enable_contact && !request.enable_cost;
+  if (cacheable && entry.valid && entry.num_max_contacts == request.num_max_contacts) {
+    bool moved = false;
+    for (size_t k = 0; k < qpos_indices.size() && !moved; k++)
+      moved = entry.qpos[k] != current_qpos_[qpos_indices[k]];
+    if (!moved) {
+      PerfCounters::add(PerfCounter::SELF_COLLISION_CACHE_HIT);
+      result = entry.result;
+      return;
+    }
+  }
+
+  const auto &col_objs = fcl_model_->getCollisionObjects();
+  const auto &[x, y] = col_pairs[pair_index];
+  result.clear();
+  {
+    ScopedPerfTimer timer(PerfCounter::NARROWPHASE_SELF);
+    ::fcl::collide(col_objs[x].get(), col_objs[y].get(), request, result);
+  }
+  if (cacheable) {
+    entry.valid = true;
+    entry.num_max_contacts = request.num_max_contacts;
+    for (size_t k = 0; k < qpos_indices.size(); k++)
+      entry.qpos[k] = current_qpos_[qpos_indices[k]];
+    entry.result = result;
+  }
+}
+
+template <typename S>
+VectorX<S> ArticulatedModelTpl<S>::getDisplacementBound(size_t link_index,
+                                                       const Vector3<S> &center,
+                                                       S radius) const {
+  if (displacement_chains_.empty()) buildDisplacementChains();
+  VectorX<S> ret = VectorX<S>::Zero(qpos_dim_);
+  const auto &chain = displacement_chains_[link_index];
+  if (chain.empty()) return ret;
+
+  // Walk from the body towards the root. reach bounds the distance from the current
+  // joint origin to any point of the body, in any configuration: distances between
+  // consecutive joint origins are rigid, except across prismatic joints which can
+  // extend by their joint range.
+  const Vector3<S> origin =
+      pinocchio_model_->getJointPose(displacement_chain_ends_[link_index]).head(3);
+  S reach = radius + (center - origin).norm();
+  for (const auto &joint : chain) {
+    reach += joint.offset;
+    S bound = std::numeric_limits<S>::infinity();
+    if (joint.type == 'R')
+      bound = reach;
+    else if (joint.type == 'P') {
+      bound = 1;
+      reach += joint.range;
+    } else
+      reach = std::numeric_limits<S>::infinity();  // unhandled joint type
+    if (joint.qpos_dim > 0)
+      ret.segment(joint.qpos_start, joint.qpos_dim).setConstant(bound);
+  }
+  return ret;
+}
+
+template <typename S>
+void ArticulatedModelTpl<S>::buildDisplacementChains() const {
+  const std::string joint_prefix = "JointModel";
+  const auto joint_types = pinocchio_model_->getJointTypes();
+
+  // qpos columns of each move group joint
+  std::map<size_t, std::pair<size_t, size_t>> qpos_columns;
+  size_t start_idx = 0;
+  for (auto i : move_group_user_joints_) {
+    const auto dim_i = pinocchio_model_->getJointDim(i);
+    qpos_columns[i] = {start_idx, dim_i};
+    start_idx += dim_i;
+  }
+
+  displacement_chains_.assign(user_link_names_.size(), {});
+  displacement_chain_ends_.assign(user_link_names_.size(), 0);
+  for (size_t link_index = 0; link_index < user_link_names_.size(); link_index++) {
+    auto chain = pinocchio_model_->getChainJointIndex(user_link_names_[link_index]);
+    if (chain.empty()) continue;
+    displacement_chain_ends_[link_index] = chain.back();
+    auto &joints = displacement_chains_[link_index];
+    Vector3<S> prev = pinocchio_model_->getJointPose(chain.back()).head(3);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+      const Vector3<S> origin = pinocchio_model_->getJointPose(*it).head(3);
+      DisplacementChainJoint joint;
+      joint.type = joint_types[*it][joint_prefix.size()];
+      joint.offset = (prev - origin).norm();
+      prev = origin;
+      if (joint.type == 'P') {
+        const auto limit = pinocchio_model_->getJointLimit(*it);
+        joint.range = limit(0, 1) - limit(0, 0);
+      }
+      if (auto column = qpos_columns.find(*it); column != qpos_columns.end())
+        std::tie(joint.qpos_start, joint.qpos_dim) = column->second;
+      joints.push_back(joint);
+    }
+  }
+}
+
+template <typename S>
+void ArticulatedModelTpl<S>::buildSelfCollisionCache() const {
+  const auto &col_pairs = fcl_model_->getCollisionPairs();
+  const auto &col_link_user_indices = fcl_model_->getCollisionLinkUserIndices();
+
+  // Supporting joints (user joint indices, sorted) of each collision object's link
+  std::vector<std::vector<size_t>> supports;
+  for (auto link_index : col_link_user_indices) {
+    auto joint_indices =
+        pinocchio_model_->getChainJointIndex(user_link_names_[link_index]);
+    std::sort(joint_indices.begin(), joint_indices.end());
+    supports.push_back(joint_indices);
+  }
+
+  cached_collision_pairs_ = col_pairs;
+  pair_qpos_indices_.assign(col_pairs.size(), {});
+  self_collision_cache_.assign(col_pairs.size(), {});
+  for (size_t i = 0; i < col_pairs.size(); i++) {
+    // Relative pose only depends on joints that support exactly one of the links
+    const auto &support1 = supports[col_pairs[i].first];
+    const auto &support2 = supports[col_pairs[i].second];
+    std::vector<size_t> joint_indices;
+    std::set_symmetric_difference(support1.begin(), support1.end(), support2.begin(),
+                                  support2.end(), std::back_inserter(joint_indices));
+    for (auto joint_index : joint_indices) {
+      auto start_idx = pinocchio_model_->getJointId(joint_index),
+           dim_i = pinocchio_model_->getJointDim(joint_index);
+      for (size_t j = 0; j < dim_i; j++) pair_qpos_indices_[i].push_back(start_idx + j);
+    }
+    self_collision_cache_[i].qpos.resize(pair_qpos_indices_[i].size());
+  }
 }
 
 }  // namespace mplib
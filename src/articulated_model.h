@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -51,6 +52,13 @@ class ArticulatedModelTpl {
       const Vector3<S> &gravity, const std::vector<std::string> &joint_names = {},
       const std::vector<std::string> &link_names = {}, bool verbose = true);
 
+  /**
+   * @brief Copies the articulation, including its kinematic state. The copy has its
+   *  own PinocchioModel and FCLModel (see FCLModel::clone()).
+   * @returns a unique_ptr to the copy
+   */
+  std::unique_ptr<ArticulatedModelTpl<S>> clone() const;
+
   const std::string &getName() const { return name_; }
 
   void setName(const std::string &name) { name_ = name; }
@@ -83,14 +91,70 @@ class ArticulatedModelTpl {
 
   const VectorX<S> &getQpos() const { return current_qpos_; }
 
+  /// @brief Gets the move group qpos (see setQpos()) of a full qpos
+  VectorX<S> getMoveGroupQpos(const VectorX<S> &qpos) const;
+
+  /// @brief Gets the current move group qpos
+  VectorX<S> getMoveGroupQpos() const { return getMoveGroupQpos(current_qpos_); }
+
   void setQpos(const VectorX<S> &qpos, bool full = false);
 
+  /**
+   * @brief Get the poses of all user links as of the last setQpos() call.
+   *  Row ``i`` is the pose of ``getUserLinkNames()[i]`` as [x, y, z, qw, qx, qy, qz].
+   */
+  const MatrixX7<S> &getLinkPoses() const { return link_poses_; }
+
+  /**
+   * @brief Get the global poses of all collision objects as of the last setQpos()
+   *  call. Row ``i`` corresponds to ``getFCLModel()->getCollisionObjects()[i]``
+   *  and is formatted as [x, y, z, qw, qx, qy, qz].
+   */
+  const MatrixX7<S> &getCollisionPoses() const { return collision_poses_; }
+
   size_t getQposDim() const { return qpos_dim_; }
 
+  /**
+   * @brief Gets the version of the kinematic state, which is incremented by every
+   *  setQpos() call. Used to detect whether link poses have changed.
+   */
+  uint64_t getStateVersion() const { return state_version_; }
+
   void updateSRDF(const std::string &srdf_filename) {
     fcl_model_->removeCollisionPairsFromSRDF(srdf_filename);
   }
 
+  /**
+   * @brief Checks collision of a self-collision pair of the FCLModel in current state
+   *  (``getFCLModel()->getCollisionPairs()[pair_index]``).
+   *  If request computes neither contacts nor cost sources, the result is cached
+   *  and reused as long as none of the joints that determine the relative pose of
+   *  the two links (joints supporting only one of them) has moved. Contacts are
+   *  not cached since they are expressed in world frame. The cache is cleared when
+   *  the collision objects are moved by FCLModel::updateCollisionObjects() outside
+   *  of setQpos(), and bypassed until the next setQpos() call.
+   * @param pair_index: index of the collision pair
+   * @param request: collision request
+   * @param result: collision result of the pair (cleared before use)
+   */
+  void collideSelfPair(size_t pair_index, const fcl::CollisionRequest<S> &request,
+                       fcl::CollisionResult<S> &result) const;
+
+  /**
+   * @brief Bounds how far a rigid body fixed to a link can move per unit motion of
+   *  each move group qpos (a Lipschitz constant of the kinematic chain).
+   *  Every point of the body moves by at most ``bound.dot(abs(delta_qpos))`` along
+   *  a linear joint-space motion, in any configuration.
+   * @param link_index: user index of the link the body is fixed to
+   * @param center: center of a sphere enclosing the body in current state
+   * @param radius: radius of a sphere enclosing the body
+   * @returns the bound of each move group qpos (length getQposDim()). For revolute
+   *  joints, an upper bound of the distance from joint origin to the body. For
+   *  prismatic joints, 1.
+   */
+  VectorX<S> getDisplacementBound(size_t link_index, const Vector3<S> &center,
+                                  S radius) const;
+
  private:
   // Used for protecting public default constructor (passkey idiom)
   struct Secret {
@@ -110,8 +174,45 @@ class ArticulatedModelTpl {
   std::vector<std::string> move_group_end_effectors_;
   VectorX<S> current_qpos_;
 
+  // Pose buffers refreshed by setQpos(), exposed to Python without copy
+  MatrixX7<S> link_poses_;
+  MatrixX7<S> collision_poses_;
+
   size_t qpos_dim_ {};
+  uint64_t state_version_ {};
   bool verbose_ {};
+
+  // Self-collision result cache (see collideSelfPair())
+  struct SelfCollisionCacheEntry {
+    bool valid {};
+    size_t num_max_contacts {};
+    std::vector<S> qpos;  // values of the qpos entries that move the pair
+    fcl::CollisionResult<S> result;
+  };
+  // collision pairs the cache is built for, and the qpos entries moving each pair
+  mutable std::vector<std::pair<size_t, size_t>> cached_collision_pairs_;
+  mutable std::vector<std::vector<size_t>> pair_qpos_indices_;
+  mutable std::vector<SelfCollisionCacheEntry> self_collision_cache_;
+  // FCLModel pose version set by the last setQpos(), see collideSelfPair()
+  uint64_t fcl_pose_version_ {};
+
+  /// @brief (Re)builds the self-collision cache for the current collision pairs
+  void buildSelfCollisionCache() const;
+
+  // Kinematic chain of a link for getDisplacementBound(), from the link to the root
+  struct DisplacementChainJoint {
+    char type {};        // 'R' (revolute), 'P' (prismatic) or other
+    S range {};          // joint range of a prismatic joint
+    S offset {};         // distance to the origin of the previous (deeper) joint
+    size_t qpos_start {};
+    size_t qpos_dim {};  // 0 if not in the move group
+  };
+  // chain joints and deepest joint (user index) of each user link, built lazily
+  mutable std::vector<std::vector<DisplacementChainJoint>> displacement_chains_;
+  mutable std::vector<size_t> displacement_chain_ends_;
+
+  /// @brief Builds the chains of all user links for the current move group
+  void buildDisplacementChains() const;
 };
 
 // Common Type Alias ==========================================================
@@ -17,7 +17,6 @@ AttachedBodyTpl<S>::AttachedBodyTpl(const std::string &name,
     : name_(name),
       object_(object),
       attached_articulation_(attached_articulation),
-      pinocchio_model_(attached_articulation->getPinocchioModel()),
       attached_link_id_(attached_link_id),
       pose_(pose),
       touch_links_(touch_links) {
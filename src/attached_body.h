@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -42,16 +43,37 @@ class AttachedBodyTpl {
   const Transform3<S> &getPose() const { return pose_; }
 
   /// @brief Sets the attached pose (relative pose from attached link to object)
-  void setPose(const Transform3<S> &pose) { pose_ = pose; }
+  void setPose(const Transform3<S> &pose) {
+    pose_ = pose;
+    pose_dirty_ = true;
+  }
 
-  /// @brief Gets the global pose of the attached object
+  /**
+   * @brief Gets the global pose of the attached object using the link poses of the
+   *  attached articulation as of its last setQpos() call
+   */
   Transform3<S> getGlobalPose() const {
-    return posevec_to_transform(pinocchio_model_->getLinkPose(attached_link_id_)) *
-           pose_;
+    const Vector7<S> link_pose =
+        attached_articulation_->getLinkPoses().row(attached_link_id_).transpose();
+    return posevec_to_transform(link_pose) * pose_;
   }
 
-  /// @brief Updates the global pose of the attached object using current state
-  void updatePose() const { object_->setTransform(getGlobalPose()); }
+  /**
+   * @brief Updates the global pose of the attached object using current state.
+   *  The global pose is only recomputed if the attached pose or the articulation
+   *  state (see ArticulatedModelTpl::getStateVersion()) has changed since the last
+   *  update, but it is always written to the object, whose transform may have been
+   *  set elsewhere.
+   */
+  void updatePose() const {
+    const auto state_version = attached_articulation_->getStateVersion();
+    if (pose_dirty_ || state_version != state_version_) {
+      global_pose_ = getGlobalPose();
+      state_version_ = state_version;
+      pose_dirty_ = false;
+    }
+    object_->setTransform(global_pose_);
+  }
 
   /// @brief Gets the link names that the attached body touches
   const std::vector<std::string> &getTouchLinks() const { return touch_links_; }
@@ -65,10 +87,14 @@ class AttachedBodyTpl {
   std::string name_;
   CollisionObjectPtr object_;
   ArticulatedModelPtr attached_articulation_;
-  pinocchio::PinocchioModelTplPtr<S> pinocchio_model_;
   int attached_link_id_;
   Transform3<S> pose_;
   std::vector<std::string> touch_links_;
+
+  // global pose computed by updatePose(), with its articulation state version
+  mutable Transform3<S> global_pose_;
+  mutable uint64_t state_version_ {};
+  mutable bool pose_dirty_ {true};
 };
 
 // Common Type Alias ==========================================================
@@ -1,6 +1,7 @@
 #include "fcl_model.h"
 
 #include <algorithm>
+#include <unordered_set>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -8,6 +9,8 @@
 #include <urdf_parser/urdf_parser.h>
 
 #include "macros_utils.h"
+#include "perf_counters.h"
+#include "shared_geometry.h"
 #include "urdf_utils.h"
 
 namespace mplib::fcl {
@@ -34,6 +37,19 @@ FCLModelTpl<S>::FCLModelTpl(const std::string &urdf_filename, bool verbose, bool
   init(urdfTree, urdf_dir);
 }
 
+template <typename S>
+std::unique_ptr<FCLModelTpl<S>> FCLModelTpl<S>::clone() const {
+  auto fcl_model = std::make_unique<FCLModelTpl<S>>(*this);
+  for (auto &collision_obj : fcl_model->collision_objects_) {
+    // Geometries are shared, only the (posed) objects are copied
+    auto geometry = std::const_pointer_cast<CollisionGeometry<S>>(
+        collision_obj->collisionGeometry());
+    collision_obj =
+        std::make_shared<CollisionObject<S>>(geometry, collision_obj->getTransform());
+  }
+  return fcl_model;
+}
+
 template <typename S>
 std::unique_ptr<FCLModelTpl<S>> FCLModelTpl<S>::createFromURDFString(
     const std::string &urdf_string,
@@ -48,6 +64,7 @@ std::unique_ptr<FCLModelTpl<S>> FCLModelTpl<S>::createFromURDFString(
     for (const auto &collision_obj : collision_objs) {
       fcl_model->collision_objects_.push_back(collision_obj);
       fcl_model->collision_link_names_.push_back(link_name);
+      fcl_model->mesh_keys_.emplace_back();
       // fcl_model->parent_link_names_.push_back(parent_link_name);  // FIXME: remove
       fcl_model->collision_origin2link_poses_.push_back(collision_obj->getTransform());
     }
@@ -66,6 +83,20 @@ std::unique_ptr<FCLModelTpl<S>> FCLModelTpl<S>::createFromURDFString(
   return fcl_model;
 }
 
+template <typename S>
+std::vector<std::pair<std::string, CollisionGeometryPtr<S>>>
+FCLModelTpl<S>::getMeshGeometries() const {
+  std::vector<std::pair<std::string, CollisionGeometryPtr<S>>> ret;
+  std::unordered_set<std::string> keys;
+  for (size_t i = 0; i < collision_objects_.size(); i++) {
+    const auto &key = mesh_keys_[i];
+    if (key.empty() || !keys.insert(key).second) continue;
+    ret.emplace_back(key, std::const_pointer_cast<CollisionGeometry<S>>(
+                              collision_objects_[i]->collisionGeometry()));
+  }
+  return ret;
+}
+
 template <typename S>
 void FCLModelTpl<S>::setLinkOrder(const std::vector<std::string> &names) {
   user_link_names_ = names;
@@ -145,6 +176,7 @@ void FCLModelTpl<S>::updateCollisionObjects(
     // auto tmp1 = collision_objects[i].get()->getTranslation();
     // std::cout << collision_objects[i].get()->getTranslation() << std::endl;
   }
+  pose_version_++;
 }
 
 template <typename S>
@@ -164,6 +196,7 @@ void FCLModelTpl<S>::updateCollisionObjects(
     // Transform3 tmp = collision_objects[i]->getTransform();
     // std::cout << collision_objects[i].get()->getTranslation() << std::endl;
   }
+  pose_version_++;
 }
 
 template <typename S>
@@ -171,6 +204,7 @@ bool FCLModelTpl<S>::collide(const CollisionRequest<S> &request) const {
   // result will be returned via the collision result structure
   CollisionResult<S> result;
   for (const auto &col_pair : collision_pairs_) {
+    ScopedPerfTimer timer(PerfCounter::NARROWPHASE_SELF);
     ::fcl::collide(collision_objects_[col_pair.first].get(),
                    collision_objects_[col_pair.second].get(), request, result);
     if (result.isCollision()) return true;
@@ -185,6 +219,7 @@ std::vector<CollisionResult<S>> FCLModelTpl<S>::collideFull(
   for (const auto &col_pair : collision_pairs_) {
     CollisionResult<S> result;
     result.clear();
+    ScopedPerfTimer timer(PerfCounter::NARROWPHASE_SELF);
     ::fcl::collide(collision_objects_[col_pair.first].get(),
                    collision_objects_[col_pair.second].get(), request, result);
     ret.push_back(result);
@@ -204,6 +239,7 @@ void FCLModelTpl<S>::dfs_parse_tree(const urdf::LinkConstSharedPtr &link,
     for (const auto &col_obj : link->collision_array) {
       const auto &geom = col_obj->geometry;
       CollisionGeometryPtr<S> collision_geometry = nullptr;
+      std::string mesh_key;
       auto pose = Transform3<S>::Identity();
       if (geom->type == urdf::Geometry::MESH) {
         const urdf::MeshConstSharedPtr urdf_mesh =
@@ -221,6 +257,7 @@ void FCLModelTpl<S>::dfs_parse_tree(const urdf::LinkConstSharedPtr &link,
         Vector3<S> scale = {static_cast<S>(urdf_mesh->scale.x),
                             static_cast<S>(urdf_mesh->scale.y),
                             static_cast<S>(urdf_mesh->scale.z)};
+        mesh_key = SharedGeometryStoreTpl<S>::getMeshKey(mesh_path, scale, use_convex_);
         if (use_convex_)
           collision_geometry = load_mesh_as_Convex(mesh_path, scale);
         else
@@ -253,6 +290,7 @@ void FCLModelTpl<S>::dfs_parse_tree(const urdf::LinkConstSharedPtr &link,
       // collision_link_index.push_back(frame_id);
       collision_link_names_.push_back(link->name);
       parent_link_names_.push_back(parent_link_name);
+      mesh_keys_.push_back(mesh_key);
       // collision_joint_index.push_back(model.frames[frame_id].parent);
       /// body_placement * convert_data((*i)->origin);
       collision_origin2link_poses_.push_back(pose_to_transform<S>(col_obj->origin));
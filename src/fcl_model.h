@@ -39,6 +39,13 @@ class FCLModelTpl {
           &collision_links,
       bool verbose = true);
 
+  /**
+   * @brief Copies the model. Collision objects are copied (sharing their geometries)
+   *  so that the copy can be updated independently.
+   * @returns a unique_ptr to the copy
+   */
+  std::unique_ptr<FCLModelTpl<S>> clone() const;
+
   const std::vector<std::pair<size_t, size_t>> &getCollisionPairs() const {
     return collision_pairs_;
   }
@@ -57,6 +64,15 @@ class FCLModelTpl {
     return collision_link_user_indices_;
   }
 
+  /**
+   * @brief Gets the geometries loaded from mesh files with their mesh keys (see
+   *  SharedGeometryStore::getMeshKey()), e.g., to place them in a
+   *  SharedGeometryStore for other processes
+   * @returns pairs of mesh key and geometry, one per distinct mesh
+   */
+  std::vector<std::pair<std::string, CollisionGeometryPtr<S>>> getMeshGeometries()
+      const;
+
   void setLinkOrder(const std::vector<std::string> &names);
 
   void printCollisionPairs() const;
@@ -69,6 +85,12 @@ class FCLModelTpl {
 
   void updateCollisionObjects(const std::vector<Vector7<S>> &link_pose) const;
 
+  /**
+   * @brief Gets the version of the collision object poses, which is incremented by
+   *  every updateCollisionObjects() call
+   */
+  uint64_t getPoseVersion() const { return pose_version_; }
+
   bool collide(const CollisionRequest<S> &request = CollisionRequest<S>()) const;
 
   std::vector<CollisionResult<S>> collideFull(
@@ -84,11 +106,13 @@ class FCLModelTpl {
   std::vector<std::string> collision_link_names_;
   std::vector<std::string> parent_link_names_;
   std::vector<std::pair<size_t, size_t>> collision_pairs_;
+  std::vector<std::string> mesh_keys_;  // of each collision object, empty if no mesh
 
   std::vector<std::string> user_link_names_;
   std::vector<size_t> collision_link_user_indices_;
   std::string package_dir_;
   bool use_convex_, verbose_;
+  mutable uint64_t pose_version_ {};
 
   void dfs_parse_tree(const urdf::LinkConstSharedPtr &link,
                       const std::string &parent_link_name);
@@ -1,10 +1,19 @@
 #include "math_utils.h"
 
+#include <algorithm>
+
 namespace mplib {
 
 // Explicit Template Instantiation Definition =================================
-#define DEFINE_TEMPLATE_MATH_UTILS(S) \
-  template Transform3<S> posevec_to_transform(const Vector7<S> &vec)
+#define DEFINE_TEMPLATE_MATH_UTILS(S)                                    \
+  template Transform3<S> posevec_to_transform(const Vector7<S> &vec);    \
+  template Vector7<S> transform_to_posevec(const Transform3<S> &pose);   \
+  template Vector7<S> interpolate_posevec(const Vector7<S> &pose1,       \
+                                          const Vector7<S> &pose2, S t); \
+  template std::pair<size_t, S> find_trajectory_segment(                 \
+      const VectorX<S> &times, S time);                                  \
+  template VectorX<S> interpolate_trajectory(const VectorX<S> &times,    \
+                                             const MatrixX<S> &values, S time)
 
 DEFINE_TEMPLATE_MATH_UTILS(float);
 DEFINE_TEMPLATE_MATH_UTILS(double);
@@ -17,4 +26,43 @@ Transform3<S> posevec_to_transform(const Vector7<S> &vec) {
   return pose;
 }
 
+template <typename S>
+Vector7<S> transform_to_posevec(const Transform3<S> &pose) {
+  Vector7<S> vec;
+  Quaternion<S> quat(pose.linear());
+  vec.head(3) = pose.translation();
+  vec.tail(4) << quat.w(), quat.x(), quat.y(), quat.z();
+  return vec;
+}
+
+template <typename S>
+Vector7<S> interpolate_posevec(const Vector7<S> &pose1, const Vector7<S> &pose2, S t) {
+  const Quaternion<S> quat1(pose1[3], pose1[4], pose1[5], pose1[6]);
+  const Quaternion<S> quat2(pose2[3], pose2[4], pose2[5], pose2[6]);
+  const auto quat = quat1.slerp(t, quat2);
+  Vector7<S> vec;
+  vec.head(3) = (1 - t) * pose1.head(3) + t * pose2.head(3);
+  vec.tail(4) << quat.w(), quat.x(), quat.y(), quat.z();
+  return vec;
+}
+
+template <typename S>
+std::pair<size_t, S> find_trajectory_segment(const VectorX<S> &times, S time) {
+  const size_t n = times.size();
+  if (time <= times[0]) return {0, 0};
+  if (time >= times[n - 1]) return {n - 1, 0};
+  // First time stamp after time, in [1, n - 1]
+  const size_t i =
+      std::upper_bound(times.data(), times.data() + n, time) - times.data();
+  return {i - 1, (time - times[i - 1]) / (times[i] - times[i - 1])};
+}
+
+template <typename S>
+VectorX<S> interpolate_trajectory(const VectorX<S> &times, const MatrixX<S> &values,
+                                  S time) {
+  const auto [i, t] = find_trajectory_segment(times, time);
+  if (t == 0) return values.row(i).transpose();
+  return ((1 - t) * values.row(i) + t * values.row(i + 1)).transpose();
+}
+
 }  // namespace mplib
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utility>
+
 #include "types.h"
 
 namespace mplib {
@@ -7,9 +9,47 @@ namespace mplib {
 template <typename S>
 Transform3<S> posevec_to_transform(const Vector7<S> &vec);
 
+template <typename S>
+Vector7<S> transform_to_posevec(const Transform3<S> &pose);
+
+/**
+ * @brief Interpolates between two poses [x, y, z, qw, qx, qy, qz]: linearly for
+ *  position and by slerp for orientation
+ */
+template <typename S>
+Vector7<S> interpolate_posevec(const Vector7<S> &pose1, const Vector7<S> &pose2, S t);
+
+/**
+ * @brief Finds the trajectory segment at given time. The trajectory is held constant
+ *  before the first and after the last time stamp.
+ * @param times: increasing time stamps
+ * @returns index i and fraction t such that the value at time interpolates between
+ *  time stamps i and i + 1 at t. If t is 0, it is the value at time stamp i (and
+ *  i + 1 may be out of range).
+ */
+template <typename S>
+std::pair<size_t, S> find_trajectory_segment(const VectorX<S> &times, S time);
+
+/**
+ * @brief Linearly interpolates a trajectory at given time. The trajectory is held
+ *  constant before the first and after the last time stamp.
+ * @param times: increasing time stamps
+ * @param values: value at each time stamp, [n_times, dim]
+ */
+template <typename S>
+VectorX<S> interpolate_trajectory(const VectorX<S> &times, const MatrixX<S> &values,
+                                  S time);
+
 // Explicit Template Instantiation Declaration ================================
-#define DECLARE_TEMPLATE_MATH_UTILS(S) \
-  extern template Transform3<S> posevec_to_transform(const Vector7<S> &vec)
+#define DECLARE_TEMPLATE_MATH_UTILS(S)                                          \
+  extern template Transform3<S> posevec_to_transform(const Vector7<S> &vec);    \
+  extern template Vector7<S> transform_to_posevec(const Transform3<S> &pose);   \
+  extern template Vector7<S> interpolate_posevec(const Vector7<S> &pose1,       \
+                                                 const Vector7<S> &pose2, S t); \
+  extern template std::pair<size_t, S> find_trajectory_segment(                 \
+      const VectorX<S> &times, S time);                                         \
+  extern template VectorX<S> interpolate_trajectory(const VectorX<S> &times,    \
+                                                    const MatrixX<S> &values, S time)
 
 DECLARE_TEMPLATE_MATH_UTILS(float);
 DECLARE_TEMPLATE_MATH_UTILS(double);
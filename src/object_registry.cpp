@@ -0,0 +1,68 @@
+#include "object_registry.h"
+
+namespace mplib {
+
+// Explicit Template Instantiation Definition =================================
+#define DEFINE_TEMPLATE_OBJECT_REGISTRY(S) template class ObjectRegistryTpl<S>
+
+DEFINE_TEMPLATE_OBJECT_REGISTRY(float);
+DEFINE_TEMPLATE_OBJECT_REGISTRY(double);
+
+template <typename S>
+ObjectHandle ObjectRegistryTpl<S>::add(const std::string &name,
+                                       const CollisionObjectPtr &object) {
+  if (auto it = handles_by_name_.find(name); it != handles_by_name_.end()) {
+    objects_[getIndex(it->second)] = object;
+    return it->second;
+  }
+
+  ObjectHandle handle;
+  if (!free_slots_.empty()) {
+    handle.index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    handle.index = slots_.size();
+    slots_.emplace_back();
+  }
+  auto &slot = slots_[handle.index];
+  handle.generation = slot.generation;
+  slot.dense_index = objects_.size();
+
+  objects_.push_back(object);
+  offsets_.push_back(Transform3<S>::Identity());
+  attached_.push_back(false);
+  handles_.push_back(handle);
+  names_.push_back(name);
+  handles_by_name_[name] = handle;
+  return handle;
+}
+
+template <typename S>
+bool ObjectRegistryTpl<S>::remove(const ObjectHandle &handle) {
+  if (!contains(handle)) return false;
+  auto &slot = slots_[handle.index];
+  const size_t index = slot.dense_index, last = objects_.size() - 1;
+  handles_by_name_.erase(names_[index]);
+
+  // Move the last element into the removed position
+  if (index != last) {
+    objects_[index] = std::move(objects_[last]);
+    offsets_[index] = offsets_[last];
+    attached_[index] = attached_[last];
+    handles_[index] = handles_[last];
+    names_[index] = std::move(names_[last]);
+    slots_[handles_[index].index].dense_index = index;
+  }
+  objects_.pop_back();
+  offsets_.pop_back();
+  attached_.pop_back();
+  handles_.pop_back();
+  names_.pop_back();
+
+  slot.dense_index = ObjectHandle::kInvalidIndex;
+  slot.generation++;
+  free_slots_.push_back(handle.index);
+  return true;
+}
+
+}  // namespace mplib
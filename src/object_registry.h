@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "macros_utils.h"
+#include "types.h"
+
+namespace mplib {
+
+/**
+ * @brief Stable handle to an object stored in an ObjectRegistry.
+ *  The generation is bumped every time a slot is reused, so a handle of a removed
+ *  object never refers to an object added later.
+ */
+struct ObjectHandle {
+  static constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+  uint32_t index {kInvalidIndex};
+  uint32_t generation {};
+
+  /// @brief Whether the handle was ever assigned (does not check for removal)
+  bool isSet() const { return index != kInvalidIndex; }
+
+  bool operator==(const ObjectHandle &other) const {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator!=(const ObjectHandle &other) const { return !(*this == other); }
+};
+
+// ObjectRegistryTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(ObjectRegistryTpl);
+
+/**
+ * @brief Slot map of named collision objects.
+ *  Objects and their metadata are stored contiguously (dense arrays, removal swaps
+ *  with the last element) and are addressed by stable ObjectHandle. Names are kept
+ *  in a side table and are only needed to look up handles.
+ */
+template <typename S>
+class ObjectRegistryTpl {
+ public:
+  // Common type alias
+  using CollisionObjectPtr = fcl::CollisionObjectPtr<S>;
+
+  /**
+   * @brief Adds an object with given name. If the name already exists, its object
+   *  is replaced and its handle and metadata are kept.
+   * @returns handle of the object
+   */
+  ObjectHandle add(const std::string &name, const CollisionObjectPtr &object);
+
+  /**
+   * @brief Removes the object with given handle
+   * @returns ``true`` if success, ``false`` if the handle is no longer valid
+   */
+  bool remove(const ObjectHandle &handle);
+
+  /// @brief Removes the object with given name
+  bool remove(const std::string &name) { return remove(getHandle(name)); }
+
+  /// @brief Gets the handle of object with given name, an unset handle if not found
+  ObjectHandle getHandle(const std::string &name) const {
+    auto it = handles_by_name_.find(name);
+    return it != handles_by_name_.end() ? it->second : ObjectHandle();
+  }
+
+  /// @brief Whether the handle refers to an object in the registry
+  bool contains(const ObjectHandle &handle) const {
+    return handle.index < slots_.size() &&
+           slots_[handle.index].generation == handle.generation &&
+           slots_[handle.index].dense_index != ObjectHandle::kInvalidIndex;
+  }
+
+  /// @brief Whether object with given name exists
+  bool contains(const std::string &name) const {
+    return handles_by_name_.find(name) != handles_by_name_.end();
+  }
+
+  /// @brief Number of objects in the registry
+  size_t size() const { return objects_.size(); }
+
+  /**
+   * @brief Gets the dense index of the object with given handle.
+   *  The dense index is invalidated by remove().
+   */
+  size_t getIndex(const ObjectHandle &handle) const {
+    ASSERT(contains(handle), "Invalid or stale object handle " +
+                                 std::to_string(handle.index) + ":" +
+                                 std::to_string(handle.generation));
+    return slots_[handle.index].dense_index;
+  }
+
+  // Dense arrays (indexed by dense index, in the same order) ==================
+  /// @brief Gets all objects
+  const std::vector<CollisionObjectPtr> &getObjects() const { return objects_; }
+
+  /// @brief Gets the names of all objects
+  const std::vector<std::string> &getNames() const { return names_; }
+
+  /// @brief Gets the handles of all objects
+  const std::vector<ObjectHandle> &getHandles() const { return handles_; }
+
+  /// @brief Gets the local offsets of all objects (see setOffset())
+  const std::vector<Transform3<S>> &getOffsets() const { return offsets_; }
+
+  /// @brief Whether the object at dense index is attached to an articulation
+  bool isAttached(size_t index) const { return attached_[index]; }
+
+  // Access by handle ==========================================================
+  const CollisionObjectPtr &getObject(const ObjectHandle &handle) const {
+    return objects_[getIndex(handle)];
+  }
+
+  const std::string &getName(const ObjectHandle &handle) const {
+    return names_[getIndex(handle)];
+  }
+
+  /// @brief Sets the local offset of the object (pose of object in its frame)
+  void setOffset(const ObjectHandle &handle, const Transform3<S> &offset) {
+    offsets_[getIndex(handle)] = offset;
+  }
+
+  /// @brief Sets whether the object is attached to an articulation
+  void setAttached(const ObjectHandle &handle, bool attached) {
+    attached_[getIndex(handle)] = attached;
+  }
+
+ private:
+  struct Slot {
+    uint32_t generation {};
+    uint32_t dense_index {ObjectHandle::kInvalidIndex};
+  };
+
+  // sparse slots addressed by ObjectHandle::index
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+
+  // dense storage
+  std::vector<CollisionObjectPtr> objects_;
+  std::vector<Transform3<S>> offsets_;
+  std::vector<uint8_t> attached_;
+  std::vector<ObjectHandle> handles_;
+  std::vector<std::string> names_;
+
+  // name side table
+  std::unordered_map<std::string, ObjectHandle> handles_by_name_;
+};
+
+// Common Type Alias ==========================================================
+using ObjectRegistryf = ObjectRegistryTpl<float>;
+using ObjectRegistryd = ObjectRegistryTpl<double>;
+using ObjectRegistryfPtr = ObjectRegistryTplPtr<float>;
+using ObjectRegistrydPtr = ObjectRegistryTplPtr<double>;
+
+// Explicit Template Instantiation Declaration ================================
+#define DECLARE_TEMPLATE_OBJECT_REGISTRY(S) extern template class ObjectRegistryTpl<S>
+
+DECLARE_TEMPLATE_OBJECT_REGISTRY(float);
+DECLARE_TEMPLATE_OBJECT_REGISTRY(double);
+
+}  // namespace mplib
@@ -1,6 +1,13 @@
 #include "ompl_planner.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <thread>
 
 #include <ompl/base/Planner.h>
 #include <ompl/base/goals/GoalStates.h>
@@ -16,6 +23,9 @@
 #include <ompl/geometric/planners/rrt/RRTstar.h>
 
 #include "macros_utils.h"
+#include "math_utils.h"
+#include "nearest_neighbors.h"
+#include "trace.h"
 
 namespace mplib::ompl {
 
@@ -24,6 +34,12 @@ namespace mplib::ompl {
   template std::vector<S> state2vector<S>(const ob::State *const &state_raw,   \
                                           const SpaceInformation *const &si_); \
   template class ValidityCheckerTpl<S>;                                        \
+  template class SweptMotionValidatorTpl<S>;                                   \
+  template class CertifiedMotionValidatorTpl<S>;                               \
+  template class TimedValidityCheckerTpl<S>;                                   \
+  template class TimedMotionValidatorTpl<S>;                                   \
+  template class TimedGoalTpl<S>;                                              \
+  template class BatchPlanResultTpl<S>;                                        \
   template class OMPLPlannerTpl<S>
 
 DEFINE_TEMPLATE_OMPL_PLANNER(float);
@@ -31,6 +47,42 @@ DEFINE_TEMPLATE_OMPL_PLANNER(double);
 
 #define PI 3.14159265359
 
+namespace {
+
+/// @brief Restores the time of a planning world (see setTime()) when out of scope
+template <typename S>
+class WorldTimeGuard {
+ public:
+  explicit WorldTimeGuard(PlanningWorldTpl<S> &world)
+      : world_(world), time_(world.getTime()) {}
+
+  ~WorldTimeGuard() { world_.setTime(time_); }
+
+  WorldTimeGuard(const WorldTimeGuard &) = delete;
+  WorldTimeGuard &operator=(const WorldTimeGuard &) = delete;
+
+ private:
+  PlanningWorldTpl<S> &world_;
+  S time_;
+};
+
+/**
+ * @brief Gets whether each state dimension of a CompoundStateSpace is an SO2 subspace
+ * @param num_ignored: number of trailing subspaces to ignore (e.g., time)
+ */
+std::vector<bool> get_so2_mask(const ob::StateSpacePtr &space, size_t num_ignored = 0) {
+  auto cs = space->as<CompoundStateSpace>();
+  std::vector<bool> ret;
+  for (size_t i = 0; i + num_ignored < cs->getSubspaceCount(); i++) {
+    auto subspace = cs->getSubspace(i);
+    const bool is_so2 = subspace->getType() == ob::STATE_SPACE_SO2;
+    for (size_t j = 0; j < subspace->getDimension(); j++) ret.push_back(is_so2);
+  }
+  return ret;
+}
+
+}  // namespace
+
 template <typename S>
 std::vector<S> state2vector(const ob::State *const &state_raw,
                             const SpaceInformation *const &si_) {
@@ -59,24 +111,480 @@ std::vector<S> state2vector(const ob::State *const &state_raw,
   return ret;
 }
 
+template <typename S>
+bool SweptMotionValidatorTpl<S>::checkMotion(const ob::State *s1,
+                                             const ob::State *s2) const {
+  ScopedPerfTimer timer(PerfCounter::MOTION_CHECK);
+  std::vector<ObjectHandle> candidates;
+  const auto states = sweep(s1, s2, candidates);
+  if (checkStates(states, candidates, false) < states.size()) {
+    invalid_++;
+    return false;
+  }
+  valid_++;
+  return true;
+}
+
+template <typename S>
+bool SweptMotionValidatorTpl<S>::checkMotion(
+    const ob::State *s1, const ob::State *s2,
+    std::pair<ob::State *, double> &last_valid) const {
+  ScopedPerfTimer timer(PerfCounter::MOTION_CHECK);
+  std::vector<ObjectHandle> candidates;
+  const auto states = sweep(s1, s2, candidates);
+  const auto first_invalid = checkStates(states, candidates, true);
+  if (first_invalid < states.size()) {
+    last_valid.second = static_cast<double>(first_invalid) / states.size();
+    if (last_valid.first != nullptr)
+      si_->getStateSpace()->interpolate(s1, s2, last_valid.second, last_valid.first);
+    invalid_++;
+    return false;
+  }
+  valid_++;
+  return true;
+}
+
+template <typename S>
+VectorX<S> SweptMotionValidatorTpl<S>::getJointMotion(const ob::State *s1,
+                                                      const ob::State *s2) const {
+  auto cs = si_->getStateSpace()->as<CompoundStateSpace>();
+  auto state1 = s1->as<ob::CompoundState>(), state2 = s2->as<ob::CompoundState>();
+  VectorX<S> ret(cs->getDimension());
+  for (size_t i = 0, k = 0; i < cs->getSubspaceCount(); i++) {
+    auto subspace = cs->getSubspace(i);
+    const auto dist = subspace->distance((*state1)[i], (*state2)[i]);
+    for (size_t j = 0; j < subspace->getDimension(); j++) ret[k++] = dist;
+  }
+  return ret;
+}
+
+template <typename S>
+std::vector<VectorX<S>> SweptMotionValidatorTpl<S>::sweep(
+    const ob::State *s1, const ob::State *s2,
+    std::vector<ObjectHandle> &candidates) const {
+  const auto &space = si_->getStateSpace();
+  world_->setQposAll(state2eigen<S>(s1, si_));
+  auto aabbs = world_->getPlannedAABBs();
+  // Along the motion, each body moves at most bounds.row(i).dot(joint motion)
+  if (static_cast<size_t>(bounds_.rows()) != aabbs.size())
+    bounds_ = world_->getDisplacementBounds();  // not computed for these bodies yet
+  const auto &bounds = bounds_;
+  const VectorX<S> margins = bounds * getJointMotion(s1, s2);
+
+  // By default, a joint that moves the bodies the most keeps the resolution of the
+  // longest valid segment length, and the other joints get a coarser one
+  S max_displacement = max_displacement_;
+  if (max_displacement <= 0 && bounds.size() > 0)
+    max_displacement = bounds.maxCoeff() * space->getLongestValidSegmentLength();
+  unsigned int nd = 1;
+  if (!margins.allFinite() || !std::isfinite(max_displacement))
+    nd = std::max(space->validSegmentCount(s1, s2), 1u);
+  else if (max_displacement > 0 && margins.size() > 0)
+    nd = std::max(
+        static_cast<unsigned int>(std::ceil(margins.maxCoeff() / max_displacement)),
+        1u);
+
+  std::vector<VectorX<S>> ret;
+  ret.reserve(nd);
+  auto state = si_->allocState();
+  for (unsigned int j = 1; j < nd; j++) {
+    space->interpolate(s1, s2, static_cast<double>(j) / nd, state);
+    ret.push_back(state2eigen<S>(state, si_));
+  }
+  si_->freeState(state);
+  ret.push_back(state2eigen<S>(s2, si_));
+
+  // A body is within margin / 2 of its pose at s1 or at s2 (whichever is closer)
+  world_->setQposAll(ret.back());
+  const auto aabbs2 = world_->getPlannedAABBs();
+  for (size_t i = 0; i < aabbs.size(); i++) {
+    // An unbounded body (e.g., far from a prismatic joint) overlaps everything
+    const S margin = std::isfinite(margins[i]) ? margins[i] / 2
+                                               : std::numeric_limits<S>::max() / 4;
+    (aabbs[i] += aabbs2[i]).expand(Vector3<S>::Constant(margin));
+  }
+  candidates = world_->getSceneObjectsOverlapping(aabbs);
+  return ret;
+}
+
+template <typename S>
+size_t SweptMotionValidatorTpl<S>::checkStates(
+    const std::vector<VectorX<S>> &states, const std::vector<ObjectHandle> &candidates,
+    bool find_first) const {
+  const size_t n = states.size();
+  size_t first_invalid = n;
+  auto check = [&](size_t i) {
+    if (i >= first_invalid) return true;  // an earlier state is already invalid
+    // The planning world is already at the end state
+    if (i + 1 < n) world_->setQposAll(states[i]);
+    if (!world_->collide(candidates)) return true;
+    first_invalid = i;
+    return find_first;
+  };
+
+  // End state first, then bisect the unchecked index ranges [lo, hi) breadth-first
+  if (!check(n - 1)) return first_invalid;
+  std::deque<std::pair<size_t, size_t>> ranges {{0, n - 1}};
+  while (!ranges.empty()) {
+    const auto [lo, hi] = ranges.front();
+    ranges.pop_front();
+    if (lo >= hi) continue;
+    const size_t mid = lo + (hi - lo) / 2;
+    if (!check(mid)) return first_invalid;
+    ranges.emplace_back(lo, mid);
+    ranges.emplace_back(mid + 1, hi);
+  }
+  return first_invalid;
+}
+
+template <typename S>
+CertifiedMotionValidatorTpl<S>::CertifiedMotionValidatorTpl(
+    const PlanningWorldTplPtr<S> &world, const SpaceInformationPtr &si,
+    const ob::MotionValidatorPtr &fallback)
+    : ob::MotionValidator(si),
+      world_(world),
+      fallback_(fallback),
+      is_so2_(get_so2_mask(si->getStateSpace())) {}
+
+template <typename S>
+bool CertifiedMotionValidatorTpl<S>::checkMotion(const ob::State *s1,
+                                                 const ob::State *s2) const {
+  double invalid_fraction;
+  const auto certificate =
+      certify(state2eigen<S>(s1, si_), state2eigen<S>(s2, si_), invalid_fraction);
+  const bool valid = certificate == Certificate::UNCERTAIN
+                         ? fallback_->checkMotion(s1, s2)
+                         : certificate == Certificate::VALID;
+  valid ? valid_++ : invalid_++;
+  return valid;
+}
+
+template <typename S>
+bool CertifiedMotionValidatorTpl<S>::checkMotion(
+    const ob::State *s1, const ob::State *s2,
+    std::pair<ob::State *, double> &last_valid) const {
+  double invalid_fraction;
+  const auto certificate =
+      certify(state2eigen<S>(s1, si_), state2eigen<S>(s2, si_), invalid_fraction);
+  if (certificate == Certificate::VALID ||
+      (certificate == Certificate::UNCERTAIN &&
+       fallback_->checkMotion(s1, s2, last_valid))) {
+    valid_++;
+    return true;
+  }
+  if (certificate == Certificate::INVALID)
+    findLastValid(s1, s2, invalid_fraction, last_valid);
+  invalid_++;
+  return false;
+}
+
+template <typename S>
+void CertifiedMotionValidatorTpl<S>::findLastValid(
+    const ob::State *s1, const ob::State *s2, double invalid_fraction,
+    std::pair<ob::State *, double> &last_valid) const {
+  if (invalid_fraction <= 0) {
+    if (last_valid.first) si_->copyState(last_valid.first, s1);
+    last_valid.second = 0;
+    return;
+  }
+  // The first invalid state is before the invalid state found
+  auto state = si_->allocState();
+  si_->getStateSpace()->interpolate(s1, s2, invalid_fraction, state);
+  const bool valid = fallback_->checkMotion(s1, state, last_valid);
+  si_->freeState(state);
+  if (!valid)
+    last_valid.second *= invalid_fraction;
+  else  // the interpolated state differs from the bisected one by rounding
+    fallback_->checkMotion(s1, s2, last_valid);
+}
+
+template <typename S>
+typename CertifiedMotionValidatorTpl<S>::Certificate
+CertifiedMotionValidatorTpl<S>::certify(const VectorX<S> &start, const VectorX<S> &goal,
+                                        double &invalid_fraction) const {
+  ScopedPerfTimer timer(PerfCounter::MOTION_CERTIFICATE);
+  // Zero clearance gives no bubble to certify, leave the motion to the fallback
+  auto get_certificate = [](bool valid, const Clearance &clearance) {
+    if (!valid) return Certificate::INVALID;
+    return clearance.others > 0 && clearance.self > 0 ? Certificate::VALID
+                                                      : Certificate::UNCERTAIN;
+  };
+  Clearance start_clearance, goal_clearance;
+  invalid_fraction = 0;
+  auto certificate = get_certificate(computeClearance(start, start_clearance),
+                                     start_clearance);
+  if (certificate != Certificate::VALID) return certificate;
+  // The bounds do not depend on the configuration, see updateDisplacementBounds()
+  if (bounds_.cols() != start.size()) bounds_ = world_->getDisplacementBounds();
+
+  // Self-collision distance can shrink by the motion of both bodies
+  auto is_certified = [](S motion, const Clearance &c1, const Clearance &c2) {
+    return motion < c1.others + c2.others && 2 * motion < c1.self + c2.self;
+  };
+
+  // Goal inside the bubble of start
+  const S motion = getMotionBound(getDelta(start, goal));
+  if (is_certified(motion, start_clearance, {})) return Certificate::VALID;
+  invalid_fraction = 1;
+  certificate = get_certificate(computeClearance(goal, goal_clearance), goal_clearance);
+  if (certificate != Certificate::VALID) return certificate;
+
+  struct Segment {
+    VectorX<S> a, b;
+    Clearance clearance_a, clearance_b;
+    double fraction_a, fraction_b;  // fractions of the motion at a and b
+  };
+  const S resolution = si_->getStateSpace()->getLongestValidSegmentLength();
+  // Same default as SweptMotionValidator
+  S max_displacement = max_displacement_;
+  if (max_displacement <= 0 && bounds_.size() > 0)
+    max_displacement = bounds_.maxCoeff() * resolution;
+  // Bisect breadth-first (van der Corput order)
+  std::deque<Segment> segments {
+      {start, goal, start_clearance, goal_clearance, 0.0, 1.0}};
+  while (!segments.empty()) {
+    auto segment = std::move(segments.front());
+    segments.pop_front();
+    const VectorX<S> delta = getDelta(segment.a, segment.b);
+    const S motion = getMotionBound(delta);
+    if (is_certified(motion, segment.clearance_a, segment.clearance_b)) continue;
+    // Each joint is a 1-D subspace with weight 1, so the distance is the L1 norm
+    const bool at_resolution = std::isfinite(max_displacement)
+                                   ? motion <= max_displacement
+                                   : delta.cwiseAbs().sum() <= resolution;
+    if (at_resolution) continue;
+
+    VectorX<S> mid = segment.a + delta / 2;
+    for (size_t i = 0; i < is_so2_.size(); i++)
+      if (is_so2_[i]) {
+        if (mid[i] > PI)
+          mid[i] -= 2 * PI;
+        else if (mid[i] < -PI)
+          mid[i] += 2 * PI;
+      }
+    Clearance mid_clearance;
+    invalid_fraction = (segment.fraction_a + segment.fraction_b) / 2;
+    certificate = get_certificate(computeClearance(mid, mid_clearance), mid_clearance);
+    if (certificate != Certificate::VALID) return certificate;
+    segments.push_back({segment.a, mid, segment.clearance_a, mid_clearance,
+                        segment.fraction_a, invalid_fraction});
+    segments.push_back({mid, segment.b, mid_clearance, segment.clearance_b,
+                        invalid_fraction, segment.fraction_b});
+  }
+  return Certificate::VALID;
+}
+
+template <typename S>
+bool CertifiedMotionValidatorTpl<S>::computeClearance(const VectorX<S> &state,
+                                                      Clearance &clearance) const {
+  world_->setQposAll(state);
+  clearance.others = world_->distanceOthers().min_distance;
+  clearance.self = world_->distanceSelf().min_distance;
+  if (clearance.others > 0 && clearance.self > 0) return true;
+  // Touching or penetrating, let collision checking decide
+  clearance.others = std::max<S>(clearance.others, 0);
+  clearance.self = std::max<S>(clearance.self, 0);
+  return !world_->collide();
+}
+
+template <typename S>
+S CertifiedMotionValidatorTpl<S>::getMotionBound(const VectorX<S> &delta) const {
+  if (bounds_.rows() == 0) return 0;
+  return (bounds_ * delta.cwiseAbs()).maxCoeff();
+}
+
+template <typename S>
+VectorX<S> CertifiedMotionValidatorTpl<S>::getDelta(const VectorX<S> &a,
+                                                    const VectorX<S> &b) const {
+  VectorX<S> delta = b - a;
+  for (size_t i = 0; i < is_so2_.size(); i++)
+    if (is_so2_[i]) {
+      if (delta[i] > PI)
+        delta[i] -= 2 * PI;
+      else if (delta[i] < -PI)
+        delta[i] += 2 * PI;
+    }
+  return delta;
+}
+
+template <typename S>
+TimedMotionValidatorTpl<S>::TimedMotionValidatorTpl(const SpaceInformationPtr &si,
+                                                    const VectorX<S> &velocity_limits)
+    : ob::MotionValidator(si),
+      velocity_limits_(velocity_limits),
+      is_so2_(get_so2_mask(si->getStateSpace(), 1)) {  // the last subspace is time
+  ASSERT(static_cast<size_t>(velocity_limits.size()) == is_so2_.size(),
+         "Length of velocity limits and joint dimension should be equal");
+}
+
+template <typename S>
+bool TimedMotionValidatorTpl<S>::checkMotion(const ob::State *s1,
+                                             const ob::State *s2) const {
+  ScopedPerfTimer timer(PerfCounter::MOTION_CHECK);
+  bool valid = isFeasible(s1, s2) && si_->isValid(s2);  // end state first
+  if (valid) {
+    const auto space = si_->getStateSpace();
+    const unsigned int count = space->validSegmentCount(s1, s2);
+    auto state = si_->allocState();
+    for (unsigned int k = 1; k < count && valid; k++) {
+      space->interpolate(s1, s2, static_cast<double>(k) / count, state);
+      valid = si_->isValid(state);
+    }
+    si_->freeState(state);
+  }
+  valid ? valid_++ : invalid_++;
+  return valid;
+}
+
+template <typename S>
+bool TimedMotionValidatorTpl<S>::checkMotion(
+    const ob::State *s1, const ob::State *s2,
+    std::pair<ob::State *, double> &last_valid) const {
+  ScopedPerfTimer timer(PerfCounter::MOTION_CHECK);
+  if (!isFeasible(s1, s2)) {
+    if (last_valid.first) si_->copyState(last_valid.first, s1);
+    last_valid.second = 0;
+    invalid_++;
+    return false;
+  }
+
+  const auto space = si_->getStateSpace();
+  const unsigned int count = space->validSegmentCount(s1, s2);
+  auto state = si_->allocState();
+  for (unsigned int k = 1; k <= count; k++) {
+    space->interpolate(s1, s2, static_cast<double>(k) / count, state);
+    if (!si_->isValid(state)) {
+      last_valid.second = static_cast<double>(k - 1) / count;
+      if (last_valid.first)
+        space->interpolate(s1, s2, last_valid.second, last_valid.first);
+      si_->freeState(state);
+      invalid_++;
+      return false;
+    }
+  }
+  si_->freeState(state);
+  valid_++;
+  return true;
+}
+
+template <typename S>
+bool TimedMotionValidatorTpl<S>::isFeasible(const ob::State *s1,
+                                            const ob::State *s2) const {
+  const auto a = state2eigen<S>(s1, si_), b = state2eigen<S>(s2, si_);
+  const auto dim = is_so2_.size();
+  const S dt = b[dim] - a[dim];
+  if (dt <= 0) return false;
+  for (size_t i = 0; i < dim; i++) {
+    S delta = std::abs(b[i] - a[i]);
+    if (is_so2_[i] && delta > PI) delta = 2 * PI - delta;
+    if (delta > velocity_limits_[i] * dt) return false;
+  }
+  return true;
+}
+
+template <typename S>
+TimedGoalTpl<S>::TimedGoalTpl(const SpaceInformationPtr &si,
+                              const std::vector<VectorX<S>> &goals, S min_time,
+                              S max_time)
+    : ob::GoalSampleableRegion(si),
+      goals_(goals),
+      min_time_(min_time),
+      max_time_(max_time),
+      is_so2_(get_so2_mask(si->getStateSpace(), 1)) {  // the last subspace is time
+  ASSERT(!goals.empty(), "At least one goal state is required");
+}
+
+template <typename S>
+void TimedGoalTpl<S>::sampleGoal(ob::State *state_raw) const {
+  const auto &goal = goals_[rng_.uniformInt(0, goals_.size() - 1)];
+  std::vector<double> values = eigen2vector<S, double>(goal);
+  values.push_back(rng_.uniformReal(min_time_, max_time_));
+
+  auto state = state_raw->as<ob::CompoundState>();
+  auto cs = si_->getStateSpace()->as<CompoundStateSpace>();
+  size_t k = 0;
+  for (size_t i = 0; i < cs->getSubspaceCount(); i++) {
+    auto subspace = cs->getSubspace(i);
+    switch (subspace->getType()) {
+      case ob::STATE_SPACE_REAL_VECTOR:
+        for (size_t j = 0; j < subspace->getDimension(); j++)
+          (*state)[i]->as<ob::RealVectorStateSpace::StateType>()->values[j] =
+              values[k++];
+        break;
+      case ob::STATE_SPACE_SO2:
+        (*state)[i]->as<ob::SO2StateSpace::StateType>()->value = values[k++];
+        break;
+      default:
+        throw std::invalid_argument("Unhandled subspace type.");
+        break;
+    }
+  }
+}
+
+template <typename S>
+double TimedGoalTpl<S>::distanceGoal(const ob::State *state_raw) const {
+  const auto state = state2eigen<S>(state_raw, si_.get());
+  const VectorX<S> qpos = state.head(state.size() - 1);
+  double ret = std::numeric_limits<double>::infinity();
+  // Each joint is a 1-D subspace with weight 1, so the distance is the L1 norm
+  for (const auto &goal : goals_) {
+    VectorX<S> delta = (qpos - goal).cwiseAbs();
+    for (size_t i = 0; i < is_so2_.size(); i++)
+      if (is_so2_[i] && delta[i] > PI) delta[i] = 2 * PI - delta[i];
+    ret = std::min(ret, static_cast<double>(delta.sum()));
+  }
+  return ret;
+}
+
+template <typename S>
+bool TimedGoalTpl<S>::isSatisfied(const ob::State *state_raw, double *distance) const {
+  const auto state = state2eigen<S>(state_raw, si_.get());
+  if (state[state.size() - 1] < min_time_) {
+    if (distance) *distance = std::numeric_limits<double>::infinity();
+    return false;
+  }
+  return ob::GoalRegion::isSatisfied(state_raw, distance);
+}
+
 template <typename S>
 OMPLPlannerTpl<S>::OMPLPlannerTpl(const PlanningWorldTplPtr<S> &world) : world_(world) {
   build_state_space();
   si_ = std::make_shared<SpaceInformation>(cs_);
   valid_checker_ = std::make_shared<ValidityCheckerTpl<S>>(world, si_);
   si_->setStateValidityChecker(valid_checker_);
+  swept_validator_ = std::make_shared<SweptMotionValidatorTpl<S>>(world, si_);
+  certified_validator_ =
+      std::make_shared<CertifiedMotionValidatorTpl<S>>(world, si_, swept_validator_);
+  si_->setMotionValidator(swept_validator_);
 
   pdef_ = std::make_shared<ProblemDefinition>(si_);
 }
 
+template <typename S>
+void OMPLPlannerTpl<S>::setMaxDisplacement(S max_displacement) {
+  max_displacement_ = max_displacement;
+  swept_validator_->setMaxDisplacement(max_displacement);
+  certified_validator_->setMaxDisplacement(max_displacement);
+}
+
+template <typename S>
+void OMPLPlannerTpl<S>::setMotionValidator(MotionValidatorType type) {
+  motion_validator_type_ = type;
+  if (type == MotionValidatorType::CERTIFIED)
+    si_->setMotionValidator(certified_validator_);
+  else
+    si_->setMotionValidator(swept_validator_);
+}
+
 template <typename S>
 VectorX<S> OMPLPlannerTpl<S>::random_sample_nearby(
-    const VectorX<S> &start_state) const {
+    const VectorX<S> &start_state, const std::vector<bool> &fixed_joints) const {
   int cnt = 0;
   while (true) {
     S ratio = (S)(cnt + 1) / 1000;
     VectorX<S> new_state = start_state;
     for (size_t i = 0; i < dim_; i++) {
+      if (!fixed_joints.empty() && fixed_joints[i]) continue;
       S r = (S)rand() / RAND_MAX * 2 - 1;
       new_state[i] += (upper_joint_limits_[i] - lower_joint_limits_[i]) * ratio * r;
       if (new_state[i] < lower_joint_limits_[i])
@@ -98,50 +606,81 @@ template <typename S>
 std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::plan(
     const VectorX<S> &start_state, const std::vector<VectorX<S>> &goal_states,
     const std::string &planner_name, double time, double range, double goal_bias,
-    double pathlen_obj_weight, bool pathlen_obj_only, bool verbose) const {
+    double pathlen_obj_weight, bool pathlen_obj_only, bool verbose,
+    const std::vector<bool> &fixed_joints) const {
   ASSERT(start_state.rows() == goal_states[0].rows(),
          "Length of start state and goal state should be equal");
   ASSERT(static_cast<size_t>(start_state.rows()) == dim_,
          "Length of start state and problem dimension should be equal");
+  ASSERT(fixed_joints.empty() || fixed_joints.size() == dim_,
+         "Length of fixed joints mask and problem dimension should be equal");
   if (verbose == false) ::ompl::msg::noOutputHandler();
+  MPLIB_TRACE_SPAN("plan");
+  const auto begin_counts = PerfCounters::getThread();
 
-  ob::ScopedState<> start(cs_);
-  start = eigen2vector<S, double>(start_state);
+  // Plan in the subspace of joints that are not fixed
+  std::vector<size_t> free_joints;
+  for (size_t i = 0; i < dim_; i++)
+    if (fixed_joints.empty() || !fixed_joints[i]) free_joints.push_back(i);
+  const size_t dim = free_joints.size();
+  ASSERT(dim > 0, "At least one joint should not be fixed");
+  const bool masked = dim < dim_;
+  if (masked) {
+    if (!masked_space_built_ || free_joints != masked_free_joints_)
+      build_masked_state_space(free_joints);
+    masked_valid_checker_->setFixedState(start_state);
+  }
+  // The planned bodies may have changed (e.g., attached) since the last call
+  swept_validator_->updateDisplacementBounds();
+  certified_validator_->updateDisplacementBounds();
+  const auto &cs = masked ? masked_cs_ : cs_;
+  const auto &si = masked ? masked_si_ : si_;
+  const auto pdef = masked ? std::make_shared<ProblemDefinition>(si) : pdef_;
+  auto reduce = [&free_joints](const VectorX<S> &state) {
+    VectorX<S> ret(free_joints.size());
+    for (size_t j = 0; j < free_joints.size(); j++) ret[j] = state[free_joints[j]];
+    return ret;
+  };
+
+  ob::ScopedState<> start(cs);
+  start = eigen2vector<S, double>(reduce(start_state));
 
   bool invalid_start = !valid_checker_->_isValid(start_state);
   if (invalid_start) {
     std::cout << "invalid start state!! (collision)" << std::endl;
-    VectorX<S> new_start_state = random_sample_nearby(start_state);
-    start = eigen2vector<S, double>(new_start_state);
+    // Fixed joints stay at the start state in the reduced problem
+    VectorX<S> new_start_state = random_sample_nearby(start_state, fixed_joints);
+    start = eigen2vector<S, double>(reduce(new_start_state));
   }
 
-  auto goals = std::make_shared<ob::GoalStates>(si_);
+  auto goals = std::make_shared<ob::GoalStates>(si);
 
   int tot_enum_states = 1, tot_goal_state = 0;
-  for (size_t i = 0; i < dim_; i++) tot_enum_states *= 3;
+  for (size_t i = 0; i < dim; i++) tot_enum_states *= 3;
 
   for (size_t ii = 0; ii < goal_states.size(); ii++)
     for (int i = 0; i < tot_enum_states; i++) {
       std::vector<double> tmp_state;
       int tmp = i;
       bool flag = true;
-      for (size_t j = 0; j < dim_; j++) {
-        tmp_state.push_back(goal_states[ii](j));
+      for (size_t j = 0; j < dim; j++) {
+        const auto k = free_joints[j];
+        tmp_state.push_back(goal_states[ii](k));
         int dir = tmp % 3;
         tmp /= 3;
-        if (dir != 0 && is_revolute_[j] == false) {
+        if (dir != 0 && is_revolute_[k] == false) {
           flag = false;
           break;
         }
         if (dir == 1) {
-          if (tmp_state[j] - 2 * PI > lower_joint_limits_[j])
+          if (tmp_state[j] - 2 * PI > lower_joint_limits_[k])
             tmp_state[j] -= 2 * PI;
           else {
             flag = false;
             break;
           }
         } else if (dir == 2) {
-          if (tmp_state[j] + 2 * PI < upper_joint_limits_[j])
+          if (tmp_state[j] + 2 * PI < upper_joint_limits_[k])
             tmp_state[j] += 2 * PI;
           else {
             flag = false;
@@ -150,7 +689,7 @@ std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::plan(
         }
       }
       if (flag) {
-        ob::ScopedState<> goal(cs_);
+        ob::ScopedState<> goal(cs);
         goal = tmp_state;
         goals->addState(goal);
         tot_goal_state += 1;
@@ -158,92 +697,341 @@ std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::plan(
     }
   if (verbose) std::cout << "number of goal state: " << tot_goal_state << std::endl;
 
-  pdef_->clearStartStates();
-  pdef_->clearGoal();
-  pdef_->clearSolutionPaths();
-  pdef_->clearSolutionNonExistenceProof();
+  pdef->clearStartStates();
+  pdef->clearGoal();
+  pdef->clearSolutionPaths();
+  pdef->clearSolutionNonExistenceProof();
   // pdef->setStartAndGoalStates(start, goal);
-  pdef_->setGoal(goals);
-  pdef_->addStartState(start);
+  pdef->setGoal(goals);
+  pdef->addStartState(start);
+  // Replaces the default nearest neighbors of tree-based planners
+  auto set_nearest_neighbors = [this, &cs](const auto &tree_planner) {
+    if (!linear_nearest_neighbors_) return;
+    LinearNearestNeighborsScope scope(*cs);
+    tree_planner->template setNearestNeighbors<LinearNearestNeighbors>();
+  };
   ob::PlannerPtr planner;
   if (planner_name == "RRTConnect") {
-    auto rrt_connect = std::make_shared<og::RRTConnect>(si_);
+    auto rrt_connect = std::make_shared<og::RRTConnect>(si);
     if (range > 1E-6) rrt_connect->setRange(range);
+    set_nearest_neighbors(rrt_connect);
     planner = rrt_connect;
   } else if (planner_name == "RRT") {
-    auto rrt = std::make_shared<og::RRT>(si_);
+    auto rrt = std::make_shared<og::RRT>(si);
     if (range > 1E-6) rrt->setRange(range);
     rrt->setGoalBias(goal_bias);
+    set_nearest_neighbors(rrt);
     planner = rrt;
   } else {
     // Create optimization objective
-    auto length_objective = std::make_shared<ob::PathLengthOptimizationObjective>(si_);
-    auto clear_objective = std::make_shared<ob::MaximizeMinClearanceObjective>(si_);
+    auto length_objective = std::make_shared<ob::PathLengthOptimizationObjective>(si);
+    auto clear_objective = std::make_shared<ob::MaximizeMinClearanceObjective>(si);
     if (pathlen_obj_only)
-      pdef_->setOptimizationObjective(length_objective);
+      pdef->setOptimizationObjective(length_objective);
     else
-      pdef_->setOptimizationObjective(pathlen_obj_weight * length_objective +
-                                      clear_objective);
+      pdef->setOptimizationObjective(pathlen_obj_weight * length_objective +
+                                     clear_objective);
     if (planner_name == "PRMstar")
-      planner = std::make_shared<og::PRMstar>(si_);
+      planner = std::make_shared<og::PRMstar>(si);
     else if (planner_name == "LazyPRMstar") {
-      auto lazy_prm_star = std::make_shared<og::LazyPRMstar>(si_);
+      auto lazy_prm_star = std::make_shared<og::LazyPRMstar>(si);
       if (range > 1E-6) lazy_prm_star->setRange(range);
       planner = lazy_prm_star;
     } else if (planner_name == "RRTstar") {
-      auto rrt_star = std::make_shared<og::RRTstar>(si_);
+      auto rrt_star = std::make_shared<og::RRTstar>(si);
       if (range > 1E-6) rrt_star->setRange(range);
       rrt_star->setGoalBias(goal_bias);
+      set_nearest_neighbors(rrt_star);
       planner = rrt_star;
     } else if (planner_name == "RRTsharp") {
-      auto rrt_sharp = std::make_shared<og::RRTsharp>(si_);
+      auto rrt_sharp = std::make_shared<og::RRTsharp>(si);
       if (range > 1E-6) rrt_sharp->setRange(range);
       rrt_sharp->setGoalBias(goal_bias);
+      set_nearest_neighbors(rrt_sharp);
       planner = rrt_sharp;
     } else if (planner_name == "RRTXstatic") {
-      auto rrtx_static = std::make_shared<og::RRTXstatic>(si_);
+      auto rrtx_static = std::make_shared<og::RRTXstatic>(si);
       if (range > 1E-6) rrtx_static->setRange(range);
       rrtx_static->setGoalBias(goal_bias);
+      set_nearest_neighbors(rrtx_static);
       planner = rrtx_static;
     } else if (planner_name == "InformedRRTstar") {
-      auto informed_rrt_star = std::make_shared<og::InformedRRTstar>(si_);
+      auto informed_rrt_star = std::make_shared<og::InformedRRTstar>(si);
       if (range > 1E-6) informed_rrt_star->setRange(range);
       informed_rrt_star->setGoalBias(goal_bias);
+      set_nearest_neighbors(informed_rrt_star);
       planner = informed_rrt_star;
     } else
       throw std::runtime_error("Planner Not implemented");
   }
 
-  planner->setProblemDefinition(pdef_);
-  planner->setup();
+  planner->setProblemDefinition(pdef);
+  {
+    MPLIB_TRACE_SPAN("planner_setup");
+    planner->setup();
+  }
   if (verbose) std::cout << "OMPL setup" << std::endl;
-  ob::PlannerStatus solved = planner->ob::Planner::solve(time);
+  ob::PlannerStatus solved;
+  {
+    MPLIB_TRACE_SPAN("solve");
+    solved = planner->ob::Planner::solve(time);
+  }
   if (solved) {
+    MPLIB_TRACE_SPAN("path_conversion");
     if (verbose) std::cout << "Solved!" << std::endl;
-    ob::PathPtr path = pdef_->getSolutionPath();
+    ob::PathPtr path = pdef->getSolutionPath();
     auto geo_path = std::dynamic_pointer_cast<og::PathGeometric>(path);
     size_t len = geo_path->getStateCount();
     MatrixX<S> ret(len + invalid_start, dim_);
-    if (verbose) std::cout << "Result size " << len << " " << dim_ << std::endl;
-    if (invalid_start) {
-      for (size_t j = 0; j < dim_; j++) ret(0, j) = start_state(j);
-    }
+    if (verbose) std::cout << "Result size " << len << " " << dim << std::endl;
+    // Fixed joints stay at their start values
+    ret.rowwise() = start_state.transpose();
     for (size_t i = 0; i < len; i++) {
-      auto res_i = state2eigen<S>(geo_path->getState(i), si_.get());
+      auto res_i = state2eigen<S>(geo_path->getState(i), si.get());
       // std::cout << "Size_i " << res_i.rows() << std::endl;
-      ASSERT(static_cast<size_t>(res_i.rows()) == dim_,
+      ASSERT(static_cast<size_t>(res_i.rows()) == dim,
              "Result dimension is not correct!");
-      for (size_t j = 0; j < dim_; j++) ret(invalid_start + i, j) = res_i[j];
+      for (size_t j = 0; j < dim; j++)
+        ret(invalid_start + i, free_joints[j]) = res_i[j];
     }
+    last_plan_counts_ = PerfCounters::getThread() - begin_counts;
     return std::make_pair(solved.asString(), ret);
   } else {
     MatrixX<S> ret(0, dim_);
+    last_plan_counts_ = PerfCounters::getThread() - begin_counts;
     return std::make_pair(solved.asString(), ret);
   }
 }
 
+template <typename S>
+std::vector<BatchPlanResultTpl<S>> OMPLPlannerTpl<S>::planBatch(
+    const std::vector<VectorX<S>> &start_states,
+    const std::vector<std::vector<VectorX<S>>> &goal_sets,
+    const BatchPlanOptions &options) const {
+  ASSERT(start_states.size() == 1 || start_states.size() == goal_sets.size(),
+         "Expected one start state or one start state per goal set");
+  for (const auto &goals : goal_sets)
+    ASSERT(!goals.empty(), "Each goal set should have at least one goal state");
+
+  std::vector<BatchPlanResultTpl<S>> ret(goal_sets.size());
+  if (goal_sets.empty()) return ret;
+  size_t num_threads = options.num_threads;
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_threads = std::min(num_threads, goal_sets.size());
+
+  std::atomic<size_t> next_query {0};
+  std::vector<std::exception_ptr> errors(num_threads);
+  auto worker = [&](size_t thread_id) {
+    try {
+      // plan() keeps its problem definition in the planner, so each worker needs
+      // its own planner (and world, whose state is set by validity checking)
+      OMPLPlannerTpl<S> planner(world_->clone());
+      planner.setMaxDisplacement(max_displacement_);
+      planner.setMotionValidator(motion_validator_type_);
+      planner.setLinearNearestNeighbors(linear_nearest_neighbors_);
+      for (size_t i; (i = next_query++) < goal_sets.size();) {
+        const auto begin = std::chrono::steady_clock::now();
+        auto [status, path] = planner.plan(
+            start_states[start_states.size() == 1 ? 0 : i], goal_sets[i],
+            options.planner_name, options.time, options.range, options.goal_bias,
+            options.pathlen_obj_weight, options.pathlen_obj_only);
+        auto &result = ret[i];
+        result.planning_time = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - begin)
+                                   .count();
+        result.success = status == "Exact solution";
+        if (path.rows() > 1)
+          result.path_length = (path.bottomRows(path.rows() - 1) -
+                                path.topRows(path.rows() - 1))
+                                   .rowwise()
+                                   .norm()
+                                   .sum();
+        result.status = std::move(status);
+        result.path = std::move(path);
+        result.thread_id = thread_id;
+        result.perf_counts = planner.getLastPlanCounts();
+      }
+    } catch (...) {
+      errors[thread_id] = std::current_exception();
+      next_query = goal_sets.size();  // stops the other workers
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) threads.emplace_back(worker, i);
+  worker(0);
+  for (auto &thread : threads) thread.join();
+  for (const auto &error : errors)
+    if (error) std::rethrow_exception(error);
+  return ret;
+}
+
+template <typename S>
+std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::planWithTime(
+    const VectorX<S> &start_state, S start_time,
+    const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+    S max_duration, const std::string &planner_name, double time, double range,
+    bool verbose) const {
+  return plan_with_time(start_state, start_time, goal_states, velocity_limits,
+                        max_duration, start_time, planner_name, time, range, verbose);
+}
+
+template <typename S>
+std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::plan_with_time(
+    const VectorX<S> &start_state, S start_time,
+    const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+    S max_duration, S min_goal_time, const std::string &planner_name, double time,
+    double range, bool verbose) const {
+  ASSERT(static_cast<size_t>(start_state.rows()) == dim_,
+         "Length of start state and problem dimension should be equal");
+  for (const auto &goal_state : goal_states)
+    ASSERT(start_state.rows() == goal_state.rows(),
+           "Length of start state and goal state should be equal");
+  ASSERT(max_duration > 0, "Maximum duration should be positive");
+  ASSERT(min_goal_time >= start_time && min_goal_time <= start_time + max_duration,
+         "Earliest goal time should be within the maximum duration");
+  if (verbose == false) ::ompl::msg::noOutputHandler();
+
+  // Joint subspaces followed by a time subspace
+  auto space = std::make_shared<CompoundStateSpace>();
+  for (size_t i = 0; i < cs_->getSubspaceCount(); i++)
+    space->addSubspace(cs_->getSubspace(i), cs_->getSubspaceWeight(i));
+  auto time_space = std::make_shared<ob::RealVectorStateSpace>(1);
+  time_space->setBounds(start_time, start_time + max_duration);
+  space->addSubspace(time_space, 1.0);
+
+  auto si = std::make_shared<SpaceInformation>(space);
+  auto valid_checker = std::make_shared<TimedValidityCheckerTpl<S>>(world_, si);
+  si->setStateValidityChecker(valid_checker);
+  si->setMotionValidator(
+      std::make_shared<TimedMotionValidatorTpl<S>>(si, velocity_limits));
+  si->setup();
+
+  // Validity checking moves dynamic objects, restore them even on exceptions
+  WorldTimeGuard<S> time_guard(*world_);
+  VectorX<S> start_vec(dim_ + 1);
+  start_vec << start_state, start_time;
+  ASSERT(valid_checker->_isValid(start_vec), "Start state is in collision");
+  ob::ScopedState<> start(space);
+  start = eigen2vector<S, double>(start_vec);
+
+  auto pdef = std::make_shared<ProblemDefinition>(si);
+  pdef->addStartState(start);
+  pdef->setGoal(std::make_shared<TimedGoalTpl<S>>(si, goal_states, min_goal_time,
+                                                  start_time + max_duration));
+
+  ob::PlannerPtr planner;
+  if (planner_name == "RRTConnect") {
+    auto rrt_connect = std::make_shared<og::RRTConnect>(si);
+    if (range > 1E-6) rrt_connect->setRange(range);
+    planner = rrt_connect;
+  } else if (planner_name == "RRT") {
+    auto rrt = std::make_shared<og::RRT>(si);
+    if (range > 1E-6) rrt->setRange(range);
+    planner = rrt;
+  } else
+    throw std::runtime_error("Planner Not implemented for planning with time");
+
+  planner->setProblemDefinition(pdef);
+  planner->setup();
+  ob::PlannerStatus solved = planner->ob::Planner::solve(time);
+  if (!solved) return std::make_pair(solved.asString(), MatrixX<S>(0, dim_ + 1));
+
+  auto geo_path = std::dynamic_pointer_cast<og::PathGeometric>(pdef->getSolutionPath());
+  const size_t len = geo_path->getStateCount();
+  MatrixX<S> ret(len, dim_ + 1);
+  for (size_t i = 0; i < len; i++)
+    ret.row(i) = state2eigen<S>(geo_path->getState(i), si.get()).transpose();
+  return std::make_pair(solved.asString(), ret);
+}
+
+template <typename S>
+std::pair<std::string, MatrixX<S>> OMPLPlannerTpl<S>::planPrioritized(
+    const VectorX<S> &start_state, S start_time,
+    const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+    S max_duration, double time, double range, bool verbose) const {
+  ASSERT(static_cast<size_t>(start_state.rows()) == dim_,
+         "Length of start state and problem dimension should be equal");
+  ASSERT(static_cast<size_t>(velocity_limits.rows()) == dim_,
+         "Length of velocity limits and problem dimension should be equal");
+  const auto names = world_->getPlannedArticulationNames();
+
+  std::vector<VectorX<S>> arm_times;
+  std::vector<MatrixX<S>> arm_paths;
+  // Articulations planned before have reached their goals by this time
+  S min_goal_time = start_time;
+  size_t offset = 0;
+  for (size_t k = 0; k < names.size(); k++) {
+    const size_t dim_k = world_->getArticulation(names[k])->getQposDim();
+    // Articulations planned before are moving obstacles, the ones after are ignored
+    std::shared_ptr<PlanningWorldTpl<S>> world = world_->clone();
+    for (size_t j = 0; j < names.size(); j++)
+      if (j < k) {
+        world->setArticulationPlanned(names[j], false);
+        world->setArticulationTrajectory(names[j], arm_times[j], arm_paths[j]);
+      } else if (j > k)
+        world->removeArticulation(names[j]);
+
+    std::vector<VectorX<S>> goals_k;
+    for (const auto &goal_state : goal_states)
+      goals_k.push_back(goal_state.segment(offset, dim_k));
+    const auto [status_k, path_k] = OMPLPlannerTpl<S>(world).plan_with_time(
+        start_state.segment(offset, dim_k), start_time, goals_k,
+        velocity_limits.segment(offset, dim_k), max_duration, min_goal_time,
+        "RRTConnect", time, range, verbose);
+    // Approximate solutions do not reach the goal
+    if (status_k != "Exact solution") {
+      if (verbose)
+        std::cout << "Prioritized planning failed for articulation " << names[k]
+                  << ", falling back to coupled planning" << std::endl;
+      return planWithTime(start_state, start_time, goal_states, velocity_limits,
+                          max_duration, "RRTConnect", time, range, verbose);
+    }
+    arm_times.push_back(path_k.col(dim_k));
+    arm_paths.push_back(path_k.leftCols(dim_k));
+    min_goal_time = std::max(min_goal_time, arm_times.back()(path_k.rows() - 1));
+    offset += dim_k;
+  }
+
+  // Merge the trajectories at the union of their time stamps
+  std::vector<S> times;
+  for (const auto &times_k : arm_times)
+    times.insert(times.end(), times_k.data(), times_k.data() + times_k.size());
+  std::sort(times.begin(), times.end());
+  times.erase(std::unique(times.begin(), times.end()), times.end());
+  MatrixX<S> ret(times.size(), dim_ + 1);
+  for (size_t i = 0; i < times.size(); i++) {
+    offset = 0;
+    for (size_t k = 0; k < names.size(); k++) {
+      const auto dim_k = arm_paths[k].cols();
+      ret.row(i).segment(offset, dim_k) =
+          interpolate_trajectory<S>(arm_times[k], arm_paths[k], times[i]).transpose();
+      offset += dim_k;
+    }
+    ret(i, dim_) = times[i];
+  }
+  return std::make_pair(std::string("Exact solution"), ret);
+}
+
+template <typename S>
+void OMPLPlannerTpl<S>::build_masked_state_space(
+    const std::vector<size_t> &free_joints) const {
+  MPLIB_TRACE_SPAN("build_state_space");
+  // Each joint is a 1-D subspace of cs_
+  masked_cs_ = std::make_shared<CompoundStateSpace>();
+  for (auto i : free_joints)
+    masked_cs_->addSubspace(cs_->getSubspace(i), cs_->getSubspaceWeight(i));
+  masked_si_ = std::make_shared<SpaceInformation>(masked_cs_);
+  masked_valid_checker_ = std::make_shared<ValidityCheckerTpl<S>>(world_, masked_si_);
+  masked_valid_checker_->setFreeJoints(free_joints);
+  masked_si_->setStateValidityChecker(masked_valid_checker_);
+  masked_free_joints_ = free_joints;
+  masked_space_built_ = true;
+}
+
 template <typename S>
 void OMPLPlannerTpl<S>::build_state_space() {
+  MPLIB_TRACE_SPAN("build_state_space");
   cs_ = std::make_shared<CompoundStateSpace>();
   dim_ = 0;
   const std::string joint_prefix = "JointModel";
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <limits>
+#include <string>
 #include <vector>
 
+#include <ompl/base/MotionValidator.h>
 #include <ompl/base/State.h>
 #include <ompl/base/StateValidityChecker.h>
+#include <ompl/base/goals/GoalSampleableRegion.h>
 #include <ompl/base/spaces/RealVectorStateSpace.h>
 #include <ompl/base/spaces/SO2StateSpace.h>
+#include <ompl/util/RandomNumbers.h>
 
 /* #include <ompl/base/goals/GoalStates.h> */
 /* #include <ompl/base/objectives/StateCostIntegralObjective.h> */
@@ -15,7 +20,9 @@
 /* #include <ompl/util/RandomNumbers.h> */
 
 #include "macros_utils.h"
+#include "perf_counters.h"
 #include "planning_world.h"
+#include "trace.h"
 #include "types.h"
 
 namespace mplib::ompl {
@@ -57,7 +64,9 @@ class ValidityCheckerTpl : public ob::StateValidityChecker {
       : ob::StateValidityChecker(si), world_(world) {}
 
   bool isValid(const ob::State *state_raw) const {
-    world_->setQposAll(state2eigen<S>(state_raw, si_));
+    ScopedPerfTimer timer(PerfCounter::STATE_VALIDITY_CHECK);
+    MPLIB_TRACE_SPAN_SAMPLED("is_valid", kTraceSamplePeriod);
+    world_->setQposAll(getFullState(state2eigen<S>(state_raw, si_)));
     return !world_->collide();
   }
 
@@ -67,17 +76,42 @@ class ValidityCheckerTpl : public ob::StateValidityChecker {
    *  penetration depth.
    */
   double clearance(const ob::State *state_raw) const {
-    world_->setQposAll(state2eigen<S>(state_raw, si_));
+    world_->setQposAll(getFullState(state2eigen<S>(state_raw, si_)));
     return static_cast<double>(world_->distance());
   }
 
   bool _isValid(const VectorX<S> &state) const {
+    ScopedPerfTimer timer(PerfCounter::STATE_VALIDITY_CHECK);
+    MPLIB_TRACE_SPAN_SAMPLED("is_valid", kTraceSamplePeriod);
     world_->setQposAll(state);
     return !world_->collide();
   }
 
+  /**
+   * @brief Restricts the state space to a subset of the joints. The other (fixed)
+   *  joints are kept at their values in the fixed state (see setFixedState()).
+   * @param free_joints: indices of the joints in the state space. If empty, the
+   *  state space contains all joints.
+   */
+  void setFreeJoints(const std::vector<size_t> &free_joints) {
+    free_joints_ = free_joints;
+  }
+
+  /// @brief Sets the values of the fixed joints (state of all joints)
+  void setFixedState(const VectorX<S> &fixed_state) { fixed_state_ = fixed_state; }
+
  private:
   PlanningWorldTplPtr<S> world_;
+  std::vector<size_t> free_joints_;
+  VectorX<S> fixed_state_;
+
+  /// @brief Gets the state of all joints from a state of the free joints
+  VectorX<S> getFullState(const VectorX<S> &state) const {
+    if (free_joints_.empty()) return state;
+    VectorX<S> ret = fixed_state_;
+    for (size_t i = 0; i < free_joints_.size(); i++) ret[free_joints_[i]] = state[i];
+    return ret;
+  }
 };
 
 // Common Type Alias ==========================================================
@@ -86,6 +120,357 @@ using ValidityCheckerd = ValidityCheckerTpl<double>;
 using ValidityCheckerfPtr = ValidityCheckerTplPtr<float>;
 using ValidityCheckerdPtr = ValidityCheckerTplPtr<double>;
 
+// SweptMotionValidatorTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(SweptMotionValidatorTpl);
+
+/**
+ * @brief Discrete motion validator with an edge-level broadphase pre-pass.
+ *  Before checking any state, the scene is queried once for objects overlapping the
+ *  AABBs swept by the planned bodies. These are bounded from the AABBs at both end
+ *  states, expanded by half the displacement bound of the motion (see
+ *  PlanningWorld::getDisplacementBounds()), so forward kinematics runs once per
+ *  checked state. Narrowphase at each state is then restricted to those candidates,
+ *  which gives the same result as checking every scene object.
+ *
+ *  States are checked in bisection (van der Corput) order: the end state first,
+ *  then the midpoint, then the quarter points, and so on. Invalid motions usually
+ *  fail far from their (valid) start state, so they are rejected sooner.
+ */
+template <typename S>
+class SweptMotionValidatorTpl : public ob::MotionValidator {
+ public:
+  SweptMotionValidatorTpl(const PlanningWorldTplPtr<S> &world,
+                          const SpaceInformationPtr &si)
+      : ob::MotionValidator(si), world_(world) {}
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2) const override;
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2,
+                   std::pair<ob::State *, double> &last_valid) const override;
+
+  /// @brief Gets the maximum displacement between checked states (see setter)
+  S getMaxDisplacement() const { return max_displacement_; }
+
+  /**
+   * @brief Sets the maximum displacement of any point of the planned bodies between
+   *  two consecutive checked states. This gives each joint its own resolution
+   *  derived from the link lengths it drives (see
+   *  PlanningWorld::getDisplacementBounds()).
+   * @param max_displacement: maximum displacement. If not positive (default), it
+   *  is the largest displacement bound of any joint times the longest valid segment
+   *  length of the state space: the joints that move the bodies the most keep that
+   *  resolution, and the other joints are checked more coarsely.
+   */
+  void setMaxDisplacement(S max_displacement) { max_displacement_ = max_displacement; }
+
+  /**
+   * @brief Recomputes the displacement bounds of the planned bodies (see
+   *  PlanningWorld::getDisplacementBounds()). They do not depend on the
+   *  configuration and are cached, so this is called once per planning call, after
+   *  the planned bodies may have changed.
+   */
+  void updateDisplacementBounds() { bounds_ = world_->getDisplacementBounds(); }
+
+ private:
+  PlanningWorldTplPtr<S> world_;
+  S max_displacement_ {};
+  mutable MatrixX<S> bounds_;
+
+  /// @brief Absolute motion of each joint from s1 to s2 (shortest angle for SO2)
+  VectorX<S> getJointMotion(const ob::State *s1, const ob::State *s2) const;
+
+  /**
+   * @brief Discretizes the motion and gets the scene objects overlapping the AABBs
+   *  swept by the planned bodies. Leaves the planning world at s2.
+   * @param candidates: output scene objects
+   * @returns states to check, from s1 (excluded) to s2 (included)
+   */
+  std::vector<VectorX<S>> sweep(const ob::State *s1, const ob::State *s2,
+                                std::vector<ObjectHandle> &candidates) const;
+
+  /**
+   * @brief Checks states in bisection order, starting at the end state (the state
+   *  of the planning world, see sweep())
+   * @param candidates: scene objects to check against
+   * @param find_first: whether to find the first invalid state. Otherwise, stops at
+   *  any invalid state.
+   * @returns index of the first (or any) invalid state, ``states.size()`` if all
+   *  states are valid
+   */
+  size_t checkStates(const std::vector<VectorX<S>> &states,
+                     const std::vector<ObjectHandle> &candidates,
+                     bool find_first) const;
+};
+
+// Common Type Alias ==========================================================
+using SweptMotionValidatorf = SweptMotionValidatorTpl<float>;
+using SweptMotionValidatord = SweptMotionValidatorTpl<double>;
+using SweptMotionValidatorfPtr = SweptMotionValidatorTplPtr<float>;
+using SweptMotionValidatordPtr = SweptMotionValidatorTplPtr<double>;
+
+// CertifiedMotionValidatorTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(CertifiedMotionValidatorTpl);
+
+/**
+ * @brief Motion validator that certifies whole segments using clearance.
+ *  The clearance of a state (distance to collision) defines a collision-free bubble
+ *  in joint space: PlanningWorld::getDisplacementBounds() bounds how far any body
+ *  moves per unit joint motion, so a segment is collision-free if the bodies cannot
+ *  move farther than the clearance of its endpoints. Segments that cannot be
+ *  certified are bisected breadth-first (van der Corput order), down to the state
+ *  validity checking resolution. In open space, an edge costs a single distance
+ *  query. Each certified state costs two distance queries (to other objects and
+ *  among planned bodies) instead of one collision check, so this pays off only in
+ *  sparse scenes. Motions that touch an obstacle (zero clearance) cannot be
+ *  certified and are checked by the fallback validator.
+ */
+template <typename S>
+class CertifiedMotionValidatorTpl : public ob::MotionValidator {
+ public:
+  /**
+   * @param world: planning world
+   * @param si: space information of a CompoundStateSpace of 1-D joint subspaces
+   * @param fallback: motion validator used to find the last valid state of motions
+   *  that cannot be certified
+   */
+  CertifiedMotionValidatorTpl(const PlanningWorldTplPtr<S> &world,
+                              const SpaceInformationPtr &si,
+                              const ob::MotionValidatorPtr &fallback);
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2) const override;
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2,
+                   std::pair<ob::State *, double> &last_valid) const override;
+
+  /// @brief Gets the maximum displacement between checked states (see setter)
+  S getMaxDisplacement() const { return max_displacement_; }
+
+  /**
+   * @brief Sets the maximum displacement of any point of the planned bodies along a
+   *  segment that is accepted without being certified.
+   * @param max_displacement: maximum displacement. If not positive (default), it
+   *  is derived from the longest valid segment length of the state space (see
+   *  SweptMotionValidator::setMaxDisplacement()).
+   */
+  void setMaxDisplacement(S max_displacement) { max_displacement_ = max_displacement; }
+
+  /// @brief Recomputes the cached displacement bounds (see
+  ///  SweptMotionValidator::updateDisplacementBounds())
+  void updateDisplacementBounds() { bounds_ = world_->getDisplacementBounds(); }
+
+ private:
+  /// @brief Clearance of a state to non-planned bodies and among planned bodies
+  struct Clearance {
+    S others {};
+    S self {};
+  };
+
+  /// @brief Outcome of certify()
+  enum class Certificate {
+    VALID,     // the motion is collision-free
+    INVALID,   // a state of the motion is in collision
+    UNCERTAIN  // the motion touches an obstacle (zero clearance)
+  };
+
+  PlanningWorldTplPtr<S> world_;
+  ob::MotionValidatorPtr fallback_;
+  std::vector<bool> is_so2_;  // whether each state dimension is an SO2 subspace
+  S max_displacement_ {};
+  mutable MatrixX<S> bounds_;
+
+  /**
+   * @brief Certifies the motion from start to goal
+   * @param invalid_fraction: fraction of the motion at the invalid state found (if
+   *  INVALID). States before it are not necessarily valid.
+   */
+  Certificate certify(const VectorX<S> &start, const VectorX<S> &goal,
+                      double &invalid_fraction) const;
+
+  /**
+   * @brief Finds the last valid state of an invalid motion with the fallback
+   *  validator, searching only up to the invalid state found by certify()
+   */
+  void findLastValid(const ob::State *s1, const ob::State *s2, double invalid_fraction,
+                     std::pair<ob::State *, double> &last_valid) const;
+
+  /**
+   * @brief Sets the state and computes its clearance
+   * @returns whether the state is valid
+   */
+  bool computeClearance(const VectorX<S> &state, Clearance &clearance) const;
+
+  /// @brief Bound of the displacement of any planned body along a motion by delta
+  S getMotionBound(const VectorX<S> &delta) const;
+
+  /// @brief Joint-space motion from a to b (shortest angle for SO2 subspaces)
+  VectorX<S> getDelta(const VectorX<S> &a, const VectorX<S> &b) const;
+};
+
+// Common Type Alias ==========================================================
+using CertifiedMotionValidatorf = CertifiedMotionValidatorTpl<float>;
+using CertifiedMotionValidatord = CertifiedMotionValidatorTpl<double>;
+using CertifiedMotionValidatorfPtr = CertifiedMotionValidatorTplPtr<float>;
+using CertifiedMotionValidatordPtr = CertifiedMotionValidatorTplPtr<double>;
+
+// TimedValidityCheckerTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(TimedValidityCheckerTpl);
+
+/**
+ * @brief State validity checker for planning in space-time (q, t).
+ *  The last state dimension is time: dynamic objects of the planning world are moved
+ *  to their poses at that time (see PlanningWorld::setObjectTrajectory()) before
+ *  checking the joint state.
+ */
+template <typename S>
+class TimedValidityCheckerTpl : public ob::StateValidityChecker {
+ public:
+  TimedValidityCheckerTpl(const PlanningWorldTplPtr<S> &world,
+                          const SpaceInformationPtr &si)
+      : ob::StateValidityChecker(si), world_(world) {}
+
+  bool isValid(const ob::State *state_raw) const {
+    return _isValid(state2eigen<S>(state_raw, si_));
+  }
+
+  /// @brief Checks a space-time state (joint state followed by time)
+  bool _isValid(const VectorX<S> &state) const {
+    ScopedPerfTimer timer(PerfCounter::STATE_VALIDITY_CHECK);
+    MPLIB_TRACE_SPAN_SAMPLED("is_valid", kTraceSamplePeriod);
+    const auto dim = state.size() - 1;
+    world_->setTime(state[dim]);
+    world_->setQposAll(state.head(dim));
+    return !world_->collide();
+  }
+
+ private:
+  PlanningWorldTplPtr<S> world_;
+};
+
+// Common Type Alias ==========================================================
+using TimedValidityCheckerf = TimedValidityCheckerTpl<float>;
+using TimedValidityCheckerd = TimedValidityCheckerTpl<double>;
+using TimedValidityCheckerfPtr = TimedValidityCheckerTplPtr<float>;
+using TimedValidityCheckerdPtr = TimedValidityCheckerTplPtr<double>;
+
+// TimedMotionValidatorTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(TimedMotionValidatorTpl);
+
+/**
+ * @brief Motion validator for planning in space-time (q, t).
+ *  A motion is valid if time strictly increases, every joint stays within its
+ *  velocity limit, and the discretized states are valid at their interpolated time.
+ */
+template <typename S>
+class TimedMotionValidatorTpl : public ob::MotionValidator {
+ public:
+  /**
+   * @param si: space information of a CompoundStateSpace of 1-D joint subspaces
+   *  followed by a 1-D time subspace
+   * @param velocity_limits: maximum absolute velocity of each joint
+   */
+  TimedMotionValidatorTpl(const SpaceInformationPtr &si,
+                          const VectorX<S> &velocity_limits);
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2) const override;
+
+  bool checkMotion(const ob::State *s1, const ob::State *s2,
+                   std::pair<ob::State *, double> &last_valid) const override;
+
+ private:
+  VectorX<S> velocity_limits_;
+  std::vector<bool> is_so2_;  // whether each joint dimension is an SO2 subspace
+
+  /// @brief Whether the motion moves forward in time within the velocity limits
+  bool isFeasible(const ob::State *s1, const ob::State *s2) const;
+};
+
+// Common Type Alias ==========================================================
+using TimedMotionValidatorf = TimedMotionValidatorTpl<float>;
+using TimedMotionValidatord = TimedMotionValidatorTpl<double>;
+using TimedMotionValidatorfPtr = TimedMotionValidatorTplPtr<float>;
+using TimedMotionValidatordPtr = TimedMotionValidatorTplPtr<double>;
+
+// TimedGoalTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(TimedGoalTpl);
+
+/**
+ * @brief Goal of space-time planning: reach any of the goal joint states at any time
+ *  within [min_time, max_time]. Goals are sampled with a uniformly random arrival
+ *  time.
+ */
+template <typename S>
+class TimedGoalTpl : public ob::GoalSampleableRegion {
+ public:
+  TimedGoalTpl(const SpaceInformationPtr &si, const std::vector<VectorX<S>> &goals,
+               S min_time, S max_time);
+
+  void sampleGoal(ob::State *state) const override;
+
+  unsigned int maxSampleCount() const override {
+    return std::numeric_limits<unsigned int>::max();
+  }
+
+  /// @brief Distance in joint space to the nearest goal (time is ignored)
+  double distanceGoal(const ob::State *state) const override;
+
+  /// @brief Whether the state is within the goal threshold, at or after min_time
+  bool isSatisfied(const ob::State *state) const override {
+    return isSatisfied(state, nullptr);
+  }
+
+  bool isSatisfied(const ob::State *state, double *distance) const override;
+
+ private:
+  std::vector<VectorX<S>> goals_;
+  S min_time_, max_time_;
+  std::vector<bool> is_so2_;  // whether each joint dimension is an SO2 subspace
+  mutable ::ompl::RNG rng_;
+};
+
+// Common Type Alias ==========================================================
+using TimedGoalf = TimedGoalTpl<float>;
+using TimedGoald = TimedGoalTpl<double>;
+using TimedGoalfPtr = TimedGoalTplPtr<float>;
+using TimedGoaldPtr = TimedGoalTplPtr<double>;
+
+/// @brief Motion validator of OMPLPlanner::plan()
+enum class MotionValidatorType {
+  SWEPT,     // discrete checking with a broadphase pre-pass (SweptMotionValidator)
+  CERTIFIED  // clearance certificates, SWEPT as fallback (CertifiedMotionValidator)
+};
+
+/// @brief Options of OMPLPlanner::planBatch(), shared by all queries (see plan())
+struct BatchPlanOptions {
+  std::string planner_name = "RRTConnect";
+  double time = 1.0;  // planning time limit of each query
+  double range = 0.0;
+  double goal_bias = 0.05;
+  double pathlen_obj_weight = 10.0;
+  bool pathlen_obj_only = false;
+  size_t num_threads = 0;  // 0 to use all hardware threads
+};
+
+// BatchPlanResultTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(BatchPlanResultTpl);
+
+/// @brief Result and statistics of a query of OMPLPlanner::planBatch()
+template <typename S>
+struct BatchPlanResultTpl {
+  std::string status;       // planner status, as returned by plan()
+  MatrixX<S> path;          // empty if no solution was found
+  bool success {};          // whether status is an exact solution
+  double planning_time {};  // wall-clock time of the query in seconds
+  S path_length {};         // sum of joint-space distances between waypoints
+  size_t thread_id {};      // index of the worker that planned the query
+  PerfCounts perf_counts;   // performance counters of the query (if enabled)
+};
+
+// Common Type Alias ==========================================================
+using BatchPlanResultf = BatchPlanResultTpl<float>;
+using BatchPlanResultd = BatchPlanResultTpl<double>;
+using BatchPlanResultfPtr = BatchPlanResultTplPtr<float>;
+using BatchPlanResultdPtr = BatchPlanResultTplPtr<double>;
+
 // OMPLPlannerTplPtr
 MPLIB_CLASS_TEMPLATE_FORWARD(OMPLPlannerTpl);
 
@@ -98,13 +483,127 @@ class OMPLPlannerTpl {
 
   size_t get_dim() const { return dim_; }
 
-  VectorX<S> random_sample_nearby(const VectorX<S> &start_state) const;
+  /**
+   * @brief Samples a valid state near the given state with growing perturbations
+   * @param start_state: state to perturb
+   * @param fixed_joints: mask of the joints that are not perturbed (empty for none)
+   * @returns the sampled state, or start_state if none is found
+   */
+  VectorX<S> random_sample_nearby(const VectorX<S> &start_state,
+                                  const std::vector<bool> &fixed_joints = {}) const;
+
+  /**
+   * @brief Sets the maximum displacement of any point of the planned bodies between
+   *  states checked by motion validation, which gives each joint its own resolution
+   *  derived from link lengths. If not positive (default), it is derived from the
+   *  longest valid segment fraction of the state space (see
+   *  SweptMotionValidator::setMaxDisplacement()).
+   */
+  void setMaxDisplacement(S max_displacement);
+
+  /// @brief Gets the motion validator of plan() (see setter)
+  MotionValidatorType getMotionValidator() const { return motion_validator_type_; }
+
+  /**
+   * @brief Sets the motion validator of plan(). SWEPT (default) checks discretized
+   *  states. CERTIFIED replaces collision checks by distance queries that certify
+   *  whole segments, which is faster only in sparse scenes.
+   */
+  void setMotionValidator(MotionValidatorType type);
+
+  /**
+   * @brief Sets whether the tree-based planners (RRT family) created by plan() use
+   *  LinearNearestNeighbors or OMPL's default nearest neighbors (GNAT, default).
+   *  See dev/benchmark_nearest_neighbors.py to compare them.
+   */
+  void setLinearNearestNeighbors(bool enabled) { linear_nearest_neighbors_ = enabled; }
 
+  /**
+   * @brief Plans a path from start state to any of the goal states.
+   * @param fixed_joints: mask of joints that are not planned and stay at their start
+   *  values (their goal values are ignored). The planner then samples in the
+   *  reduced state space of the other joints, which is cached between calls with
+   *  the same mask. If empty (default), all joints are planned. At least one
+   *  joint should not be fixed.
+   * @returns pair of planner status and path
+   */
   std::pair<std::string, MatrixX<S>> plan(
       const VectorX<S> &start_state, const std::vector<VectorX<S>> &goal_states,
       const std::string &planner_name = "RRTConnect", double time = 1.0,
       double range = 0.0, double goal_bias = 0.05, double pathlen_obj_weight = 10.0,
-      bool pathlen_obj_only = false, bool verbose = false) const;
+      bool pathlen_obj_only = false, bool verbose = false,
+      const std::vector<bool> &fixed_joints = {}) const;
+
+  /**
+   * @brief Gets the performance counters of the last plan() call, counted on the
+   *  calling thread (all zero if PerfCounters are disabled)
+   */
+  const PerfCounts &getLastPlanCounts() const { return last_plan_counts_; }
+
+  /**
+   * @brief Plans independent queries in parallel, each as plan() would.
+   *  Workers take the next unplanned query as soon as they finish one, so queries
+   *  that fail (and use their whole time limit) do not hold up the others. Each
+   *  worker plans on its own copy of the world (see PlanningWorld::clone()) with
+   *  the settings of this planner, so the state of the world is not modified.
+   * @param start_states: start state of each query, or one start state shared by
+   *  all queries
+   * @param goal_sets: goal states of each query
+   * @param options: planner options of all queries
+   * @returns result and statistics of each query, in query order
+   */
+  std::vector<BatchPlanResultTpl<S>> planBatch(
+      const std::vector<VectorX<S>> &start_states,
+      const std::vector<std::vector<VectorX<S>>> &goal_sets,
+      const BatchPlanOptions &options = BatchPlanOptions()) const;
+
+  /**
+   * @brief Plans in space-time (q, t) against the known motion of dynamic objects
+   *  (see PlanningWorld::setObjectTrajectory()). Time strictly increases along the
+   *  path and every joint stays within its velocity limit.
+   * @param start_state: start joint state
+   * @param start_time: time of the start state
+   * @param goal_states: goal joint states, reached at any time within max_duration
+   * @param velocity_limits: maximum absolute velocity of each joint
+   * @param max_duration: maximum duration of the path
+   * @param planner_name: "RRTConnect" or "RRT"
+   * @param time: planning time limit
+   * @param range: planning range (for RRT family of planners)
+   * @param verbose: print debug information
+   * @returns pair of planner status and path. Each row of the path is a joint state
+   *  followed by its time.
+   */
+  std::pair<std::string, MatrixX<S>> planWithTime(
+      const VectorX<S> &start_state, S start_time,
+      const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+      S max_duration, const std::string &planner_name = "RRTConnect",
+      double time = 1.0, double range = 0.0, bool verbose = false) const;
+
+  /**
+   * @brief Plans the planned articulations one at a time in space-time, in
+   *  PlanningWorld::getPlannedArticulationNames() order (decreasing priority).
+   *  Each articulation is planned in its own subspace with planWithTime(), treating
+   *  the trajectories of articulations planned before it as time-indexed obstacles
+   *  and ignoring the ones planned after it. Each articulation reaches its goal no
+   *  earlier than the articulations planned before it, so that it never parks in
+   *  the way of one still moving. If any articulation has no exact solution, falls
+   *  back to coupled planWithTime() over all planned articulations.
+   * @param start_state: start joint state of all planned articulations
+   * @param start_time: time of the start state
+   * @param goal_states: goal joint states of all planned articulations
+   * @param velocity_limits: maximum absolute velocity of each joint
+   * @param max_duration: maximum duration of the path
+   * @param time: planning time limit of each articulation (and of the fallback)
+   * @param range: planning range (for RRT family of planners)
+   * @param verbose: print debug information
+   * @returns pair of planner status and path. Each row of the path is a joint state
+   *  of all planned articulations followed by its time.
+   */
+  std::pair<std::string, MatrixX<S>> planPrioritized(
+      const VectorX<S> &start_state, S start_time,
+      const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+      S max_duration, double time = 1.0, double range = 0.0,
+      bool verbose = false) const;
 
  private:
   CompoundStateSpacePtr cs_;
@@ -112,11 +611,34 @@ class OMPLPlannerTpl {
   ProblemDefinitionPtr pdef_;
   PlanningWorldTplPtr<S> world_;
   ValidityCheckerTplPtr<S> valid_checker_;
+  SweptMotionValidatorTplPtr<S> swept_validator_;
+  CertifiedMotionValidatorTplPtr<S> certified_validator_;
   size_t dim_;
   std::vector<S> lower_joint_limits_, upper_joint_limits_;
   std::vector<bool> is_revolute_;
+  S max_displacement_ {};
+  MotionValidatorType motion_validator_type_ {MotionValidatorType::SWEPT};
+  bool linear_nearest_neighbors_ {false};
+  mutable PerfCounts last_plan_counts_;
+
+  // Reduced state space of the last fixed joints mask passed to plan()
+  mutable CompoundStateSpacePtr masked_cs_;
+  mutable SpaceInformationPtr masked_si_;
+  mutable ValidityCheckerTplPtr<S> masked_valid_checker_;
+  mutable std::vector<size_t> masked_free_joints_;
+  mutable bool masked_space_built_ {};
 
   void build_state_space();
+
+  /// @brief planWithTime() with goals reached no earlier than min_goal_time
+  std::pair<std::string, MatrixX<S>> plan_with_time(
+      const VectorX<S> &start_state, S start_time,
+      const std::vector<VectorX<S>> &goal_states, const VectorX<S> &velocity_limits,
+      S max_duration, S min_goal_time, const std::string &planner_name, double time,
+      double range, bool verbose) const;
+
+  /// @brief Builds the reduced state space of the given (not fixed) joints
+  void build_masked_state_space(const std::vector<size_t> &free_joints) const;
 };
 
 // Common Type Alias ==========================================================
@@ -130,6 +652,12 @@ using OMPLPlannerTpldPtr = OMPLPlannerTplPtr<double>;
   extern template std::vector<S> state2vector<S>(const ob::State *const &state_raw,   \
                                                  const SpaceInformation *const &si_); \
   extern template class ValidityCheckerTpl<S>;                                        \
+  extern template class SweptMotionValidatorTpl<S>;                                   \
+  extern template class CertifiedMotionValidatorTpl<S>;                               \
+  extern template class TimedValidityCheckerTpl<S>;                                   \
+  extern template class TimedMotionValidatorTpl<S>;                                   \
+  extern template class TimedGoalTpl<S>;                                              \
+  extern template class BatchPlanResultTpl<S>;                                        \
   extern template class OMPLPlannerTpl<S>
 
 DECLARE_TEMPLATE_OMPL_PLANNER(float);
@@ -0,0 +1,241 @@
+#include "path_monitor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace mplib {
+
+// Explicit Template Instantiation Definition =================================
+#define DEFINE_TEMPLATE_PATH_MONITOR(S) template class PathMonitorTpl<S>
+
+DEFINE_TEMPLATE_PATH_MONITOR(float);
+DEFINE_TEMPLATE_PATH_MONITOR(double);
+
+namespace {
+
+constexpr size_t kLeafSize = 4;  // maximum number of swept AABBs in a BVH leaf
+
+}  // namespace
+
+template <typename S>
+PathMonitorTpl<S>::PathMonitorTpl(const PlanningWorldPtr &world, const MatrixX<S> &path,
+                                  S resolution)
+    : world_(world), path_(path), resolution_(resolution) {
+  ASSERT(resolution > 0, "resolution should be positive");
+  ASSERT(path.rows() > 0, "path should have at least one waypoint");
+  const auto arts = world_->getPlannedArticulations();
+  std::vector<VectorX<S>> qposes;
+  for (const auto &art : arts) qposes.push_back(art->getQpos());
+
+  // The bounds do not depend on the configuration, compute them once for the path
+  const auto bounds = world_->getDisplacementBounds();
+  for (size_t i = 0; i < static_cast<size_t>(path_.rows()); i++) {
+    const auto states = getSegmentStates(i);
+    // Swept AABBs start at the previous waypoint (if any)
+    world_->setQposAll(path_.row(i == 0 ? 0 : i - 1).transpose());
+    auto aabbs = world_->getPlannedAABBs();
+    // Between checked states, each body moves at most bounds.row(j).dot(|step|)
+    VectorX<S> margins = VectorX<S>::Zero(aabbs.size());
+    if (i > 0) {
+      const VectorX<S> step =
+          (states[0].second - path_.row(i - 1).transpose()).cwiseAbs();
+      margins = bounds * step;
+    }
+    for (const auto &[fraction, qpos] : states) {
+      world_->setQposAll(qpos);
+      const auto state_aabbs = world_->getPlannedAABBs();
+      for (size_t j = 0; j < aabbs.size(); j++) aabbs[j] += state_aabbs[j];
+    }
+
+    const size_t begin = swept_aabbs_.size();
+    segment_ranges_.emplace_back(begin, begin + aabbs.size());
+    for (size_t j = 0; j < aabbs.size(); j++) {
+      // An unbounded body (e.g., far from a prismatic joint) overlaps everything
+      const S margin = std::isfinite(margins[j]) ? margins[j]
+                                                 : std::numeric_limits<S>::max() / 4;
+      swept_aabbs_.push_back(aabbs[j].expand(Vector3<S>::Constant(margin)));
+      segment_ids_.push_back(i);
+    }
+  }
+  for (size_t i = 0; i < arts.size(); i++) arts[i]->setQpos(qposes[i], true);
+
+  aabb_ids_.resize(swept_aabbs_.size());
+  std::iota(aabb_ids_.begin(), aabb_ids_.end(), 0);
+  if (!aabb_ids_.empty()) buildNode(0, aabb_ids_.size());
+  objects_ = getObjectStates();
+}
+
+template <typename S>
+std::vector<fcl::AABB<S>> PathMonitorTpl<S>::getSweptAABBs(size_t segment) const {
+  ASSERT(segment < getSegmentCount(), "Segment index out of range");
+  const auto [begin, end] = segment_ranges_[segment];
+  return std::vector<AABB>(swept_aabbs_.begin() + begin, swept_aabbs_.begin() + end);
+}
+
+template <typename S>
+TrajectoryValidationResultTpl<S> PathMonitorTpl<S>::update() {
+  // Objects added, moved or replaced since the last update
+  auto objects = getObjectStates();
+  bool removed = false;
+  changed_objects_.clear();
+  checked_segments_.clear();
+  for (const auto &[name, state] : objects) {
+    auto it = objects_.find(name);
+    if (it == objects_.end() || it->second.geometry != state.geometry ||
+        it->second.pose.matrix() != state.pose.matrix())
+      changed_objects_.push_back(name);
+  }
+  for (const auto &[name, state] : objects_)
+    if (objects.find(name) == objects.end()) removed = true;
+  objects_ = std::move(objects);
+  std::sort(changed_objects_.begin(), changed_objects_.end());
+
+  if (removed || !changed_objects_.empty()) {
+    std::vector<bool> affected(getSegmentCount());
+    std::vector<ObjectHandle> changed_handles;
+    std::vector<AABB> changed_aabbs;
+    for (const auto &name : changed_objects_) {
+      const auto object = world_->getNormalObject(name);
+      object->computeAABB();
+      changed_handles.push_back(world_->getNormalObjectHandle(name));
+      changed_aabbs.push_back(object->getAABB());
+      querySegments(changed_aabbs.back(), affected);
+    }
+
+    const auto arts = world_->getPlannedArticulations();
+    std::vector<VectorX<S>> qposes;
+    for (const auto &art : arts) qposes.push_back(art->getQpos());
+    for (size_t i = 0; i < affected.size(); i++) {
+      if (invalid_segments_.find(i) != invalid_segments_.end()) {
+        // The obstacle may have moved away, checks against all nearby objects
+        checkSegment(i, world_->getSceneObjectsOverlapping(getSweptAABBs(i)));
+      } else if (affected[i]) {
+        // The segment was valid, so only the changed objects can collide
+        const auto swept_aabbs = getSweptAABBs(i);
+        std::vector<ObjectHandle> candidates;
+        for (size_t k = 0; k < changed_handles.size(); k++) {
+          auto overlaps = [&](const AABB &aabb) {
+            return aabb.overlap(changed_aabbs[k]);
+          };
+          if (std::any_of(swept_aabbs.begin(), swept_aabbs.end(), overlaps))
+            candidates.push_back(changed_handles[k]);
+        }
+        checkSegment(i, candidates);
+      } else
+        continue;
+      checked_segments_.push_back(i);
+    }
+    for (size_t i = 0; i < arts.size(); i++) arts[i]->setQpos(qposes[i], true);
+  }
+  return invalid_segments_.empty() ? TrajectoryValidationResult()
+                                   : invalid_segments_.begin()->second;
+}
+
+template <typename S>
+std::vector<size_t> PathMonitorTpl<S>::getInvalidSegments() const {
+  std::vector<size_t> ret;
+  for (const auto &[segment, result] : invalid_segments_) ret.push_back(segment);
+  return ret;
+}
+
+template <typename S>
+std::vector<std::pair<S, VectorX<S>>> PathMonitorTpl<S>::getSegmentStates(
+    size_t segment) const {
+  if (segment == 0) return {{1, path_.row(0).transpose()}};
+  // Same interpolation as PlanningWorld::validateTrajectory()
+  const VectorX<S> q0 = path_.row(segment - 1).transpose(),
+                   q1 = path_.row(segment).transpose();
+  const S max_motion = (q1 - q0).cwiseAbs().maxCoeff();
+  const int n = std::max(static_cast<int>(std::ceil(max_motion / resolution_)), 1);
+  std::vector<std::pair<S, VectorX<S>>> ret;
+  for (int j = 1; j <= n; j++) {
+    const S t = static_cast<S>(j) / n;
+    ret.emplace_back(t, (1 - t) * q0 + t * q1);
+  }
+  return ret;
+}
+
+template <typename S>
+std::unordered_map<std::string, typename PathMonitorTpl<S>::ObjectState>
+PathMonitorTpl<S>::getObjectStates() const {
+  std::unordered_map<std::string, ObjectState> ret;
+  for (const auto &name : world_->getNormalObjectNames()) {
+    if (world_->isNormalObjectAttached(name)) continue;
+    const auto object = world_->getNormalObject(name);
+    ret.emplace(name, ObjectState {object->collisionGeometry().get(),
+                                   object->getTransform()});
+  }
+  return ret;
+}
+
+template <typename S>
+int PathMonitorTpl<S>::buildNode(size_t begin, size_t end) {
+  const int index = nodes_.size();
+  nodes_.push_back({swept_aabbs_[aabb_ids_[begin]], begin, end});
+  AABB centers(swept_aabbs_[aabb_ids_[begin]].center());
+  for (size_t k = begin + 1; k < end; k++) {
+    nodes_[index].aabb += swept_aabbs_[aabb_ids_[k]];
+    centers += swept_aabbs_[aabb_ids_[k]].center();
+  }
+  if (end - begin <= kLeafSize) return index;
+
+  // Splits at the median center along the longest axis of the centers
+  int axis;
+  (centers.max_ - centers.min_).maxCoeff(&axis);
+  const size_t mid = begin + (end - begin) / 2;
+  std::nth_element(aabb_ids_.begin() + begin, aabb_ids_.begin() + mid,
+                   aabb_ids_.begin() + end, [this, axis](size_t a, size_t b) {
+                     return swept_aabbs_[a].center()[axis] <
+                            swept_aabbs_[b].center()[axis];
+                   });
+  const int left = buildNode(begin, mid), right = buildNode(mid, end);
+  nodes_[index].left = left;  // nodes_ may have been reallocated
+  nodes_[index].right = right;
+  return index;
+}
+
+template <typename S>
+void PathMonitorTpl<S>::querySegments(const AABB &aabb,
+                                      std::vector<bool> &segments) const {
+  if (nodes_.empty()) return;
+  std::vector<int> stack {0};
+  while (!stack.empty()) {
+    const auto &node = nodes_[stack.back()];
+    stack.pop_back();
+    if (!node.aabb.overlap(aabb)) continue;
+    if (node.left >= 0) {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+      continue;
+    }
+    for (size_t k = node.begin; k < node.end; k++)
+      if (swept_aabbs_[aabb_ids_[k]].overlap(aabb))
+        segments[segment_ids_[aabb_ids_[k]]] = true;
+  }
+}
+
+template <typename S>
+bool PathMonitorTpl<S>::checkSegment(size_t segment,
+                                     const std::vector<ObjectHandle> &objects) {
+  invalid_segments_.erase(segment);
+  if (objects.empty()) return true;
+  for (auto &[fraction, qpos] : getSegmentStates(segment)) {
+    world_->setQposAll(qpos);
+    auto collisions = world_->collideWithOthers(objects, fcl::CollisionRequest<S>(),
+                                                CollisionReportLevel::BOOL);
+    if (collisions.empty()) continue;
+    TrajectoryValidationResult result;
+    result.valid = false;
+    result.index = segment;
+    result.fraction = fraction;
+    result.qpos = std::move(qpos);
+    result.collision = std::move(collisions[0]);
+    invalid_segments_.emplace(segment, std::move(result));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace mplib
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "macros_utils.h"
+#include "planning_world.h"
+#include "types.h"
+
+namespace mplib {
+
+// PathMonitorTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(PathMonitorTpl);
+
+/**
+ * @brief Keeps a planned path valid against scene updates by revalidating only the
+ *  path segments near the scene objects that changed.
+ *  Segment ``i`` is the motion from waypoint ``i - 1`` to waypoint ``i`` (segment 0
+ *  is the first waypoint). On construction, the swept volume of each segment is
+ *  bounded by one AABB per planned body (see PlanningWorld::getPlannedAABBs()) and
+ *  the AABBs are indexed in a bounding volume hierarchy.
+ *
+ *  update() compares the scene objects of the world with the previous update.
+ *  Segments whose swept volume overlaps an added, moved or replaced object (e.g., a
+ *  new point cloud from addPointCloud()) are checked against the changed objects
+ *  only, and invalid segments are checked again against all overlapping objects
+ *  when the scene changes, so removed or moved obstacles can make them valid again.
+ *
+ *  The path is assumed to be collision-free against the scene at construction
+ *  (e.g., just planned) and planned articulations, attached bodies and unplanned
+ *  articulations are assumed not to change; construct a new monitor otherwise.
+ */
+template <typename S>
+class PathMonitorTpl {
+ public:
+  // Common type alias
+  using AABB = fcl::AABB<S>;
+  using CollisionObjectPtr = fcl::CollisionObjectPtr<S>;
+  using PlanningWorldPtr = PlanningWorldTplPtr<S>;
+  using TrajectoryValidationResult = TrajectoryValidationResultTpl<S>;
+
+  /**
+   * @param world: planning world, whose scene objects are monitored
+   * @param path: waypoints, one state of all planned articulations per row (see
+   *  PlanningWorld::setQposAll())
+   * @param resolution: maximum joint motion between checked states of a segment
+   */
+  PathMonitorTpl(const PlanningWorldPtr &world, const MatrixX<S> &path,
+                 S resolution = 0.01);
+
+  const MatrixX<S> &getPath() const { return path_; }
+
+  /// @brief Gets the number of segments (number of waypoints)
+  size_t getSegmentCount() const { return segment_ranges_.size(); }
+
+  /**
+   * @brief Gets the swept AABBs of the planned bodies along a segment (in
+   *  PlanningWorld::getPlannedAABBs() order)
+   */
+  std::vector<AABB> getSweptAABBs(size_t segment) const;
+
+  /**
+   * @brief Revalidates the segments affected by scene objects added, moved or
+   *  replaced since the last update (or construction). The state of the world is
+   *  restored afterwards.
+   * @returns the first invalid state of the path (see
+   *  PlanningWorld::validateTrajectory()), whose index is the first invalid segment
+   */
+  TrajectoryValidationResult update();
+
+  /// @brief Gets the currently invalid segments (in increasing order)
+  std::vector<size_t> getInvalidSegments() const;
+
+  /// @brief Gets the segments checked by the last update() (in increasing order)
+  const std::vector<size_t> &getCheckedSegments() const { return checked_segments_; }
+
+  /// @brief Gets names of the scene objects changed at the last update()
+  const std::vector<std::string> &getChangedObjects() const { return changed_objects_; }
+
+ private:
+  /// @brief State of a scene object, compared between updates
+  struct ObjectState {
+    const void *geometry;
+    Transform3<S> pose;
+  };
+
+  /// @brief Node of the bounding volume hierarchy over swept AABBs
+  struct Node {
+    AABB aabb;
+    size_t begin, end;  // range of aabb_ids_ below this node
+    int left {-1}, right {-1};
+  };
+
+  PlanningWorldPtr world_;
+  MatrixX<S> path_;
+  S resolution_;
+  std::vector<std::pair<size_t, size_t>> segment_ranges_;  // range of swept_aabbs_
+  std::vector<AABB> swept_aabbs_;  // swept AABBs of all segments and bodies
+  std::vector<size_t> segment_ids_;  // segment of each swept AABB
+  std::vector<size_t> aabb_ids_;     // swept AABBs ordered by BVH leaf
+  std::vector<Node> nodes_;          // nodes_[0] is the root
+  std::unordered_map<std::string, ObjectState> objects_;
+  std::map<size_t, TrajectoryValidationResult> invalid_segments_;
+  std::vector<size_t> checked_segments_;
+  std::vector<std::string> changed_objects_;
+
+  /// @brief Gets the states of a segment checked at resolution_ (and its fractions)
+  std::vector<std::pair<S, VectorX<S>>> getSegmentStates(size_t segment) const;
+
+  /// @brief Gets the states of all (not attached) scene objects by name
+  std::unordered_map<std::string, ObjectState> getObjectStates() const;
+
+  /// @brief Builds the BVH node over aabb_ids_[begin, end)
+  int buildNode(size_t begin, size_t end);
+
+  /// @brief Adds the segments with a swept AABB overlapping aabb to segments
+  void querySegments(const AABB &aabb, std::vector<bool> &segments) const;
+
+  /**
+   * @brief Checks the states of a segment against the given scene objects
+   * @returns whether the segment is valid, invalid_segments_ is updated
+   */
+  bool checkSegment(size_t segment, const std::vector<ObjectHandle> &objects);
+};
+
+// Common Type Alias ==========================================================
+using PathMonitorf = PathMonitorTpl<float>;
+using PathMonitord = PathMonitorTpl<double>;
+using PathMonitorfPtr = PathMonitorTplPtr<float>;
+using PathMonitordPtr = PathMonitorTplPtr<double>;
+
+// Explicit Template Instantiation Declaration ================================
+#define DECLARE_TEMPLATE_PATH_MONITOR(S) extern template class PathMonitorTpl<S>
+
+DECLARE_TEMPLATE_PATH_MONITOR(float);
+DECLARE_TEMPLATE_PATH_MONITOR(double);
+
+}  // namespace mplib
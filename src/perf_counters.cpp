@@ -0,0 +1,131 @@
+#include "perf_counters.h"
+
+#include <algorithm>
+
+namespace mplib {
+
+/// @brief Counters of a thread, written by that thread only
+struct PerfCounters::ThreadCounts {
+  std::array<std::atomic<uint64_t>, kNumPerfCounters> counts {};
+  std::array<std::atomic<uint64_t>, kNumPerfCounters> nanoseconds {};
+
+  ThreadCounts() {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(this);
+  }
+
+  ~ThreadCounts() {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.exited += load();
+    auto &threads = registry.threads;
+    threads.erase(std::find(threads.begin(), threads.end(), this));
+  }
+
+  PerfCounts load() const {
+    PerfCounts ret;
+    for (size_t i = 0; i < kNumPerfCounters; i++) {
+      ret.counts[i] = counts[i].load(std::memory_order_relaxed);
+      ret.nanoseconds[i] = nanoseconds[i].load(std::memory_order_relaxed);
+    }
+    return ret;
+  }
+};
+
+thread_local PerfCounters::ThreadCounts *PerfCounters::thread_counts_ = nullptr;
+
+std::map<std::string, uint64_t> PerfCounts::getCountsByName() const {
+  std::map<std::string, uint64_t> ret;
+  for (size_t i = 0; i < kNumPerfCounters; i++)
+    if (counts[i] > 0) ret[getPerfCounterName(static_cast<PerfCounter>(i))] = counts[i];
+  return ret;
+}
+
+std::map<std::string, uint64_t> PerfCounts::getNanosecondsByName() const {
+  std::map<std::string, uint64_t> ret;
+  for (size_t i = 0; i < kNumPerfCounters; i++)
+    if (nanoseconds[i] > 0)
+      ret[getPerfCounterName(static_cast<PerfCounter>(i))] = nanoseconds[i];
+  return ret;
+}
+
+PerfCounts &PerfCounts::operator+=(const PerfCounts &other) {
+  for (size_t i = 0; i < kNumPerfCounters; i++) {
+    counts[i] += other.counts[i];
+    nanoseconds[i] += other.nanoseconds[i];
+  }
+  return *this;
+}
+
+PerfCounts &PerfCounts::operator-=(const PerfCounts &other) {
+  // Counters may have been reset in between
+  for (size_t i = 0; i < kNumPerfCounters; i++) {
+    counts[i] -= std::min(counts[i], other.counts[i]);
+    nanoseconds[i] -= std::min(nanoseconds[i], other.nanoseconds[i]);
+  }
+  return *this;
+}
+
+const std::string &getPerfCounterName(PerfCounter counter) {
+  static const std::array<std::string, kNumPerfCounters> names = {
+      "narrowphase_self",
+      "narrowphase_self_articulation",
+      "narrowphase_self_attach",
+      "narrowphase_attach_attach",
+      "narrowphase_articulation_articulation",
+      "narrowphase_articulation_sceneobject",
+      "narrowphase_attach_articulation",
+      "narrowphase_attach_sceneobject",
+      "broadphase_cull",
+      "forward_kinematics",
+      "state_validity_check",
+      "motion_check",
+      "motion_certificate",
+      "self_collision_cache_hit"};
+  return names.at(static_cast<size_t>(counter));
+}
+
+void PerfCounters::addEnabled(PerfCounter counter, uint64_t count,
+                              uint64_t nanoseconds) {
+  // Registered on first use, unregistered at thread exit
+  thread_local ThreadCounts counts;
+  thread_counts_ = &counts;
+  // Only this thread writes, so no read-modify-write is needed
+  const auto i = static_cast<size_t>(counter);
+  auto &count_i = counts.counts[i], &nanoseconds_i = counts.nanoseconds[i];
+  count_i.store(count_i.load(std::memory_order_relaxed) + count,
+                std::memory_order_relaxed);
+  nanoseconds_i.store(nanoseconds_i.load(std::memory_order_relaxed) + nanoseconds,
+                      std::memory_order_relaxed);
+}
+
+PerfCounts PerfCounters::get() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto ret = registry.exited;
+  for (const auto *counts : registry.threads) ret += counts->load();
+  return ret;
+}
+
+PerfCounts PerfCounters::getThread() {
+  return thread_counts_ ? thread_counts_->load() : PerfCounts();
+}
+
+void PerfCounters::reset() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.exited = PerfCounts();
+  for (auto *counts : registry.threads)
+    for (size_t i = 0; i < kNumPerfCounters; i++) {
+      counts->counts[i].store(0, std::memory_order_relaxed);
+      counts->nanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+PerfCounters::Registry &PerfCounters::getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+}  // namespace mplib
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mplib {
+
+/// @brief Performance counters (see PerfCounters)
+enum class PerfCounter : int {
+  // Narrow-phase collision checks, by WorldCollisionType (same order)
+  NARROWPHASE_SELF,
+  NARROWPHASE_SELF_ARTICULATION,
+  NARROWPHASE_SELF_ATTACH,
+  NARROWPHASE_ATTACH_ATTACH,
+  NARROWPHASE_ARTICULATION_ARTICULATION,
+  NARROWPHASE_ARTICULATION_SCENEOBJECT,
+  NARROWPHASE_ATTACH_ARTICULATION,
+  NARROWPHASE_ATTACH_SCENEOBJECT,
+  BROADPHASE_CULL,           // objects or pairs skipped by a bounding box test
+  FORWARD_KINEMATICS,        // PinocchioModel::computeForwardKinematics()
+  STATE_VALIDITY_CHECK,      // states checked by the OMPL validity checkers
+  MOTION_CHECK,              // motions checked by discretization
+  MOTION_CERTIFICATE,        // motions checked by clearance certificates
+  SELF_COLLISION_CACHE_HIT,  // self-collision results reused (see collideSelfPair())
+};
+
+constexpr size_t kNumPerfCounters =
+    static_cast<size_t>(PerfCounter::SELF_COLLISION_CACHE_HIT) + 1;
+
+/// @brief Values of all performance counters
+struct PerfCounts {
+  std::array<uint64_t, kNumPerfCounters> counts {};
+  std::array<uint64_t, kNumPerfCounters> nanoseconds {};  // 0 if not timed
+
+  uint64_t getCount(PerfCounter counter) const {
+    return counts[static_cast<size_t>(counter)];
+  }
+
+  uint64_t getNanoseconds(PerfCounter counter) const {
+    return nanoseconds[static_cast<size_t>(counter)];
+  }
+
+  /// @brief Gets the nonzero counts by counter name (see getPerfCounterName())
+  std::map<std::string, uint64_t> getCountsByName() const;
+
+  /// @brief Gets the nonzero times in nanoseconds by counter name
+  std::map<std::string, uint64_t> getNanosecondsByName() const;
+
+  PerfCounts &operator+=(const PerfCounts &other);
+
+  PerfCounts &operator-=(const PerfCounts &other);
+
+  PerfCounts operator-(const PerfCounts &other) const {
+    auto ret = *this;
+    return ret -= other;
+  }
+};
+
+/// @brief Gets the name of a counter, e.g., "narrowphase_self"
+const std::string &getPerfCounterName(PerfCounter counter);
+
+/**
+ * @brief Opt-in performance counters of collision checking and planning.
+ *  Counters are disabled by default and then cost a relaxed atomic load per event.
+ *  When enabled, each thread increments its own counters, so counting does not
+ *  contend between threads and a query can diff the counters of its thread (e.g.,
+ *  OMPLPlanner::getLastPlanCounts()). Counters of exited threads are kept in the
+ *  totals.
+ */
+class PerfCounters {
+ public:
+  static void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /// @brief Adds to a counter (if enabled)
+  static void add(PerfCounter counter, uint64_t count = 1, uint64_t nanoseconds = 0) {
+    if (isEnabled()) addEnabled(counter, count, nanoseconds);
+  }
+
+  /// @brief Gets the counters summed over all threads
+  static PerfCounts get();
+
+  /// @brief Gets the counters of the calling thread
+  static PerfCounts getThread();
+
+  /// @brief Resets the counters of all threads. Counts of events happening
+  ///  concurrently on other threads may be lost.
+  static void reset();
+
+ private:
+  struct ThreadCounts;
+
+  /// @brief Counters of alive threads and the totals of exited threads
+  struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounts *> threads;
+    PerfCounts exited;
+  };
+
+  inline static std::atomic<bool> enabled_ {false};
+  static thread_local ThreadCounts *thread_counts_;  // null until the first event
+
+  static void addEnabled(PerfCounter counter, uint64_t count, uint64_t nanoseconds);
+
+  static Registry &getRegistry();
+};
+
+/// @brief Counts an event and its duration (from construction to destruction)
+class ScopedPerfTimer {
+ public:
+  explicit ScopedPerfTimer(PerfCounter counter)
+      : counter_(counter), enabled_(PerfCounters::isEnabled()) {
+    if (enabled_) begin_ = Clock::now();
+  }
+
+  ~ScopedPerfTimer() {
+    if (!enabled_) return;
+    const auto duration = Clock::now() - begin_;
+    PerfCounters::add(
+        counter_, 1,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+  }
+
+  ScopedPerfTimer(const ScopedPerfTimer &) = delete;
+  ScopedPerfTimer &operator=(const ScopedPerfTimer &) = delete;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  PerfCounter counter_;
+  bool enabled_;
+  Clock::time_point begin_;
+};
+
+}  // namespace mplib
@@ -7,6 +7,8 @@
 #include <pinocchio/parsers/urdf.hpp>
 #include <urdf_parser/urdf_parser.h>
 
+#include "perf_counters.h"
+#include "trace.h"
 #include "urdf_utils.h"
 
 namespace mplib::pinocchio {
@@ -270,6 +272,7 @@ VectorX<S> PinocchioModelTpl<S>::getRandomConfiguration() const {
 
 template <typename S>
 void PinocchioModelTpl<S>::computeForwardKinematics(const VectorX<S> &qpos) {
+  ScopedPerfTimer timer(PerfCounter::FORWARD_KINEMATICS);
   ::pinocchio::forwardKinematics(model_, data_, qposUser2Pinocchio(qpos));
 }
 
@@ -378,6 +381,7 @@ template <typename S>
 std::tuple<VectorX<S>, bool, Vector6<S>> PinocchioModelTpl<S>::computeIKCLIK(
     size_t index, const Vector7<S> &pose, const VectorX<S> &q_init,
     const std::vector<bool> &mask, double eps, int maxIter, double dt, double damp) {
+  MPLIB_TRACE_SPAN("ik_clik");
   ASSERT(index < static_cast<size_t>(link_index_user2pinocchio_.size()),
          "The link index is out of bound!");
   auto frameId = link_index_user2pinocchio_[index];
@@ -436,6 +440,7 @@ std::tuple<VectorX<S>, bool, Vector6<S>> PinocchioModelTpl<S>::computeIKCLIKJL(
     size_t index, const Vector7<S> &pose, const VectorX<S> &q_init,
     const VectorX<S> &q_min, const VectorX<S> &q_max, double eps, int maxIter,
     double dt, double damp) {
+  MPLIB_TRACE_SPAN("ik_clik_jl");
   ASSERT(index < static_cast<size_t>(link_index_user2pinocchio_.size()),
          "The link index is out of bound!");
   auto frameId = link_index_user2pinocchio_[index];
@@ -1,8 +1,13 @@
 #include "planning_world.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <memory>
+#include <numeric>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include <octomap/OcTree.h>
@@ -10,19 +15,42 @@
 #include "collision_matrix.h"
 #include "macros_utils.h"
 #include "math_utils.h"
+#include "perf_counters.h"
 #include "urdf_utils.h"
 
 namespace mplib {
 
 // Explicit Template Instantiation Definition =================================
-#define DEFINE_TEMPLATE_PLANNING_WORLD(S)    \
-  template class WorldCollisionResultTpl<S>; \
-  template class WorldDistanceResultTpl<S>;  \
+#define DEFINE_TEMPLATE_PLANNING_WORLD(S)          \
+  template class WorldCollisionResultTpl<S>;       \
+  template class WorldCollisionReportTpl<S>;       \
+  template class WorldDistanceResultTpl<S>;        \
+  template class WorldDistanceGradientTpl<S>;      \
+  template class WorldDistanceReportTpl<S>;        \
+  template class TrajectoryValidationResultTpl<S>; \
+  template class CartesianPathResultTpl<S>;        \
   template class PlanningWorldTpl<S>
 
 DEFINE_TEMPLATE_PLANNING_WORLD(float);
 DEFINE_TEMPLATE_PLANNING_WORLD(double);
 
+namespace {
+
+// validateTrajectory() spawns a worker, which copies the world, per this many samples
+constexpr size_t kMinSamplesPerThread = 64;
+
+/// @brief Narrow-phase collision check, counted by collision type (see PerfCounters)
+template <typename S>
+void collideNarrowphase(PerfCounter counter, const ::fcl::CollisionObject<S> *o1,
+                        const ::fcl::CollisionObject<S> *o2,
+                        const ::fcl::CollisionRequest<S> &request,
+                        ::fcl::CollisionResult<S> &result) {
+  ScopedPerfTimer timer(counter);
+  ::fcl::collide(o1, o2, request, result);
+}
+
+}  // namespace
+
 template <typename S>
 PlanningWorldTpl<S>::PlanningWorldTpl(
     const std::vector<ArticulatedModelPtr> &articulations,
@@ -40,10 +68,46 @@ PlanningWorldTpl<S>::PlanningWorldTpl(
     planned_articulations_[articulation_names[i]] = articulations[i];
   }
   for (size_t i = 0; i < normal_objects.size(); i++) {
-    normal_objects_[normal_object_names[i]] = normal_objects[i];
+    normal_objects_.add(normal_object_names[i], normal_objects[i]);
   }
 }
 
+template <typename S>
+std::unique_ptr<PlanningWorldTpl<S>> PlanningWorldTpl<S>::clone() const {
+  auto world = std::make_unique<PlanningWorldTpl<S>>(
+      std::vector<ArticulatedModelPtr>(), std::vector<std::string>());
+  for (const auto &[name, art] : articulations_) {
+    ArticulatedModelPtr art_copy = art->clone();
+    world->articulations_[name] = art_copy;
+    if (planned_articulations_.find(name) != planned_articulations_.end())
+      world->planned_articulations_[name] = art_copy;
+  }
+
+  // Geometries are shared, only the (posed) objects are copied
+  world->normal_objects_ = normal_objects_;
+  const auto &objects = normal_objects_.getObjects();
+  const auto &object_names = normal_objects_.getNames();
+  for (size_t k = 0; k < objects.size(); k++) {
+    auto geometry = std::const_pointer_cast<fcl::CollisionGeometry<S>>(
+        objects[k]->collisionGeometry());
+    world->normal_objects_.add(
+        object_names[k],
+        std::make_shared<CollisionObject>(geometry, objects[k]->getTransform()));
+  }
+
+  for (const auto &[name, body] : attached_bodies_)
+    world->attached_bodies_[name] = std::make_shared<AttachedBody>(
+        name, world->normal_objects_.getObject(world->normal_objects_.getHandle(name)),
+        world->articulations_.at(body->getAttachedArticulation()->getName()),
+        body->getAttachedLinkId(), body->getPose(), body->getTouchLinks());
+
+  world->acm_ = std::make_shared<AllowedCollisionMatrix>(*acm_);
+  world->object_trajectories_ = object_trajectories_;
+  world->articulation_trajectories_ = articulation_trajectories_;
+  world->time_ = time_;
+  return world;
+}
+
 template <typename S>
 std::vector<std::string> PlanningWorldTpl<S>::getArticulationNames() const {
   std::vector<std::string> names;
@@ -59,6 +123,13 @@ std::vector<ArticulatedModelTplPtr<S>> PlanningWorldTpl<S>::getPlannedArticulati
   return arts;
 }
 
+template <typename S>
+std::vector<std::string> PlanningWorldTpl<S>::getPlannedArticulationNames() const {
+  std::vector<std::string> names;
+  for (const auto &pair : planned_articulations_) names.push_back(pair.first);
+  return names;
+}
+
 template <typename S>
 void PlanningWorldTpl<S>::addArticulation(const std::string &name,
                                           const ArticulatedModelPtr &model,
@@ -73,6 +144,7 @@ bool PlanningWorldTpl<S>::removeArticulation(const std::string &name) {
   auto nh = articulations_.extract(name);
   if (nh.empty()) return false;
   planned_articulations_.erase(name);
+  articulation_trajectories_.erase(name);
   // Update acm_
   auto art_link_names = nh.mapped()->getUserLinkNames();
   acm_->removeEntry(art_link_names);
@@ -93,9 +165,7 @@ void PlanningWorldTpl<S>::setArticulationPlanned(const std::string &name,
 
 template <typename S>
 std::vector<std::string> PlanningWorldTpl<S>::getNormalObjectNames() const {
-  std::vector<std::string> names;
-  for (const auto &pair : normal_objects_) names.push_back(pair.first);
-  return names;
+  return normal_objects_.getNames();
 }
 
 template <typename S>
@@ -105,27 +175,187 @@ void PlanningWorldTpl<S>::addPointCloud(const std::string &name,
   auto tree = std::make_shared<octomap::OcTree>(resolution);
   for (const auto &row : vertices.rowwise())
     tree->updateNode(octomap::point3d(row(0), row(1), row(2)), true);
-  auto obj = std::make_shared<CollisionObject>(std::make_shared<fcl::OcTree<S>>(tree));
+  // Keeps the octomap tree so that the octree can be shared (see SharedGeometryStore)
+  auto obj = std::make_shared<CollisionObject>(
+      std::make_shared<fcl::SourceOcTreeTpl<S>>(tree));
   addNormalObject(name, obj);
 }
 
+template <typename S>
+std::vector<std::pair<std::string, typename PlanningWorldTpl<S>::CollisionGeometryPtr>>
+PlanningWorldTpl<S>::getShareableGeometries() const {
+  std::vector<std::pair<std::string, CollisionGeometryPtr>> ret;
+  for (const auto &[name, art] : articulations_)
+    for (auto &pair : art->getFCLModel()->getMeshGeometries())
+      ret.push_back(std::move(pair));
+  const auto &names = normal_objects_.getNames();
+  const auto &objects = normal_objects_.getObjects();
+  for (size_t i = 0; i < objects.size(); i++) {
+    auto geometry = std::const_pointer_cast<fcl::CollisionGeometry<S>>(
+        objects[i]->collisionGeometry());
+    if (std::dynamic_pointer_cast<fcl::BVHModel_OBBRSS<S>>(geometry) ||
+        std::dynamic_pointer_cast<fcl::Convex<S>>(geometry) ||
+        std::dynamic_pointer_cast<fcl::SourceOcTreeTpl<S>>(geometry))
+      ret.emplace_back(names[i], geometry);
+  }
+  return ret;
+}
+
+template <typename S>
+ObjectHandle PlanningWorldTpl<S>::addSharedObject(const std::string &name,
+                                                  const SharedGeometryStorePtr &store,
+                                                  const Vector7<S> &pose) {
+  auto geometry = store->getGeometry(name);
+  ASSERT(geometry, "Shared geometry store " + store->getName() + " has no geometry " +
+                       name);
+  return addNormalObject(
+      name, std::make_shared<CollisionObject>(geometry, posevec_to_transform(pose)));
+}
+
 template <typename S>
 bool PlanningWorldTpl<S>::removeNormalObject(const std::string &name) {
-  auto nh = normal_objects_.extract(name);
-  if (nh.empty()) return false;
+  if (!normal_objects_.remove(name)) return false;
   attached_bodies_.erase(name);
+  object_trajectories_.erase(name);
   // Update acm_
   acm_->removeEntry(name);
   acm_->removeDefaultEntry(name);
   return true;
 }
 
+template <typename S>
+void PlanningWorldTpl<S>::setObjectPoses(const std::vector<std::string> &names,
+                                         const MatrixX7<S> &poses,
+                                         bool update_attached_object) {
+  std::vector<ObjectHandle> handles;
+  handles.reserve(names.size());
+  for (const auto &name : names) {
+    auto handle = normal_objects_.getHandle(name);
+    ASSERT(handle.isSet(), "Normal object " + name + " does not exist");
+    handles.push_back(handle);
+  }
+  setObjectPoses(handles, poses, update_attached_object);
+}
+
+template <typename S>
+void PlanningWorldTpl<S>::setObjectPoses(const std::vector<ObjectHandle> &handles,
+                                         const MatrixX7<S> &poses,
+                                         bool update_attached_object) {
+  ASSERT(static_cast<size_t>(poses.rows()) == handles.size(),
+         "Number of poses (" + std::to_string(poses.rows()) +
+             ") does not match number of objects (" +
+             std::to_string(handles.size()) + ")");
+  const auto &objects = normal_objects_.getObjects();
+  const auto &offsets = normal_objects_.getOffsets();
+  for (size_t i = 0; i < handles.size(); i++) {
+    const auto k = normal_objects_.getIndex(handles[i]);
+    const Transform3<S> pose =
+        posevec_to_transform<S>(poses.row(i).transpose()) * offsets[k];
+
+    if (normal_objects_.isAttached(k)) {
+      const auto &body = attached_bodies_.at(normal_objects_.getNames()[k]);
+      if (update_attached_object) {
+        const auto link_pose = posevec_to_transform<S>(
+            body->getAttachedArticulation()
+                ->getLinkPoses()
+                .row(body->getAttachedLinkId())
+                .transpose());
+        body->setPose(link_pose.inverse() * pose);
+      }
+      body->updatePose();
+    } else
+      objects[k]->setTransform(pose);
+  }
+}
+
+template <typename S>
+void PlanningWorldTpl<S>::setObjectTrajectory(const std::string &name,
+                                              const VectorX<S> &times,
+                                              const MatrixX7<S> &poses) {
+  ASSERT(normal_objects_.contains(name), "Normal object " + name + " does not exist");
+  ASSERT(times.size() > 0 && times.size() == poses.rows(),
+         "Number of time stamps (" + std::to_string(times.size()) +
+             ") does not match number of poses (" + std::to_string(poses.rows()) +
+             ") or is zero");
+  for (int i = 1; i < times.size(); i++)
+    ASSERT(times[i] > times[i - 1], "Time stamps should be increasing");
+  const auto &trajectory = object_trajectories_[name] = {times, poses};
+  if (!isNormalObjectAttached(name))
+    setObjectPoses({name}, trajectory.getPose(time_).transpose());
+}
+
+template <typename S>
+bool PlanningWorldTpl<S>::removeObjectTrajectory(const std::string &name) {
+  return object_trajectories_.erase(name) > 0;
+}
+
+template <typename S>
+std::vector<std::string> PlanningWorldTpl<S>::getDynamicObjectNames() const {
+  std::vector<std::string> names;
+  for (const auto &pair : object_trajectories_) names.push_back(pair.first);
+  return names;
+}
+
+template <typename S>
+void PlanningWorldTpl<S>::setArticulationTrajectory(const std::string &name,
+                                                   const VectorX<S> &times,
+                                                   const MatrixX<S> &qposes) {
+  auto art = getArticulation(name);
+  ASSERT(art != nullptr, "Articulation " + name + " does not exist");
+  ASSERT(times.size() > 0 && times.size() == qposes.rows(),
+         "Number of time stamps (" + std::to_string(times.size()) +
+             ") does not match number of qposes (" + std::to_string(qposes.rows()) +
+             ") or is zero");
+  ASSERT(static_cast<size_t>(qposes.cols()) == art->getQposDim(),
+         "Dim of qposes is not equal to dim of move group qpos");
+  for (int i = 1; i < times.size(); i++)
+    ASSERT(times[i] > times[i - 1], "Time stamps should be increasing");
+  articulation_trajectories_[name] = {times, qposes};
+  art->setQpos(interpolate_trajectory<S>(times, qposes, time_));
+  updateAttachedBodiesPose();
+}
+
+template <typename S>
+bool PlanningWorldTpl<S>::removeArticulationTrajectory(const std::string &name) {
+  return articulation_trajectories_.erase(name) > 0;
+}
+
+template <typename S>
+void PlanningWorldTpl<S>::setTime(S time) {
+  time_ = time;
+  for (const auto &[name, trajectory] : articulation_trajectories_)
+    articulations_.at(name)->setQpos(
+        interpolate_trajectory<S>(trajectory.times, trajectory.qposes, time));
+  if (!articulation_trajectories_.empty()) updateAttachedBodiesPose();
+
+  std::vector<std::string> names;
+  MatrixX7<S> poses(object_trajectories_.size(), 7);
+  for (const auto &[name, trajectory] : object_trajectories_)
+    if (!isNormalObjectAttached(name)) {
+      poses.row(names.size()) = trajectory.getPose(time).transpose();
+      names.push_back(name);
+    }
+  poses.conservativeResize(names.size(), 7);
+  setObjectPoses(names, poses);
+}
+
+template <typename S>
+Vector7<S> PlanningWorldTpl<S>::ObjectTrajectory::getPose(S time) const {
+  const auto [i, t] = find_trajectory_segment(times, time);
+  if (t == 0) return poses.row(i).transpose();
+  return interpolate_posevec<S>(poses.row(i).transpose(), poses.row(i + 1).transpose(),
+                                t);
+}
+
 template <typename S>
 void PlanningWorldTpl<S>::attachObject(const std::string &name,
                                        const std::string &art_name, int link_id,
                                        const Vector7<S> &pose,
                                        const std::vector<std::string> &touch_links) {
-  auto obj = normal_objects_.at(name);
+  const auto handle = normal_objects_.getHandle(name);
+  if (!handle.isSet())
+    throw std::out_of_range("Normal object " + name + " does not exist");
+  auto obj = normal_objects_.getObject(handle);
   auto nh = attached_bodies_.extract(name);
   auto body =
       std::make_shared<AttachedBody>(name, obj, planned_articulations_.at(art_name),
@@ -137,6 +367,7 @@ void PlanningWorldTpl<S>::attachObject(const std::string &name,
     attached_bodies_.insert(std::move(nh));
   } else
     attached_bodies_[name] = body;
+  normal_objects_.setAttached(handle, true);
   // Update acm_ to allow collision between name and touch_links
   acm_->setEntry(name, touch_links, true);
 }
@@ -145,7 +376,10 @@ template <typename S>
 void PlanningWorldTpl<S>::attachObject(const std::string &name,
                                        const std::string &art_name, int link_id,
                                        const Vector7<S> &pose) {
-  auto obj = normal_objects_.at(name);
+  const auto handle = normal_objects_.getHandle(name);
+  if (!handle.isSet())
+    throw std::out_of_range("Normal object " + name + " does not exist");
+  auto obj = normal_objects_.getObject(handle);
   auto nh = attached_bodies_.extract(name);
   auto body =
       std::make_shared<AttachedBody>(name, obj, planned_articulations_.at(art_name),
@@ -156,9 +390,10 @@ void PlanningWorldTpl<S>::attachObject(const std::string &name,
     attached_bodies_.insert(std::move(nh));
   } else {
     attached_bodies_[name] = body;
+    normal_objects_.setAttached(handle, true);
     // Set touch_links to the name of self links colliding with object currently
     std::vector<std::string> touch_links;
-    auto collisions = selfCollide();
+    auto collisions = selfCollide(CollisionRequest(), CollisionReportLevel::PAIRS);
     for (const auto &collision : collisions)
       if (collision.link_name1 == name)
         touch_links.push_back(collision.link_name2);
@@ -220,7 +455,7 @@ void PlanningWorldTpl<S>::attachMesh(const std::string &mesh_path,
 template <typename S>
 bool PlanningWorldTpl<S>::detachObject(const std::string &name, bool also_remove) {
   if (also_remove) {
-    normal_objects_.erase(name);
+    normal_objects_.remove(name);
     // Update acm_
     acm_->removeEntry(name);
     acm_->removeDefaultEntry(name);
@@ -228,6 +463,8 @@ bool PlanningWorldTpl<S>::detachObject(const std::string &name, bool also_remove
 
   auto nh = attached_bodies_.extract(name);
   if (nh.empty()) return false;
+  if (auto handle = normal_objects_.getHandle(name); handle.isSet())
+    normal_objects_.setAttached(handle, false);
   // Update acm_ to disallow collision between name and touch_links
   acm_->removeEntry(name, nh.mapped()->getTouchLinks());
   return true;
@@ -262,22 +499,43 @@ void PlanningWorldTpl<S>::setQposAll(const VectorX<S> &state) const {
 }
 
 template <typename S>
-std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::filterCollisions(
-    const std::vector<WorldCollisionResultTpl<S>> &collisions) const {
-  std::vector<WorldCollisionResult> ret;
-  for (const auto &collision : collisions)
-    if (auto type =
-            acm_->getAllowedCollision(collision.link_name1, collision.link_name2);
-        !type || type == AllowedCollision::NEVER)
-      ret.push_back(collision);
+fcl::CollisionRequest<S> PlanningWorldTpl<S>::getLevelRequest(
+    const CollisionRequest &request, CollisionReportLevel level) {
+  auto ret = request;
+  switch (level) {
+    case CollisionReportLevel::BOOL:
+    case CollisionReportLevel::PAIRS:
+      ret.num_max_contacts = 1;
+      ret.enable_contact = false;
+      ret.enable_cost = false;
+      break;
+    case CollisionReportLevel::CONTACTS:
+      ret.enable_contact = true;
+      ret.enable_cost = false;
+      break;
+    case CollisionReportLevel::FULL:
+      break;
+  }
   return ret;
 }
 
+template <typename S>
+bool PlanningWorldTpl<S>::addCollision(std::vector<WorldCollisionResult> &collisions,
+                                       WorldCollisionResult &&collision,
+                                       CollisionReportLevel level) const {
+  if (auto type = acm_->getAllowedCollision(collision.link_name1, collision.link_name2);
+      type && type != AllowedCollision::NEVER)
+    return false;
+  collisions.push_back(std::move(collision));
+  return level == CollisionReportLevel::BOOL;
+}
+
 template <typename S>
 std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
-    const CollisionRequest &request) const {
+    const CollisionRequest &request, CollisionReportLevel level) const {
   std::vector<WorldCollisionResult> ret;
   CollisionResult result;
+  const auto req = getLevelRequest(request, level);
 
   updateAttachedBodiesPose();
 
@@ -289,19 +547,20 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
     auto col_pairs = fcl_model->getCollisionPairs();
 
     // Articulation self-collision
-    auto results = fcl_model->collideFull(request);
-    for (size_t i = 0; i < results.size(); i++)
-      if (results[i].isCollision()) {
+    for (size_t i = 0; i < col_pairs.size(); i++) {
+      art->collideSelfPair(i, req, result);
+      if (result.isCollision()) {
+        const auto &[x, y] = col_pairs[i];
         WorldCollisionResult tmp;
-        auto x = col_pairs[i].first, y = col_pairs[i].second;
-        tmp.res = results[i];
+        tmp.res = result;
         tmp.collision_type = "self";
         tmp.object_name1 = art_name;
         tmp.object_name2 = art_name;
         tmp.link_name1 = col_link_names[x];
         tmp.link_name2 = col_link_names[y];
-        ret.push_back(tmp);
+        if (addCollision(ret, std::move(tmp), level)) return ret;
       }
+    }
 
     // Collision among planned_articulations_
     for (const auto &[art_name2, art2] : planned_articulations_) {
@@ -313,7 +572,8 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
       for (size_t i = 0; i < col_objs.size(); i++)
         for (size_t j = 0; j < col_objs2.size(); j++) {
           result.clear();
-          ::fcl::collide(col_objs[i].get(), col_objs2[j].get(), request, result);
+          collideNarrowphase(PerfCounter::NARROWPHASE_SELF_ARTICULATION,
+                             col_objs[i].get(), col_objs2[j].get(), req, result);
           if (result.isCollision()) {
             WorldCollisionResult tmp;
             tmp.res = result;
@@ -322,7 +582,7 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
             tmp.object_name2 = art_name2;
             tmp.link_name1 = col_link_names[i];
             tmp.link_name2 = col_link_names2[j];
-            ret.push_back(tmp);
+            if (addCollision(ret, std::move(tmp), level)) return ret;
           }
         }
     }
@@ -332,7 +592,8 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
       auto attached_obj = attached_body->getObject();
       for (size_t i = 0; i < col_objs.size(); i++) {
         result.clear();
-        ::fcl::collide(attached_obj.get(), col_objs[i].get(), request, result);
+        collideNarrowphase(PerfCounter::NARROWPHASE_SELF_ATTACH, attached_obj.get(),
+                           col_objs[i].get(), req, result);
         if (result.isCollision()) {
           WorldCollisionResult tmp;
           tmp.res = result;
@@ -341,7 +602,7 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
           tmp.object_name2 = attached_body_name;
           tmp.link_name1 = col_link_names[i];
           tmp.link_name2 = attached_body_name;
-          ret.push_back(tmp);
+          if (addCollision(ret, std::move(tmp), level)) return ret;
         }
       }
     }
@@ -351,8 +612,9 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
   for (auto it = attached_bodies_.begin(); it != attached_bodies_.end(); ++it)
     for (auto it2 = attached_bodies_.begin(); it2 != it; ++it2) {
       result.clear();
-      ::fcl::collide(it->second->getObject().get(), it2->second->getObject().get(),
-                     request, result);
+      collideNarrowphase(PerfCounter::NARROWPHASE_ATTACH_ATTACH,
+                         it->second->getObject().get(),
+                         it2->second->getObject().get(), req, result);
       if (result.isCollision()) {
         auto name1 = it->first, name2 = it2->first;
         WorldCollisionResult tmp;
@@ -362,29 +624,49 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::selfCollide(
         tmp.object_name2 = name2;
         tmp.link_name1 = name1;
         tmp.link_name2 = name2;
-        ret.push_back(tmp);
+        if (addCollision(ret, std::move(tmp), level)) return ret;
       }
     }
-  return filterCollisions(ret);
+  return ret;
+}
+
+template <typename S>
+std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
+    const CollisionRequest &request, CollisionReportLevel level) const {
+  std::vector<size_t> scene_object_ids;  // dense indices into normal_objects_
+  for (size_t k = 0; k < normal_objects_.size(); k++)
+    if (!normal_objects_.isAttached(k)) scene_object_ids.push_back(k);
+  return collideWithSceneSubset(scene_object_ids, request, level);
 }
 
 template <typename S>
 std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
-    const CollisionRequest &request) const {
+    const std::vector<ObjectHandle> &scene_objects, const CollisionRequest &request,
+    CollisionReportLevel level) const {
+  std::vector<size_t> scene_object_ids;
+  for (const auto &handle : scene_objects)
+    if (auto k = normal_objects_.getIndex(handle); !normal_objects_.isAttached(k))
+      scene_object_ids.push_back(k);
+  return collideWithSceneSubset(scene_object_ids, request, level);
+}
+
+template <typename S>
+std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithSceneSubset(
+    const std::vector<size_t> &scene_object_ids, const CollisionRequest &request,
+    CollisionReportLevel level) const {
   std::vector<WorldCollisionResult> ret;
   CollisionResult result;
+  const auto req = getLevelRequest(request, level);
 
   updateAttachedBodiesPose();
 
-  // Collect unplanned articulations, not attached scene objects
+  // Collect unplanned articulations
   std::vector<ArticulatedModelPtr> unplanned_articulations;
-  std::unordered_map<std::string, CollisionObjectPtr> scene_objects;
   for (const auto &[name, art] : articulations_)
     if (planned_articulations_.find(name) == planned_articulations_.end())
       unplanned_articulations.push_back(art);
-  for (const auto &[name, obj] : normal_objects_)
-    if (attached_bodies_.find(name) == attached_bodies_.end())
-      scene_objects[name] = obj;
+  const auto &object_names = normal_objects_.getNames();
+  const auto &objects = normal_objects_.getObjects();
 
   // Collision involving planned articulation
   for (const auto &[art_name, art] : planned_articulations_) {
@@ -402,7 +684,8 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
       for (size_t i = 0; i < col_objs.size(); i++)
         for (size_t j = 0; j < col_objs2.size(); j++) {
           result.clear();
-          ::fcl::collide(col_objs[i].get(), col_objs2[j].get(), request, result);
+          collideNarrowphase(PerfCounter::NARROWPHASE_ARTICULATION_ARTICULATION,
+                             col_objs[i].get(), col_objs2[j].get(), req, result);
           if (result.isCollision()) {
             WorldCollisionResult tmp;
             tmp.res = result;
@@ -411,16 +694,19 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
             tmp.object_name2 = art_name2;
             tmp.link_name1 = col_link_names[i];
             tmp.link_name2 = col_link_names2[j];
-            ret.push_back(tmp);
+            if (addCollision(ret, std::move(tmp), level)) return ret;
           }
         }
     }
 
     // Collision with scene objects
-    for (const auto &[name, obj] : scene_objects)
+    for (auto k : scene_object_ids) {
+      const auto &name = object_names[k];
+      const auto &obj = objects[k];
       for (size_t i = 0; i < col_objs.size(); i++) {
         result.clear();
-        ::fcl::collide(col_objs[i].get(), obj.get(), request, result);
+        collideNarrowphase(PerfCounter::NARROWPHASE_ARTICULATION_SCENEOBJECT,
+                           col_objs[i].get(), obj.get(), req, result);
         if (result.isCollision()) {
           WorldCollisionResult tmp;
           tmp.res = result;
@@ -429,9 +715,10 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
           tmp.object_name2 = name;
           tmp.link_name1 = col_link_names[i];
           tmp.link_name2 = name;
-          ret.push_back(tmp);
+          if (addCollision(ret, std::move(tmp), level)) return ret;
         }
       }
+    }
   }
 
   // Collision involving attached_bodies_
@@ -447,7 +734,8 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
 
       for (size_t i = 0; i < col_objs2.size(); i++) {
         result.clear();
-        ::fcl::collide(attached_obj.get(), col_objs2[i].get(), request, result);
+        collideNarrowphase(PerfCounter::NARROWPHASE_ATTACH_ARTICULATION,
+                           attached_obj.get(), col_objs2[i].get(), req, result);
         if (result.isCollision()) {
           WorldCollisionResult tmp;
           tmp.res = result;
@@ -456,15 +744,18 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
           tmp.object_name2 = art_name2;
           tmp.link_name1 = attached_body_name;
           tmp.link_name2 = col_link_names2[i];
-          ret.push_back(tmp);
+          if (addCollision(ret, std::move(tmp), level)) return ret;
         }
       }
     }
 
     // Collision with scene objects
-    for (const auto &[name, obj] : scene_objects) {
+    for (auto k : scene_object_ids) {
+      const auto &name = object_names[k];
+      const auto &obj = objects[k];
       result.clear();
-      ::fcl::collide(attached_obj.get(), obj.get(), request, result);
+      collideNarrowphase(PerfCounter::NARROWPHASE_ATTACH_SCENEOBJECT,
+                         attached_obj.get(), obj.get(), req, result);
       if (result.isCollision()) {
         WorldCollisionResult tmp;
         tmp.res = result;
@@ -473,22 +764,338 @@ std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideWithOthers(
         tmp.object_name2 = name;
         tmp.link_name1 = attached_body_name;
         tmp.link_name2 = name;
-        ret.push_back(tmp);
+        if (addCollision(ret, std::move(tmp), level)) return ret;
       }
     }
   }
-  return filterCollisions(ret);
+  return ret;
 }
 
 template <typename S>
 std::vector<WorldCollisionResultTpl<S>> PlanningWorldTpl<S>::collideFull(
-    const CollisionRequest &request) const {
-  auto ret1 = selfCollide(request);
-  auto ret2 = collideWithOthers(request);
+    const CollisionRequest &request, CollisionReportLevel level) const {
+  auto ret1 = selfCollide(request, level);
+  if (level == CollisionReportLevel::BOOL && !ret1.empty()) return ret1;
+  auto ret2 = collideWithOthers(request, level);
   ret1.insert(ret1.end(), ret2.begin(), ret2.end());
   return ret1;
 }
 
+template <typename S>
+std::vector<fcl::AABB<S>> PlanningWorldTpl<S>::getPlannedAABBs() const {
+  std::vector<AABB> ret;
+  for (const auto &[art_name, art] : planned_articulations_)
+    for (const auto &col_obj : art->getFCLModel()->getCollisionObjects()) {
+      col_obj->computeAABB();
+      ret.push_back(col_obj->getAABB());
+    }
+
+  updateAttachedBodiesPose();
+  for (const auto &[attached_body_name, attached_body] : attached_bodies_) {
+    auto attached_obj = attached_body->getObject();
+    attached_obj->computeAABB();
+    ret.push_back(attached_obj->getAABB());
+  }
+  return ret;
+}
+
+template <typename S>
+TrajectoryValidationResultTpl<S> PlanningWorldTpl<S>::validateTrajectory(
+    const MatrixX<S> &qs, S resolution, size_t num_threads) const {
+  ASSERT(resolution > 0, "resolution should be positive");
+  size_t dim = 0;
+  for (const auto &[art_name, art] : planned_articulations_) dim += art->getQposDim();
+  ASSERT(static_cast<size_t>(qs.cols()) == dim,
+         "Waypoint dimension (" + std::to_string(qs.cols()) +
+             ") does not match the state dimension (" + std::to_string(dim) + ")");
+
+  // Densify: (waypoint index, fraction along the segment ending at the waypoint)
+  std::vector<std::pair<int, S>> samples;
+  for (int i = 0; i < qs.rows(); i++) {
+    if (i == 0) {
+      samples.emplace_back(0, 1);
+      continue;
+    }
+    const S max_motion = (qs.row(i) - qs.row(i - 1)).cwiseAbs().maxCoeff();
+    const int n = std::max(static_cast<int>(std::ceil(max_motion / resolution)), 1);
+    for (int j = 1; j <= n; j++) samples.emplace_back(i, static_cast<S>(j) / n);
+  }
+  auto get_qpos = [&](size_t k) -> VectorX<S> {
+    const auto [i, t] = samples[k];
+    if (i == 0) return qs.row(0).transpose();
+    return ((1 - t) * qs.row(i - 1) + t * qs.row(i)).transpose();
+  };
+
+  TrajectoryValidationResult ret;
+  if (samples.empty()) return ret;
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  // A copy of the world costs about as much as tens of collision checks
+  num_threads = std::clamp<size_t>(samples.size() / kMinSamplesPerThread, 1,
+                                   num_threads);
+
+  // Workers take samples in increasing order and stop at their first invalid
+  // sample, so all samples before the smallest invalid one get checked
+  std::atomic<size_t> next_sample {0}, first_invalid {samples.size()};
+  std::vector<std::pair<size_t, WorldCollisionResult>> invalid_samples(
+      num_threads, {samples.size(), {}});
+  // The first worker checks this world, which is restored afterwards. Copies are
+  // made before any worker moves it.
+  std::vector<std::unique_ptr<PlanningWorldTpl<S>>> copies;
+  for (size_t i = 1; i < num_threads; i++) copies.push_back(clone());
+  auto worker = [&](size_t thread_id) {
+    const auto world = thread_id > 0 ? copies[thread_id - 1].get() : this;
+    for (size_t k; (k = next_sample++) < first_invalid;) {
+      world->setQposAll(get_qpos(k));
+      auto collisions =
+          world->collideFull(CollisionRequest(), CollisionReportLevel::BOOL);
+      if (collisions.empty()) continue;
+      invalid_samples[thread_id] = {k, std::move(collisions[0])};
+      auto current = first_invalid.load();
+      while (k < current && !first_invalid.compare_exchange_weak(current, k)) {
+      }
+      break;
+    }
+  };
+  std::vector<std::pair<ArticulatedModelPtr, VectorX<S>>> qposes;
+  for (const auto &[art_name, art] : planned_articulations_)
+    qposes.emplace_back(art, art->getQpos());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) threads.emplace_back(worker, i);
+  worker(0);
+  for (auto &thread : threads) thread.join();
+  for (const auto &[art, qpos] : qposes) art->setQpos(qpos, true);
+
+  const auto &[k, collision] = *std::min_element(
+      invalid_samples.begin(), invalid_samples.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; });
+  if (k == samples.size()) return ret;
+  ret.valid = false;
+  ret.index = samples[k].first;
+  ret.fraction = samples[k].second;
+  ret.qpos = get_qpos(k);
+  ret.collision = collision;
+  return ret;
+}
+
+template <typename S>
+CartesianPathResultTpl<S> PlanningWorldTpl<S>::computeCartesianPath(
+    const std::string &art_name, size_t link_index, const MatrixX7<S> &waypoints,
+    S eef_step, S jump_threshold, S resolution, size_t num_threads) {
+  ASSERT(eef_step > 0, "eef_step should be positive");
+  auto it = planned_articulations_.find(art_name);
+  ASSERT(it != planned_articulations_.end(),
+         "Planned articulation " + art_name + " does not exist");
+  const auto art = it->second;
+  const auto pinocchio_model = art->getPinocchioModel();
+  const auto &move_group = art->getMoveGroupJointIndices();
+  const VectorX<S> init_qpos = art->getQpos();
+
+  // Interpolate so that the link moves at most eef_step per step
+  std::vector<Vector7<S>> poses;
+  Vector7<S> prev = art->getLinkPoses().row(link_index).transpose();
+  for (int i = 0; i < waypoints.rows(); i++) {
+    const Vector7<S> pose = waypoints.row(i).transpose();
+    const S translation = (pose.head(3) - prev.head(3)).norm();
+    const S rotation = Quaternion<S>(prev[3], prev[4], prev[5], prev[6])
+                           .angularDistance(
+                               Quaternion<S>(pose[3], pose[4], pose[5], pose[6]));
+    const int n = std::max(
+        static_cast<int>(std::ceil(std::max(translation, rotation) / eef_step)), 1);
+    for (int j = 1; j <= n; j++)
+      poses.push_back(interpolate_posevec<S>(prev, pose, static_cast<S>(j) / n));
+    prev = pose;
+  }
+
+  // IK only moves the move group joints
+  std::vector<bool> mask(art->getUserJointNames().size(), true);
+  for (auto i : move_group) mask[i] = false;
+  const std::string joint_prefix = "JointModel";
+  std::vector<MatrixX<S>> limits;
+  std::vector<bool> bounded;  // continuous joints are unbounded
+  for (auto i : move_group) {
+    const auto joint_type = pinocchio_model->getJointType(i);
+    limits.push_back(pinocchio_model->getJointLimit(i));
+    bounded.push_back(!(joint_type[joint_prefix.size()] == 'R' &&
+                        joint_type[joint_prefix.size() + 1] == 'U'));
+  }
+  auto within_limits = [&](const VectorX<S> &qpos) {
+    for (size_t k = 0; k < move_group.size(); k++)
+      if (bounded[k] && (qpos[k] < limits[k](0, 0) || qpos[k] > limits[k](0, 1)))
+        return false;
+    return true;
+  };
+
+  // Solve IK of each step, warm-started from the previous step
+  std::vector<VectorX<S>> qposes {art->getMoveGroupQpos()};
+  VectorX<S> qpos = init_qpos;
+  for (const auto &pose : poses) {
+    const auto [ik_qpos, success, error] =
+        pinocchio_model->computeIKCLIK(link_index, pose, qpos, mask);
+    if (!success) break;
+    auto move_group_qpos = art->getMoveGroupQpos(ik_qpos);
+    if (!within_limits(move_group_qpos)) break;
+    qposes.push_back(std::move(move_group_qpos));
+    qpos = ik_qpos;
+  }
+  // IK moved the kinematic model, restore it
+  art->setQpos(init_qpos, true);
+
+  // Stop at the first step moving much more than the mean (configuration jump)
+  if (jump_threshold > 0 && qposes.size() > 1) {
+    std::vector<S> motions;
+    for (size_t i = 1; i < qposes.size(); i++)
+      motions.push_back((qposes[i] - qposes[i - 1]).cwiseAbs().sum());
+    const S mean = std::accumulate(motions.begin(), motions.end(), S(0)) /
+                   static_cast<S>(motions.size());
+    for (size_t i = 0; i < motions.size(); i++)
+      if (motions[i] > jump_threshold * mean) {
+        qposes.resize(i + 1);
+        break;
+      }
+  }
+
+  // Check collision of all steps in batch, other planned articulations stay put
+  VectorX<S> state(0);
+  size_t offset = 0;
+  for (const auto &[name, planned_art] : planned_articulations_) {
+    if (name == art_name) offset = state.size();
+    const auto art_qpos = planned_art->getMoveGroupQpos();
+    state.conservativeResize(state.size() + art_qpos.size());
+    state.tail(art_qpos.size()) = art_qpos;
+  }
+  MatrixX<S> qs(qposes.size(), state.size());
+  for (size_t i = 0; i < qposes.size(); i++) {
+    qs.row(i) = state.transpose();
+    qs.row(i).segment(offset, qposes[i].size()) = qposes[i].transpose();
+  }
+  const auto validation = validateTrajectory(qs, resolution, num_threads);
+  // Waypoints before the first invalid segment are valid
+  const size_t len = validation.valid ? qposes.size() : validation.index;
+
+  CartesianPathResult ret;
+  ret.path.resize(len, art->getQposDim());
+  for (size_t i = 0; i < len; i++) ret.path.row(i) = qposes[i].transpose();
+  if (len > 0)
+    ret.fraction = poses.empty() ? 1 : static_cast<S>(len - 1) / poses.size();
+  return ret;
+}
+
+template <typename S>
+MatrixX<S> PlanningWorldTpl<S>::getDisplacementBounds() const {
+  // Offset of each planned articulation's qpos in the state
+  std::unordered_map<const ArticulatedModelTpl<S> *, size_t> state_offsets;
+  size_t dim = 0;
+  for (const auto &[art_name, art] : planned_articulations_) {
+    state_offsets[art.get()] = dim;
+    dim += art->getQposDim();
+  }
+
+  const auto aabbs = getPlannedAABBs();
+  MatrixX<S> ret = MatrixX<S>::Zero(aabbs.size(), dim);
+  size_t row = 0;
+  auto add_bound = [&](const ArticulatedModelPtr &art, size_t link_index) {
+    const auto &aabb = aabbs[row];
+    if (auto it = state_offsets.find(art.get()); it != state_offsets.end())
+      ret.row(row).segment(it->second, art->getQposDim()) =
+          art->getDisplacementBound(link_index, aabb.center(), aabb.radius())
+              .transpose();
+    row++;
+  };
+
+  for (const auto &[art_name, art] : planned_articulations_)
+    for (auto link_index : art->getFCLModel()->getCollisionLinkUserIndices())
+      add_bound(art, link_index);
+  for (const auto &[attached_body_name, attached_body] : attached_bodies_)
+    add_bound(attached_body->getAttachedArticulation(),
+              attached_body->getAttachedLinkId());
+  return ret;
+}
+
+template <typename S>
+std::vector<ObjectHandle> PlanningWorldTpl<S>::getSceneObjectsOverlapping(
+    const std::vector<AABB> &aabbs) const {
+  std::vector<ObjectHandle> ret;
+  const auto &objects = normal_objects_.getObjects();
+  const auto &handles = normal_objects_.getHandles();
+  size_t num_scene_objects = 0;
+  for (size_t k = 0; k < normal_objects_.size(); k++) {
+    if (normal_objects_.isAttached(k)) continue;
+    num_scene_objects++;
+    objects[k]->computeAABB();
+    const auto &obj_aabb = objects[k]->getAABB();
+    for (const auto &aabb : aabbs)
+      if (obj_aabb.overlap(aabb)) {
+        ret.push_back(handles[k]);
+        break;
+      }
+  }
+  PerfCounters::add(PerfCounter::BROADPHASE_CULL, num_scene_objects - ret.size());
+  return ret;
+}
+
+template <typename S>
+int PlanningWorldTpl<S>::getCollisionTypeCode(const std::string &type) {
+  static const std::unordered_map<std::string, WorldCollisionType> type_codes = {
+      {"self", WorldCollisionType::SELF},
+      {"self_articulation", WorldCollisionType::SELF_ARTICULATION},
+      {"self_attach", WorldCollisionType::SELF_ATTACH},
+      {"attach_attach", WorldCollisionType::ATTACH_ATTACH},
+      {"articulation_articulation", WorldCollisionType::ARTICULATION_ARTICULATION},
+      {"articulation_sceneobject", WorldCollisionType::ARTICULATION_SCENEOBJECT},
+      {"attach_articulation", WorldCollisionType::ATTACH_ARTICULATION},
+      {"attach_sceneobject", WorldCollisionType::ATTACH_SCENEOBJECT}};
+  return static_cast<int>(type_codes.at(type));
+}
+
+template <typename S>
+WorldCollisionReportTpl<S> PlanningWorldTpl<S>::collideReport(
+    const CollisionRequest &request, CollisionReportLevel level) const {
+  auto collisions = collideFull(request, level);
+  // Without enable_contact, FCL still reports one (empty) contact per collision
+  const bool has_contacts = getLevelRequest(request, level).enable_contact;
+  WorldCollisionReport ret;
+  std::unordered_map<std::string, int> name_ids;
+  auto get_name_id = [&](const std::string &name) {
+    auto [it, inserted] = name_ids.try_emplace(name, ret.names.size());
+    if (inserted) ret.names.push_back(name);
+    return it->second;
+  };
+
+  size_t n = collisions.size(), n_contacts = 0;
+  if (has_contacts)
+    for (const auto &collision : collisions) n_contacts += collision.res.numContacts();
+  ret.object_ids.resize(n, 2);
+  ret.link_ids.resize(n, 2);
+  ret.collision_types.resize(n);
+  ret.max_penetration_depths = VectorX<S>::Zero(n);
+  ret.contact_collision_ids.resize(n_contacts);
+  ret.contact_points.resize(n_contacts, 3);
+  ret.contact_normals.resize(n_contacts, 3);
+  ret.penetration_depths.resize(n_contacts);
+
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    const auto &collision = collisions[i];
+    ret.object_ids(i, 0) = get_name_id(collision.object_name1);
+    ret.object_ids(i, 1) = get_name_id(collision.object_name2);
+    ret.link_ids(i, 0) = get_name_id(collision.link_name1);
+    ret.link_ids(i, 1) = get_name_id(collision.link_name2);
+    ret.collision_types[i] = getCollisionTypeCode(collision.collision_type);
+    if (!has_contacts) continue;
+    for (size_t j = 0; j < collision.res.numContacts(); j++, k++) {
+      const auto &contact = collision.res.getContact(j);
+      ret.contact_collision_ids[k] = i;
+      ret.contact_points.row(k) = contact.pos.transpose();
+      ret.contact_normals.row(k) = contact.normal.transpose();
+      ret.penetration_depths[k] = contact.penetration_depth;
+      ret.max_penetration_depths[i] =
+          std::max(ret.max_penetration_depths[i], contact.penetration_depth);
+    }
+  }
+  return ret;
+}
+
 template <typename S>
 WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceSelf(
     const DistanceRequest &request) const {
@@ -603,13 +1210,14 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceOthers(
 
   // Collect unplanned articulations, not attached scene objects
   std::vector<ArticulatedModelPtr> unplanned_articulations;
-  std::unordered_map<std::string, CollisionObjectPtr> scene_objects;
+  std::vector<size_t> scene_object_ids;  // dense indices into normal_objects_
   for (const auto &[name, art] : articulations_)
     if (planned_articulations_.find(name) == planned_articulations_.end())
       unplanned_articulations.push_back(art);
-  for (const auto &[name, obj] : normal_objects_)
-    if (attached_bodies_.find(name) == attached_bodies_.end())
-      scene_objects[name] = obj;
+  for (size_t k = 0; k < normal_objects_.size(); k++)
+    if (!normal_objects_.isAttached(k)) scene_object_ids.push_back(k);
+  const auto &object_names = normal_objects_.getNames();
+  const auto &objects = normal_objects_.getObjects();
 
   // Minimum distance involving planned articulation
   for (const auto &[art_name, art] : planned_articulations_) {
@@ -644,7 +1252,9 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceOthers(
     }
 
     // Minimum distance to scene objects
-    for (const auto &[name, obj] : scene_objects)
+    for (auto k : scene_object_ids) {
+      const auto &name = object_names[k];
+      const auto &obj = objects[k];
       for (size_t i = 0; i < col_objs.size(); i++)
         if (auto type = acm_->getAllowedCollision(col_link_names[i], name);
             !type || type == AllowedCollision::NEVER) {
@@ -660,6 +1270,7 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceOthers(
             ret.link_name2 = name;
           }
         }
+    }
   }
 
   // Minimum distance involving attached_bodies_
@@ -692,7 +1303,9 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceOthers(
     }
 
     // Minimum distance to scene objects
-    for (const auto &[name, obj] : scene_objects)
+    for (auto k : scene_object_ids) {
+      const auto &name = object_names[k];
+      const auto &obj = objects[k];
       if (auto type = acm_->getAllowedCollision(attached_body_name, name);
           !type || type == AllowedCollision::NEVER) {
         result.clear();
@@ -707,6 +1320,7 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceOthers(
           ret.link_name2 = name;
         }
       }
+    }
   }
   return ret;
 }
@@ -719,4 +1333,240 @@ WorldDistanceResultTpl<S> PlanningWorldTpl<S>::distanceFull(
   return ret1.min_distance < ret2.min_distance ? ret1 : ret2;
 }
 
+template <typename S>
+std::vector<typename PlanningWorldTpl<S>::DistancePair>
+PlanningWorldTpl<S>::getDistancePairs(std::vector<DistanceBody> &bodies) const {
+  updateAttachedBodiesPose();
+  bodies.clear();
+
+  // Index ranges of the bodies of each category in bodies
+  std::vector<std::pair<size_t, size_t>> planned_ranges;  // of each planned art
+  auto add_articulation = [&](const std::string &name, const ArticulatedModelPtr &art,
+                              bool planned) {
+    const auto fcl_model = art->getFCLModel();
+    const auto &col_objs = fcl_model->getCollisionObjects();
+    const auto &col_link_names = fcl_model->getCollisionLinkNames();
+    const auto &col_link_indices = fcl_model->getCollisionLinkUserIndices();
+    for (size_t i = 0; i < col_objs.size(); i++)
+      bodies.push_back({col_objs[i].get(), name, col_link_names[i],
+                        planned ? art : nullptr, col_link_indices[i]});
+  };
+  for (const auto &[name, art] : planned_articulations_) {
+    const size_t begin = bodies.size();
+    add_articulation(name, art, true);
+    planned_ranges.emplace_back(begin, bodies.size());
+  }
+  const size_t attached_begin = bodies.size();
+  for (const auto &[name, attached_body] : attached_bodies_)
+    bodies.push_back({attached_body->getObject().get(), name, name,
+                      attached_body->getAttachedArticulation(),
+                      static_cast<size_t>(attached_body->getAttachedLinkId())});
+  const size_t unplanned_begin = bodies.size();
+  for (const auto &[name, art] : articulations_)
+    if (!isArticulationPlanned(name)) add_articulation(name, art, false);
+  const size_t scene_begin = bodies.size();
+  for (size_t k = 0; k < normal_objects_.size(); k++)
+    if (!normal_objects_.isAttached(k))
+      bodies.push_back({normal_objects_.getObjects()[k].get(),
+                        normal_objects_.getNames()[k], normal_objects_.getNames()[k],
+                        nullptr, 0});
+  const size_t scene_end = bodies.size();
+
+  std::vector<DistancePair> pairs;
+  auto add = [&](size_t i, size_t j, const char *type) {
+    const auto allowed =
+        acm_->getAllowedCollision(bodies[i].link_name, bodies[j].link_name);
+    if (!allowed || allowed == AllowedCollision::NEVER)
+      pairs.push_back({i, j, type});
+  };
+  auto add_all = [&](size_t i, size_t begin, size_t end, const char *type) {
+    for (size_t j = begin; j < end; j++) add(i, j, type);
+  };
+
+  // Same pairs as distanceSelf() and distanceOthers()
+  size_t art_index = 0;
+  for (const auto &[art_name, art] : planned_articulations_) {
+    const auto [begin, end] = planned_ranges[art_index];
+    for (const auto &[x, y] : art->getFCLModel()->getCollisionPairs())
+      add(begin + x, begin + y, "self");
+    for (size_t i = begin; i < end; i++) {
+      for (size_t k = 0; k < art_index; k++)
+        add_all(i, planned_ranges[k].first, planned_ranges[k].second,
+                "self_articulation");
+      add_all(i, attached_begin, unplanned_begin, "self_attach");
+      add_all(i, unplanned_begin, scene_begin, "articulation_articulation");
+      add_all(i, scene_begin, scene_end, "articulation_sceneobject");
+    }
+    art_index++;
+  }
+  for (size_t i = attached_begin; i < unplanned_begin; i++) {
+    add_all(i, attached_begin, i, "attach_attach");
+    add_all(i, unplanned_begin, scene_begin, "attach_articulation");
+    add_all(i, scene_begin, scene_end, "attach_sceneobject");
+  }
+  return pairs;
+}
+
+template <typename S>
+WorldDistanceGradientTpl<S> PlanningWorldTpl<S>::distanceGradient(
+    size_t k, const DistanceRequest &request) const {
+  auto dist_request = request;
+  dist_request.enable_nearest_points = true;
+
+  std::vector<DistanceBody> bodies;
+  const auto pairs = getDistancePairs(bodies);
+  std::vector<DistanceResult> results(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++)
+    ::fcl::distance(bodies[pairs[i].body1].object, bodies[pairs[i].body2].object,
+                    dist_request, results[i]);
+
+  // Indices of the k closest pairs
+  std::vector<size_t> order(pairs.size());
+  std::iota(order.begin(), order.end(), 0);
+  const size_t num_pairs = k == 0 ? pairs.size() : std::min(k, pairs.size());
+  std::partial_sort(order.begin(), order.begin() + num_pairs, order.end(),
+                    [&results](size_t a, size_t b) {
+                      return results[a].min_distance < results[b].min_distance;
+                    });
+
+  // Jacobians of planned articulations and their offsets in the state
+  std::unordered_map<const ArticulatedModelTpl<S> *, size_t> offsets;
+  size_t dim = 0;
+  for (const auto &[name, art] : planned_articulations_) {
+    offsets[art.get()] = dim;
+    art->getPinocchioModel()->computeFullJacobian(art->getQpos());
+    dim += art->getQposDim();
+  }
+
+  WorldDistanceGradient ret;
+  ret.distances.resize(num_pairs);
+  ret.gradients = MatrixX<S>::Zero(num_pairs, dim);
+  // Adds the gradient of the distance for moving point of body along direction
+  auto add_gradient = [&](size_t row, const DistanceBody &body, const Vector3<S> &point,
+                          const Vector3<S> &direction) {
+    if (!body.art) return;
+    auto it = offsets.find(body.art.get());
+    if (it == offsets.end()) return;  // attached to an unplanned articulation
+    const auto pinocchio_model = body.art->getPinocchioModel();
+    const Matrix6X<S> jacobian = pinocchio_model->getLinkJacobian(body.link);
+    // Velocity of the point: v + w x p, with (v, w) the spatial velocity in world
+    Matrix3<S> skew;
+    skew << 0, -point[2], point[1], point[2], 0, -point[0], -point[1], point[0], 0;
+    const VectorX<S> grad =
+        (jacobian.topRows(3) - skew * jacobian.bottomRows(3)).transpose() * direction;
+    size_t col = it->second;
+    for (auto i : body.art->getMoveGroupJointIndices()) {
+      const auto start_idx = pinocchio_model->getJointId(i),
+                 dim_i = pinocchio_model->getJointDim(i);
+      for (size_t j = 0; j < dim_i; j++)
+        ret.gradients(row, col++) += grad[start_idx + j];
+    }
+  };
+  for (size_t r = 0; r < num_pairs; r++) {
+    const auto &pair = pairs[order[r]];
+    const auto &body1 = bodies[pair.body1], &body2 = bodies[pair.body2];
+    const auto &res = results[order[r]];
+    ret.distances[r] = res.min_distance;
+    // The distance grows as the nearest points move apart. When penetrating, the
+    // witness points are swapped, so the (signed) distance grows as they move closer
+    const Vector3<S> diff = res.nearest_points[0] - res.nearest_points[1];
+    const S norm = diff.norm();
+    if (norm > std::numeric_limits<S>::epsilon()) {
+      const Vector3<S> direction = (res.min_distance < 0 ? -1 : 1) * diff / norm;
+      add_gradient(r, body1, res.nearest_points[0], direction);
+      add_gradient(r, body2, res.nearest_points[1], -direction);
+    }
+
+    WorldDistanceResult result;
+    result.res = res;
+    result.min_distance = res.min_distance;
+    result.distance_type = pair.type;
+    result.object_name1 = body1.object_name;
+    result.object_name2 = body2.object_name;
+    result.link_name1 = body1.link_name;
+    result.link_name2 = body2.link_name;
+    ret.results.push_back(std::move(result));
+  }
+  return ret;
+}
+
+template <typename S>
+WorldDistanceReportTpl<S> PlanningWorldTpl<S>::distanceWithin(
+    S cutoff, size_t max_pairs, const DistanceRequest &request,
+    size_t num_threads) const {
+  auto dist_request = request;
+  dist_request.enable_nearest_points = true;
+
+  // AABB test of every pair, skips pairs whose AABBs are farther apart than cutoff
+  std::vector<DistanceBody> bodies;
+  const auto all_pairs = getDistancePairs(bodies);
+  std::vector<AABB> aabbs;
+  aabbs.reserve(bodies.size());
+  for (const auto &body : bodies) {
+    body.object->computeAABB();
+    aabbs.push_back(body.object->getAABB());
+  }
+  std::vector<DistancePair> pairs;
+  for (const auto &pair : all_pairs)
+    if (aabbs[pair.body1].distance(aabbs[pair.body2]) <= cutoff) pairs.push_back(pair);
+  PerfCounters::add(PerfCounter::BROADPHASE_CULL, all_pairs.size() - pairs.size());
+
+  // Narrowphase, the objects are only read so workers share them
+  std::vector<DistanceResult> results(pairs.size());
+  std::atomic<size_t> next_pair {0};
+  auto worker = [&]() {
+    for (size_t i; (i = next_pair++) < pairs.size();)
+      ::fcl::distance(bodies[pairs[i].body1].object, bodies[pairs[i].body2].object,
+                      dist_request, results[i]);
+  };
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_threads = std::max<size_t>(std::min(num_threads, pairs.size()), 1);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; t++) threads.emplace_back(worker);
+  worker();
+  for (auto &thread : threads) thread.join();
+
+  std::vector<size_t> order;
+  for (size_t i = 0; i < pairs.size(); i++)
+    if (results[i].min_distance <= cutoff) order.push_back(i);
+  std::sort(order.begin(), order.end(), [&results](size_t a, size_t b) {
+    return results[a].min_distance < results[b].min_distance;
+  });
+  if (max_pairs > 0 && order.size() > max_pairs) order.resize(max_pairs);
+
+  WorldDistanceReport ret;
+  std::unordered_map<std::string, int> name_ids;
+  auto get_name_id = [&](const std::string &name) {
+    auto [it, inserted] = name_ids.try_emplace(name, ret.names.size());
+    if (inserted) ret.names.push_back(name);
+    return it->second;
+  };
+  const size_t n = order.size();
+  ret.object_ids.resize(n, 2);
+  ret.link_ids.resize(n, 2);
+  ret.distance_types.resize(n);
+  ret.distances.resize(n);
+  ret.points1.resize(n, 3);
+  ret.points2.resize(n, 3);
+  ret.normals = MatrixX3<S>::Zero(n, 3);
+  for (size_t r = 0; r < n; r++) {
+    const auto &pair = pairs[order[r]];
+    const auto &body1 = bodies[pair.body1], &body2 = bodies[pair.body2];
+    const auto &res = results[order[r]];
+    ret.object_ids(r, 0) = get_name_id(body1.object_name);
+    ret.object_ids(r, 1) = get_name_id(body2.object_name);
+    ret.link_ids(r, 0) = get_name_id(body1.link_name);
+    ret.link_ids(r, 1) = get_name_id(body2.link_name);
+    ret.distance_types[r] = getCollisionTypeCode(pair.type);
+    ret.distances[r] = res.min_distance;
+    ret.points1.row(r) = res.nearest_points[0].transpose();
+    ret.points2.row(r) = res.nearest_points[1].transpose();
+    const Vector3<S> diff = res.nearest_points[1] - res.nearest_points[0];
+    if (const S norm = diff.norm(); norm > std::numeric_limits<S>::epsilon())
+      ret.normals.row(r) = (diff / norm).transpose();
+  }
+  return ret;
+}
+
 }  // namespace mplib
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,6 +10,9 @@
 #include "attached_body.h"
 #include "collision_matrix.h"
 #include "macros_utils.h"
+#include "math_utils.h"
+#include "object_registry.h"
+#include "shared_geometry.h"
 #include "types.h"
 
 namespace mplib {
@@ -28,6 +32,54 @@ using WorldCollisionResultd = WorldCollisionResultTpl<double>;
 using WorldCollisionResultfPtr = WorldCollisionResultTplPtr<float>;
 using WorldCollisionResultdPtr = WorldCollisionResultTplPtr<double>;
 
+/// Integer codes of WorldCollisionResult::collision_type
+enum class WorldCollisionType : int {
+  SELF,                       // "self"
+  SELF_ARTICULATION,          // "self_articulation"
+  SELF_ATTACH,                // "self_attach"
+  ATTACH_ATTACH,              // "attach_attach"
+  ARTICULATION_ARTICULATION,  // "articulation_articulation"
+  ARTICULATION_SCENEOBJECT,   // "articulation_sceneobject"
+  ATTACH_ARTICULATION,        // "attach_articulation"
+  ATTACH_SCENEOBJECT,         // "attach_sceneobject"
+};
+
+/// Level of detail computed and stored by collision queries of PlanningWorld
+enum class CollisionReportLevel : int {
+  BOOL,      // stop at the first collision, no contacts are computed
+  PAIRS,     // all colliding pairs, no contacts are computed
+  CONTACTS,  // all colliding pairs with their contacts (no cost sources)
+  FULL,      // everything asked for by the given CollisionRequest
+};
+
+// WorldCollisionReportTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(WorldCollisionReportTpl);
+
+/**
+ * Columnar report of all collisions in the planning world.
+ * Row i of the per-collision arrays describes the i-th colliding pair.
+ * Object and link names are stored once in names and referenced by index.
+ */
+template <typename S>
+struct WorldCollisionReportTpl {
+  std::vector<std::string> names;  // name table indexed by object_ids / link_ids
+  MatrixX2i object_ids;            // [n_collisions, 2], object (name) ids
+  MatrixX2i link_ids;              // [n_collisions, 2], link (name) ids
+  VectorXi collision_types;        // [n_collisions], WorldCollisionType codes
+  VectorX<S> max_penetration_depths;  // [n_collisions], 0 if contacts disabled
+  // Contacts of all collisions (only if CollisionRequest.enable_contact is true)
+  VectorXi contact_collision_ids;  // [n_contacts], row index of the collision
+  MatrixX3<S> contact_points;      // [n_contacts, 3]
+  MatrixX3<S> contact_normals;     // [n_contacts, 3]
+  VectorX<S> penetration_depths;   // [n_contacts]
+};
+
+// Common Type Alias ==========================================================
+using WorldCollisionReportf = WorldCollisionReportTpl<float>;
+using WorldCollisionReportd = WorldCollisionReportTpl<double>;
+using WorldCollisionReportfPtr = WorldCollisionReportTplPtr<float>;
+using WorldCollisionReportdPtr = WorldCollisionReportTplPtr<double>;
+
 // WorldDistanceResultTplPtr
 MPLIB_STRUCT_TEMPLATE_FORWARD(WorldDistanceResultTpl);
 
@@ -46,6 +98,94 @@ using WorldDistanceResultd = WorldDistanceResultTpl<double>;
 using WorldDistanceResultfPtr = WorldDistanceResultTplPtr<float>;
 using WorldDistanceResultdPtr = WorldDistanceResultTplPtr<double>;
 
+// WorldDistanceGradientTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(WorldDistanceGradientTpl);
+
+/**
+ * @brief Result of PlanningWorld::distanceGradient().
+ *  Row i of distances and gradients describes results[i].
+ */
+template <typename S>
+struct WorldDistanceGradientTpl {
+  std::vector<WorldDistanceResultTpl<S>> results;  // closest pairs, nearest first
+  VectorX<S> distances;                            // [n_pairs]
+  // [n_pairs, dim] gradient of each distance w.r.t. the state of all planned
+  // articulations (see PlanningWorld::setQposAll())
+  MatrixX<S> gradients;
+};
+
+// Common Type Alias ==========================================================
+using WorldDistanceGradientf = WorldDistanceGradientTpl<float>;
+using WorldDistanceGradientd = WorldDistanceGradientTpl<double>;
+using WorldDistanceGradientfPtr = WorldDistanceGradientTplPtr<float>;
+using WorldDistanceGradientdPtr = WorldDistanceGradientTplPtr<double>;
+
+// WorldDistanceReportTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(WorldDistanceReportTpl);
+
+/**
+ * Columnar report of all pairs within a distance cutoff, nearest first.
+ * Row i of the per-pair arrays describes the i-th pair.
+ * Object and link names are stored once in names and referenced by index.
+ */
+template <typename S>
+struct WorldDistanceReportTpl {
+  std::vector<std::string> names;  // name table indexed by object_ids / link_ids
+  MatrixX2i object_ids;            // [n_pairs, 2], object (name) ids
+  MatrixX2i link_ids;              // [n_pairs, 2], link (name) ids
+  VectorXi distance_types;         // [n_pairs], WorldCollisionType codes
+  VectorX<S> distances;            // [n_pairs], ascending
+  MatrixX3<S> points1;             // [n_pairs, 3], nearest points on first bodies
+  MatrixX3<S> points2;             // [n_pairs, 3], nearest points on second bodies
+  // [n_pairs, 3], unit vectors from points1 to points2 (zero if they coincide)
+  MatrixX3<S> normals;
+};
+
+// Common Type Alias ==========================================================
+using WorldDistanceReportf = WorldDistanceReportTpl<float>;
+using WorldDistanceReportd = WorldDistanceReportTpl<double>;
+using WorldDistanceReportfPtr = WorldDistanceReportTplPtr<float>;
+using WorldDistanceReportdPtr = WorldDistanceReportTplPtr<double>;
+
+// TrajectoryValidationResultTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(TrajectoryValidationResultTpl);
+
+/**
+ * @brief Result of PlanningWorld::validateTrajectory().
+ *  The first invalid state lies on the segment ending at waypoint ``index``
+ *  (``(1 - fraction) * qs[index - 1] + fraction * qs[index]``).
+ */
+template <typename S>
+struct TrajectoryValidationResultTpl {
+  bool valid {true};
+  int index {-1};                        // waypoint index, -1 if valid
+  S fraction {};                         // in (0, 1], 1 if the waypoint is invalid
+  VectorX<S> qpos;                       // first invalid state
+  WorldCollisionResultTpl<S> collision;  // a collision at the first invalid state
+};
+
+// Common Type Alias ==========================================================
+using TrajectoryValidationResultf = TrajectoryValidationResultTpl<float>;
+using TrajectoryValidationResultd = TrajectoryValidationResultTpl<double>;
+using TrajectoryValidationResultfPtr = TrajectoryValidationResultTplPtr<float>;
+using TrajectoryValidationResultdPtr = TrajectoryValidationResultTplPtr<double>;
+
+// CartesianPathResultTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(CartesianPathResultTpl);
+
+/// @brief Result of PlanningWorld::computeCartesianPath()
+template <typename S>
+struct CartesianPathResultTpl {
+  MatrixX<S> path;  // move group qpos at each step, starting with the current qpos
+  S fraction {};    // fraction of the interpolated steps achieved, in [0, 1]
+};
+
+// Common Type Alias ==========================================================
+using CartesianPathResultf = CartesianPathResultTpl<float>;
+using CartesianPathResultd = CartesianPathResultTpl<double>;
+using CartesianPathResultfPtr = CartesianPathResultTplPtr<float>;
+using CartesianPathResultdPtr = CartesianPathResultTplPtr<double>;
+
 // PlanningWorldTplPtr
 MPLIB_CLASS_TEMPLATE_FORWARD(PlanningWorldTpl);
 
@@ -58,13 +198,20 @@ class PlanningWorldTpl {
   using DistanceRequest = fcl::DistanceRequest<S>;
   using DistanceResult = fcl::DistanceResult<S>;
   using CollisionGeometryPtr = fcl::CollisionGeometryPtr<S>;
+  using SharedGeometryStorePtr = fcl::SharedGeometryStoreTplPtr<S>;
   using CollisionObject = fcl::CollisionObject<S>;
   using CollisionObjectPtr = fcl::CollisionObjectPtr<S>;
   using DynamicAABBTreeCollisionManager = fcl::DynamicAABBTreeCollisionManager<S>;
   using BroadPhaseCollisionManagerPtr = fcl::BroadPhaseCollisionManagerPtr<S>;
+  using AABB = fcl::AABB<S>;
 
   using WorldCollisionResult = WorldCollisionResultTpl<S>;
+  using WorldCollisionReport = WorldCollisionReportTpl<S>;
   using WorldDistanceResult = WorldDistanceResultTpl<S>;
+  using WorldDistanceGradient = WorldDistanceGradientTpl<S>;
+  using WorldDistanceReport = WorldDistanceReportTpl<S>;
+  using TrajectoryValidationResult = TrajectoryValidationResultTpl<S>;
+  using CartesianPathResult = CartesianPathResultTpl<S>;
   using ArticulatedModelPtr = ArticulatedModelTplPtr<S>;
   using AttachedBody = AttachedBodyTpl<S>;
   using AttachedBodyPtr = AttachedBodyTplPtr<S>;
@@ -78,12 +225,24 @@ class PlanningWorldTpl {
                    const std::vector<CollisionObjectPtr> &normal_objects = {},
                    const std::vector<std::string> &normal_object_names = {});
 
+  /**
+   * @brief Copies the planning world so that the copy can be used independently
+   *  (e.g., from another thread). Articulations, normal objects and attached bodies
+   *  are copied, collision geometries are shared.
+   * @returns a unique_ptr to the copy
+   */
+  std::unique_ptr<PlanningWorldTpl<S>> clone() const;
+
   /// @brief Gets names of all articulations in world (unordered)
   std::vector<std::string> getArticulationNames() const;
 
   /// @brief Gets all planned articulations (ArticulatedModelPtr)
   std::vector<ArticulatedModelPtr> getPlannedArticulations() const;
 
+  /// @brief Gets names of all planned articulations (in getPlannedArticulations()
+  ///  order)
+  std::vector<std::string> getPlannedArticulationNames() const;
+
   /// @brief Gets the articulation (ArticulatedModelPtr) with given name
   ArticulatedModelPtr getArticulation(const std::string &name) const {
     auto it = articulations_.find(name);
@@ -125,25 +284,65 @@ class PlanningWorldTpl {
 
   /// @brief Gets the normal object (CollisionObjectPtr) with given name
   CollisionObjectPtr getNormalObject(const std::string &name) const {
-    auto it = normal_objects_.find(name);
-    return it != normal_objects_.end() ? it->second : nullptr;
+    auto handle = normal_objects_.getHandle(name);
+    return handle.isSet() ? normal_objects_.getObject(handle) : nullptr;
+  }
+
+  /// @brief Gets the normal object (CollisionObjectPtr) with given handle
+  CollisionObjectPtr getNormalObject(const ObjectHandle &handle) const {
+    return normal_objects_.contains(handle) ? normal_objects_.getObject(handle)
+                                            : nullptr;
+  }
+
+  /**
+   * @brief Gets the stable handle of normal object with given name.
+   *  The handle stays valid until the object is removed, and is faster than the
+   *  name to refer to the object in repeated calls (e.g., setObjectPoses()).
+   * @returns the handle, an unset handle if the object does not exist
+   */
+  ObjectHandle getNormalObjectHandle(const std::string &name) const {
+    return normal_objects_.getHandle(name);
   }
 
   /// @brief Whether normal object with given name exists
   bool hasNormalObject(const std::string &name) const {
-    return normal_objects_.find(name) != normal_objects_.end();
+    return normal_objects_.contains(name);
   }
 
-  /// @brief Adds a normal object (CollisionObjectPtr) with given name to world
-  void addNormalObject(const std::string &name,
-                       const CollisionObjectPtr &collision_object) {
-    normal_objects_[name] = collision_object;
+  /**
+   * @brief Adds a normal object (CollisionObjectPtr) with given name to world
+   * @returns handle of the normal object
+   */
+  ObjectHandle addNormalObject(const std::string &name,
+                               const CollisionObjectPtr &collision_object) {
+    return normal_objects_.add(name, collision_object);
   }
 
   /// @brief Adds a point cloud as a normal object with given name to world
   void addPointCloud(const std::string &name, const MatrixX3<S> &vertices,
                      double resolution = 0.01);
 
+  /**
+   * @brief Gets the geometries that can be placed in a SharedGeometryStore for
+   *  other processes: the meshes of all articulations (see
+   *  FCLModel::getMeshGeometries()) and the triangle mesh, convex and SourceOcTree
+   *  (e.g., from addPointCloud()) geometries of normal objects, keyed by object name
+   */
+  std::vector<std::pair<std::string, CollisionGeometryPtr>> getShareableGeometries()
+      const;
+
+  /**
+   * @brief Adds a normal object whose geometry is taken from a shared-memory store
+   *  (see getShareableGeometries())
+   * @param name: name of the normal object, also its key in store
+   * @param store: store holding the geometry
+   * @param pose: pose of the object (xyz, wxyz)
+   * @returns handle of the normal object
+   */
+  ObjectHandle addSharedObject(const std::string &name,
+                               const SharedGeometryStorePtr &store,
+                               const Vector7<S> &pose);
+
   /**
    * @brief Removes (and detaches) the normal object with given name if exists.
    *  Updates acm_
@@ -152,6 +351,94 @@ class PlanningWorldTpl {
    */
   bool removeNormalObject(const std::string &name);
 
+  /**
+   * @brief Sets the local offset of a normal object, i.e., the pose of the collision
+   *  object relative to the frame whose pose is passed to setObjectPoses().
+   *  Objects without an offset are placed directly at the given pose.
+   * @param name: name of the normal object
+   * @param offset: local offset as [x, y, z, qw, qx, qy, qz]
+   * @throws std::runtime_error if normal object with given name does not exist
+   */
+  void setNormalObjectOffset(const std::string &name, const Vector7<S> &offset) {
+    normal_objects_.setOffset(normal_objects_.getHandle(name),
+                              posevec_to_transform(offset));
+  }
+
+  /**
+   * @brief Sets the global poses of many normal objects at once.
+   *  Each pose is composed with the object's local offset (see
+   *  setNormalObjectOffset()). Attached objects are re-attached at their new pose
+   *  relative to the attached link if update_attached_object is true, otherwise
+   *  their global pose is recomputed from the current state.
+   * @param names: names of the normal objects
+   * @param poses: global poses of the objects, [n_objects, 7] as
+   *  [x, y, z, qw, qx, qy, qz]
+   * @param update_attached_object: whether to update the attached pose of
+   *  attached objects
+   */
+  void setObjectPoses(const std::vector<std::string> &names, const MatrixX7<S> &poses,
+                      bool update_attached_object = true);
+
+  /// @brief Same as above, but refers to the normal objects by their handles
+  void setObjectPoses(const std::vector<ObjectHandle> &handles,
+                      const MatrixX7<S> &poses, bool update_attached_object = true);
+
+  /**
+   * @brief Sets the pose trajectory of a normal object, making it a dynamic object
+   *  that is moved by setTime(). The pose at a time is interpolated between time
+   *  stamps (linearly for position, slerp for orientation) and held constant before
+   *  the first and after the last time stamp. The object is moved to its pose at
+   *  the current time.
+   * @param name: name of the normal object
+   * @param times: increasing time stamps
+   * @param poses: global pose at each time stamp (see setObjectPoses()),
+   *  [n_times, 7] as [x, y, z, qw, qx, qy, qz]
+   * @throws std::runtime_error if normal object with given name does not exist
+   */
+  void setObjectTrajectory(const std::string &name, const VectorX<S> &times,
+                           const MatrixX7<S> &poses);
+
+  /**
+   * @brief Removes the pose trajectory of a normal object (it stays at its current
+   *  pose)
+   * @returns true if success, false if the object has no trajectory
+   */
+  bool removeObjectTrajectory(const std::string &name);
+
+  /// @brief Gets names of all dynamic objects (objects with a pose trajectory)
+  std::vector<std::string> getDynamicObjectNames() const;
+
+  /**
+   * @brief Sets the joint trajectory of an articulation, which is then moved by
+   *  setTime() like a dynamic object (e.g., another arm executing a known plan).
+   *  The qpos at a time is linearly interpolated between time stamps and held
+   *  constant before the first and after the last time stamp. The articulation
+   *  is moved to its qpos at the current time.
+   * @param name: name of the articulation
+   * @param times: increasing time stamps
+   * @param qposes: qpos of the move group at each time stamp, [n_times, qpos_dim]
+   * @throws std::runtime_error if articulation with given name does not exist
+   */
+  void setArticulationTrajectory(const std::string &name, const VectorX<S> &times,
+                                 const MatrixX<S> &qposes);
+
+  /**
+   * @brief Removes the joint trajectory of an articulation (it stays at its current
+   *  qpos)
+   * @returns true if success, false if the articulation has no trajectory
+   */
+  bool removeArticulationTrajectory(const std::string &name);
+
+  /// @brief Gets the current time of dynamic objects (see setTime())
+  S getTime() const { return time_; }
+
+  /**
+   * @brief Moves all dynamic objects to their poses and all articulations with a
+   *  joint trajectory to their qpos at given time.
+   *  Attached dynamic objects follow their articulation and are not moved.
+   */
+  void setTime(S time);
+
   /// @brief Whether normal object with given name is attached
   bool isNormalObjectAttached(const std::string &name) const {
     return attached_bodies_.find(name) != attached_bodies_.end();
@@ -244,28 +531,150 @@ class PlanningWorldTpl {
   /// @brief Get pointer to allowed collision matrix to modify
   AllowedCollisionMatrixPtr getAllowedCollisionMatrix() const { return acm_; }
 
-  /// @brief Check full collision and return only a boolean indicating collision
+  /**
+   * @brief Check full collision and return only a boolean indicating collision.
+   *  Stops at the first collision and never computes contacts.
+   */
   bool collide(const CollisionRequest &request = CollisionRequest()) const {
-    return collideFull(request).size() > 0;
+    return collideFull(request, CollisionReportLevel::BOOL).size() > 0;
+  }
+
+  /**
+   * @brief Same as collide() but only checks the given scene objects (handles of
+   *  attached objects are ignored). Self-collision and unplanned articulations are
+   *  always checked.
+   */
+  bool collide(const std::vector<ObjectHandle> &scene_objects,
+               const CollisionRequest &request = CollisionRequest()) const {
+    return !selfCollide(request, CollisionReportLevel::BOOL).empty() ||
+           !collideWithOthers(scene_objects, request, CollisionReportLevel::BOOL)
+                .empty();
+  }
+
+  /**
+   * @brief Check full collision at given time, moving dynamic objects with setTime()
+   *  first. Returns only a boolean indicating collision (see collide()).
+   */
+  bool collideAtTime(S time, const CollisionRequest &request = CollisionRequest()) {
+    setTime(time);
+    return collide(request);
   }
 
   /**
    * @brief Check self collision (including planned articulation self-collision,
    *  planned articulation-attach collision, attach-attach collision)
+   * @param request: collision request, adjusted according to level
+   * @param level: what to compute and return. With BOOL, at most one collision
+   *  is returned.
    */
   std::vector<WorldCollisionResult> selfCollide(
-      const CollisionRequest &request = CollisionRequest()) const;
+      const CollisionRequest &request = CollisionRequest(),
+      CollisionReportLevel level = CollisionReportLevel::FULL) const;
 
   /**
    * @brief Check collision with other scene bodies (planned articulations with
    * attached objects collide against unplanned articulations and scene objects)
+   * @param request: collision request, adjusted according to level
+   * @param level: what to compute and return. With BOOL, at most one collision
+   *  is returned.
+   */
+  std::vector<WorldCollisionResult> collideWithOthers(
+      const CollisionRequest &request = CollisionRequest(),
+      CollisionReportLevel level = CollisionReportLevel::FULL) const;
+
+  /**
+   * @brief Same as collideWithOthers() but only checks the given scene objects
+   *  (e.g., broadphase candidates from getSceneObjectsOverlapping()). Handles of
+   *  attached objects are ignored.
    */
   std::vector<WorldCollisionResult> collideWithOthers(
-      const CollisionRequest &request = CollisionRequest()) const;
+      const std::vector<ObjectHandle> &scene_objects,
+      const CollisionRequest &request = CollisionRequest(),
+      CollisionReportLevel level = CollisionReportLevel::FULL) const;
 
   /// @brief Check full collision (calls selfCollide() and collideWithOthers())
   std::vector<WorldCollisionResult> collideFull(
-      const CollisionRequest &request = CollisionRequest()) const;
+      const CollisionRequest &request = CollisionRequest(),
+      CollisionReportLevel level = CollisionReportLevel::FULL) const;
+
+  /**
+   * @brief Check full collision and return a columnar WorldCollisionReport
+   *  (same collisions as collideFull()) with a separate name table.
+   *  Contacts are only reported if enabled by request or level.
+   */
+  WorldCollisionReport collideReport(
+      const CollisionRequest &request = CollisionRequest(),
+      CollisionReportLevel level = CollisionReportLevel::FULL) const;
+
+  /**
+   * @brief Gets the world-frame AABBs of all planned bodies in current state:
+   *  collision objects of planned articulations (in getPlannedArticulations() order)
+   *  followed by attached bodies. The order is fixed as long as no articulation or
+   *  attached body is added or removed.
+   */
+  std::vector<AABB> getPlannedAABBs() const;
+
+  /**
+   * @brief Bounds the displacement of each planned body per unit motion of the
+   *  state of all planned articulations (see setQposAll()).
+   * @returns matrix with one row per planned body (in getPlannedAABBs() order) and
+   *  one column per state dimension. Along a linear motion by ``delta``, body ``i``
+   *  moves by at most ``bounds.row(i).dot(abs(delta))``.
+   */
+  MatrixX<S> getDisplacementBounds() const;
+
+  /**
+   * @brief Gets handles of scene objects (normal objects that are not attached)
+   *  whose AABB overlaps any of the given AABBs
+   */
+  std::vector<ObjectHandle> getSceneObjectsOverlapping(
+      const std::vector<AABB> &aabbs) const;
+
+  /**
+   * @brief Validates a trajectory densely and in parallel.
+   *  States are interpolated linearly between consecutive waypoints so that no joint
+   *  moves more than resolution between checked states. The states are checked by
+   *  up to num_threads workers. Each additional worker checks its own copy of the
+   *  world (see clone()), so short trajectories are checked by fewer workers to
+   *  save the copies. The state of this world is restored afterwards.
+   * @param qs: waypoints, one state of all planned articulations per row (see
+   *  setQposAll())
+   * @param resolution: maximum joint motion between checked states
+   * @param num_threads: number of threads, 0 to use all hardware threads
+   * @returns the first invalid state and a collision at it, if any
+   */
+  TrajectoryValidationResult validateTrajectory(const MatrixX<S> &qs, S resolution,
+                                                size_t num_threads = 0) const;
+
+  /**
+   * @brief Computes a path moving a link of a planned articulation in straight lines
+   *  through Cartesian waypoints.
+   *  The motion from the current link pose through the waypoints is interpolated
+   *  (linearly for position, slerp for orientation) so that the link moves at most
+   *  eef_step per step, in meters for translation and radians for rotation. IK of
+   *  each step is warm-started from the previous step and only moves the move group
+   *  joints. The path stops at the first step whose IK fails or violates joint
+   *  limits, at the first configuration jump, and at the first collision. All steps
+   *  are checked for collision in batch with validateTrajectory(). The state of the
+   *  world is not modified.
+   * @param art_name: name of the planned articulation
+   * @param link_index: user link index of the moved link
+   * @param waypoints: poses of the link in the articulation base frame,
+   *  [n_waypoints, 7] as [x, y, z, qw, qx, qy, qz]
+   * @param eef_step: maximum motion of the link per step
+   * @param jump_threshold: a step is a jump if its joint motion (L1 norm) exceeds
+   *  jump_threshold times the mean joint motion per step. Not checked if not
+   *  positive.
+   * @param resolution: maximum joint motion between states checked for collision
+   * @param num_threads: number of threads to check collision, 0 to use all hardware
+   *  threads
+   * @returns the path achieved and its fraction of the requested path
+   */
+  CartesianPathResult computeCartesianPath(const std::string &art_name,
+                                           size_t link_index,
+                                           const MatrixX7<S> &waypoints, S eef_step,
+                                           S jump_threshold = 0, S resolution = 0.01,
+                                           size_t num_threads = 0);
 
   /// @brief Returns the minimum distance to collision in current state
   S distance(const DistanceRequest &request = DistanceRequest()) const {
@@ -287,9 +696,43 @@ class PlanningWorldTpl {
   WorldDistanceResult distanceFull(
       const DistanceRequest &request = DistanceRequest()) const;
 
+  /**
+   * @brief Computes the distances of the k closest pairs (same pairs as
+   *  distanceFull()) and their gradients w.r.t. the joint configuration.
+   *  The distance gradient is the unit vector between the nearest (witness) points
+   *  projected through the point Jacobians of the links (PinocchioModel) moving
+   *  them. For penetrating pairs the vector is reversed, so that the gradient
+   *  points out of the collision. Bodies that are not planned (or attached to
+   *  planned links) do not contribute. The gradient is zero if the nearest points
+   *  coincide.
+   * @param k: number of closest pairs, 0 for all pairs
+   * @param request: distance request, nearest points are always computed. Enable
+   *  signed distance to get distances and gradients of penetrating pairs (without
+   *  it, FCL does not compute penetration depths).
+   * @returns the closest pairs with their distances and gradients
+   */
+  WorldDistanceGradient distanceGradient(
+      size_t k = 1, const DistanceRequest &request = DistanceRequest()) const;
+
+  /**
+   * @brief Finds all pairs (same pairs as distanceFull()) closer than cutoff.
+   *  Every pair of the O(N^2) pair list first gets a world-frame AABB distance test,
+   *  and pairs whose AABBs are farther apart than cutoff are skipped. The exact
+   *  distance queries of the remaining pairs can run on multiple threads.
+   * @param cutoff: max distance of the reported pairs
+   * @param max_pairs: max number of reported (nearest) pairs, 0 for no limit
+   * @param request: distance request, nearest points are always computed
+   * @param num_threads: number of threads for the distance queries, 0 (default) for
+   *  all hardware threads (same as validateTrajectory())
+   * @returns columnar report of the pairs within cutoff, nearest first
+   */
+  WorldDistanceReport distanceWithin(S cutoff, size_t max_pairs = 0,
+                                     const DistanceRequest &request = DistanceRequest(),
+                                     size_t num_threads = 0) const;
+
  private:
   std::unordered_map<std::string, ArticulatedModelPtr> articulations_;
-  std::unordered_map<std::string, CollisionObjectPtr> normal_objects_;
+  ObjectRegistryTpl<S> normal_objects_;
 
   // TODO: can planned_articulations_ be unordered_map? (setQposAll)
   std::map<std::string, ArticulatedModelPtr> planned_articulations_;
@@ -297,6 +740,26 @@ class PlanningWorldTpl {
 
   AllowedCollisionMatrixPtr acm_;
 
+  /// @brief Pose trajectory of a dynamic object
+  struct ObjectTrajectory {
+    VectorX<S> times;
+    MatrixX7<S> poses;
+
+    /// @brief Gets the interpolated pose at given time
+    Vector7<S> getPose(S time) const;
+  };
+
+  std::unordered_map<std::string, ObjectTrajectory> object_trajectories_;
+
+  /// @brief Joint trajectory of an articulation
+  struct ArticulationTrajectory {
+    VectorX<S> times;
+    MatrixX<S> qposes;
+  };
+
+  std::unordered_map<std::string, ArticulationTrajectory> articulation_trajectories_;
+  S time_ {};
+
   // TODO: Switch to BroadPhaseCollision
   // BroadPhaseCollisionManagerPtr normal_manager;
 
@@ -306,9 +769,46 @@ class PlanningWorldTpl {
       attached_body->updatePose();
   }
 
-  /// @brief Filter collisions using acm_
-  std::vector<WorldCollisionResult> filterCollisions(
-      const std::vector<WorldCollisionResult> &collisions) const;
+  /// @brief A body moves with link of art, or is static if art is nullptr
+  struct DistanceBody {
+    CollisionObject *object;
+    std::string object_name, link_name;
+    ArticulatedModelPtr art;
+    size_t link;
+  };
+
+  /// @brief A pair of bodies (indices) to query distance with its distance type
+  struct DistancePair {
+    size_t body1, body2;
+    const char *type;
+  };
+
+  /**
+   * @brief Collects all bodies in current state and the pairs not allowed by acm_
+   *  (same pairs as distanceFull())
+   */
+  std::vector<DistancePair> getDistancePairs(std::vector<DistanceBody> &bodies) const;
+
+  /// @brief Gets the WorldCollisionType code of a collision or distance type
+  static int getCollisionTypeCode(const std::string &type);
+
+  /// @brief Adjusts request flags to compute only what level needs
+  static CollisionRequest getLevelRequest(const CollisionRequest &request,
+                                          CollisionReportLevel level);
+
+  /**
+   * @brief Adds collision to collisions unless it is allowed by acm_
+   * @returns whether the collision query can stop (a collision is added and
+   *  level is BOOL)
+   */
+  bool addCollision(std::vector<WorldCollisionResult> &collisions,
+                    WorldCollisionResult &&collision,
+                    CollisionReportLevel level) const;
+
+  /// @brief collideWithOthers() against scene objects at given dense indices
+  std::vector<WorldCollisionResult> collideWithSceneSubset(
+      const std::vector<size_t> &scene_object_ids, const CollisionRequest &request,
+      CollisionReportLevel level) const;
 };
 
 // Common Type Alias ==========================================================
@@ -318,9 +818,14 @@ using PlanningWorldfPtr = PlanningWorldTplPtr<float>;
 using PlanningWorlddPtr = PlanningWorldTplPtr<double>;
 
 // Explicit Template Instantiation Declaration ================================
-#define DECLARE_TEMPLATE_PLANNING_WORLD(S)          \
-  extern template class WorldCollisionResultTpl<S>; \
-  extern template class WorldDistanceResultTpl<S>;  \
+#define DECLARE_TEMPLATE_PLANNING_WORLD(S)                \
+  extern template class WorldCollisionResultTpl<S>;       \
+  extern template class WorldCollisionReportTpl<S>;       \
+  extern template class WorldDistanceResultTpl<S>;        \
+  extern template class WorldDistanceGradientTpl<S>;      \
+  extern template class WorldDistanceReportTpl<S>;        \
+  extern template class TrajectoryValidationResultTpl<S>; \
+  extern template class CartesianPathResultTpl<S>;        \
   extern template class PlanningWorldTpl<S>
 
 DECLARE_TEMPLATE_PLANNING_WORLD(float);
@@ -0,0 +1,208 @@
+#include "replanning_session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace mplib::ompl {
+
+// Explicit Template Instantiation Definition =================================
+#define DEFINE_TEMPLATE_REPLANNING_SESSION(S) \
+  template class ReplanResultTpl<S>;          \
+  template class ReplanningSessionTpl<S>
+
+DEFINE_TEMPLATE_REPLANNING_SESSION(float);
+DEFINE_TEMPLATE_REPLANNING_SESSION(double);
+
+namespace {
+
+const std::string kExactSolution = "Exact solution";
+
+}  // namespace
+
+template <typename S>
+ReplanningSessionTpl<S>::ReplanningSessionTpl(const OMPLPlannerTplPtr<S> &planner,
+                                              S resolution)
+    : planner_(planner), resolution_(resolution) {
+  ASSERT(resolution > 0, "resolution should be positive");
+}
+
+template <typename S>
+ReplanResultTpl<S> ReplanningSessionTpl<S>::replan(
+    const VectorX<S> &current_state, const std::vector<VectorX<S>> &goal_states,
+    double deadline, const std::string &planner_name, double range) {
+  using Clock = std::chrono::steady_clock;
+  const auto begin = Clock::now();
+  auto get_elapsed_time = [&begin] {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+  };
+  auto get_remaining_time = [&] {
+    return std::max(deadline - get_elapsed_time(), 0.0);
+  };
+
+  ReplanResultTpl<S> ret;
+  if (monitor_ && isSameGoal(goal_states)) {
+    const bool on_path = advance(current_state) <= resolution_;
+    monitor_->update();
+    const auto invalid_segments = monitor_->getInvalidSegments();
+    auto is_invalid = [&invalid_segments](size_t k) {
+      return std::binary_search(invalid_segments.begin(), invalid_segments.end(), k);
+    };
+    // Off the path, the motion to the next waypoint has not been checked
+    const size_t n = path_.rows();
+    const bool connected =
+        on_path || checkMotion(current_state, path_.row(progress_).transpose());
+
+    // Keeps the valid segments and reconnects around each invalid portion
+    std::vector<VectorX<S>> states {current_state};
+    bool repaired = true;
+    for (size_t k = progress_; k < n;) {
+      if (!is_invalid(k) && (k != progress_ || connected)) {
+        states.push_back(path_.row(k).transpose());
+        k++;
+        continue;
+      }
+      // Next waypoint reached by a valid segment
+      size_t end = is_invalid(k) ? k + 1 : k;
+      while (end < n && is_invalid(end)) end++;
+      // Up to the last waypoint, reconnect to it unless the goal itself is invalid
+      if (end == n) {
+        end = n - 1;
+        if (!checkState(path_.row(end).transpose())) {
+          repaired = false;
+          break;
+        }
+      }
+      const VectorX<S> goal = path_.row(end).transpose();
+      const auto [status, path] = planner_->plan(states.back(), {goal}, planner_name,
+                                                 get_remaining_time(), range);
+      if (status != kExactSolution) {
+        repaired = false;
+        break;
+      }
+      for (Eigen::Index i = 1; i < path.rows(); i++)
+        states.push_back(path.row(i).transpose());
+      for (size_t i = k; i <= end; i++) ret.repaired_segments.push_back(i);
+      k = end + 1;
+    }
+
+    if (repaired) {
+      ret.status = kExactSolution;
+      ret.path.resize(states.size(), current_state.size());
+      for (size_t i = 0; i < states.size(); i++)
+        ret.path.row(i) = states[i].transpose();
+      ret.mode = ret.repaired_segments.empty() ? ReplanMode::REUSED
+                                               : ReplanMode::REPAIRED;
+      if (ret.mode == ReplanMode::REPAIRED) setPath(ret.path);
+      ret.planning_time = get_elapsed_time();
+      return ret;
+    }
+    ret.repaired_segments.clear();
+  }
+
+  auto [status, path] = planner_->plan(current_state, goal_states, planner_name,
+                                       get_remaining_time(), range);
+  ret.mode = ReplanMode::REPLANNED;
+  // On failure, the previous path is kept for the next call
+  if (status == kExactSolution) {
+    goal_states_ = goal_states;
+    setPath(path);
+  }
+  ret.status = std::move(status);
+  ret.path = std::move(path);
+  ret.planning_time = get_elapsed_time();
+  return ret;
+}
+
+template <typename S>
+void ReplanningSessionTpl<S>::reset() {
+  goal_states_.clear();
+  path_.resize(0, 0);
+  progress_ = 0;
+  monitor_.reset();
+}
+
+template <typename S>
+bool ReplanningSessionTpl<S>::isSameGoal(
+    const std::vector<VectorX<S>> &goal_states) const {
+  if (goal_states.size() != goal_states_.size()) return false;
+  for (size_t i = 0; i < goal_states.size(); i++)
+    if (goal_states[i].size() != goal_states_[i].size() ||
+        goal_states[i] != goal_states_[i])
+      return false;
+  return true;
+}
+
+template <typename S>
+S ReplanningSessionTpl<S>::advance(const VectorX<S> &state) {
+  const size_t n = path_.rows();
+  if (n < 2) {
+    progress_ = 0;
+    return (state - path_.row(0).transpose()).norm();
+  }
+
+  size_t best = std::max<size_t>(progress_, 1);
+  S best_distance = std::numeric_limits<S>::infinity(), best_t = 0;
+  for (size_t i = best; i < n; i++) {
+    const VectorX<S> start = path_.row(i - 1).transpose(),
+                     motion = path_.row(i).transpose() - start;
+    const S length2 = motion.squaredNorm();
+    const S t =
+        length2 > 0 ? std::clamp((state - start).dot(motion) / length2, S(0), S(1)) : 1;
+    const S distance = (start + t * motion - state).norm();
+    if (distance < best_distance) {
+      best = i;
+      best_distance = distance;
+      best_t = t;
+    }
+    // Stops at the first segment the state is on, the path may come back later
+    if (distance <= resolution_) break;
+  }
+  // At the end of a segment, the remaining path starts with the next segment
+  progress_ = best_t >= 1 && best + 1 < n ? best + 1 : best;
+  return best_distance;
+}
+
+template <typename S>
+bool ReplanningSessionTpl<S>::checkState(const VectorX<S> &state) const {
+  const auto &world = planner_->get_world();
+  const auto arts = world->getPlannedArticulations();
+  std::vector<VectorX<S>> qposes;
+  for (const auto &art : arts) qposes.push_back(art->getQpos());
+
+  world->setQposAll(state);
+  const bool valid = !world->collide();
+  for (size_t i = 0; i < arts.size(); i++) arts[i]->setQpos(qposes[i], true);
+  return valid;
+}
+
+template <typename S>
+bool ReplanningSessionTpl<S>::checkMotion(const VectorX<S> &state1,
+                                          const VectorX<S> &state2) const {
+  const auto &world = planner_->get_world();
+  const auto arts = world->getPlannedArticulations();
+  std::vector<VectorX<S>> qposes;
+  for (const auto &art : arts) qposes.push_back(art->getQpos());
+
+  const S max_motion = (state2 - state1).cwiseAbs().maxCoeff();
+  const int n = std::max(static_cast<int>(std::ceil(max_motion / resolution_)), 1);
+  bool valid = true;
+  for (int j = 0; j <= n && valid; j++) {
+    const S t = static_cast<S>(j) / n;
+    world->setQposAll((1 - t) * state1 + t * state2);
+    valid = !world->collide();
+  }
+  for (size_t i = 0; i < arts.size(); i++) arts[i]->setQpos(qposes[i], true);
+  return valid;
+}
+
+template <typename S>
+void ReplanningSessionTpl<S>::setPath(const MatrixX<S> &path) {
+  path_ = path;
+  progress_ = 0;
+  monitor_ =
+      std::make_shared<PathMonitorTpl<S>>(planner_->get_world(), path_, resolution_);
+}
+
+}  // namespace mplib::ompl
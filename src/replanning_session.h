@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "macros_utils.h"
+#include "ompl_planner.h"
+#include "path_monitor.h"
+#include "types.h"
+
+namespace mplib::ompl {
+
+/// @brief How ReplanningSession::replan() obtained its path
+enum class ReplanMode {
+  REUSED,    // the remaining previous path is still valid
+  REPAIRED,  // invalid portions of the previous path were replanned locally
+  REPLANNED  // planned from scratch (new goals, failed repair or no previous path)
+};
+
+// ReplanResultTplPtr
+MPLIB_STRUCT_TEMPLATE_FORWARD(ReplanResultTpl);
+
+/// @brief Result of ReplanningSession::replan()
+template <typename S>
+struct ReplanResultTpl {
+  std::string status;  // planner status, "Exact solution" if a path is found
+  MatrixX<S> path;     // from the current state to a goal state, empty if failed
+  ReplanMode mode {ReplanMode::REPLANNED};
+  std::vector<size_t> repaired_segments;  // segments of the previous path replanned
+  double planning_time {};                // wall-clock time in seconds
+};
+
+// Common Type Alias ==========================================================
+using ReplanResultf = ReplanResultTpl<float>;
+using ReplanResultd = ReplanResultTpl<double>;
+using ReplanResultfPtr = ReplanResultTplPtr<float>;
+using ReplanResultdPtr = ReplanResultTplPtr<double>;
+
+// ReplanningSessionTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(ReplanningSessionTpl);
+
+/**
+ * @brief Receding-horizon replanning to fixed goal states in a changing scene.
+ *  The session keeps the path of the previous call and a PathMonitor on it. Each
+ *  call advances along the path to the current state, revalidates only the
+ *  segments affected by scene changes and replans only between the valid
+ *  waypoints around each invalid portion. It plans from scratch if the goal
+ *  states change, if a repair fails or if the goal itself becomes invalid. If that
+ *  fails as well, the previous path is kept and reused or repaired by the next call.
+ *
+ *  Planning is bounded by a deadline shared by all plan() calls of a replan()
+ *  call. OMPL trees are not kept between calls: repairs are short local queries.
+ */
+template <typename S>
+class ReplanningSessionTpl {
+ public:
+  /**
+   * @param planner: planner used for repairs and full plans
+   * @param resolution: maximum joint motion between checked states (see
+   *  PathMonitor)
+   */
+  ReplanningSessionTpl(const OMPLPlannerTplPtr<S> &planner, S resolution = 0.01);
+
+  /**
+   * @brief Plans from current state to any of the goal states, reusing the path of
+   *  the previous call when possible
+   * @param current_state: current state of the planned articulations
+   * @param goal_states: goal states. The previous path is reused only if they are
+   *  the same as in the previous call.
+   * @param deadline: time limit of the call in seconds
+   * @param planner_name: planner of plan()
+   * @param range: planning range (for RRT family of planners)
+   * @returns the path and how it was obtained
+   */
+  ReplanResultTpl<S> replan(const VectorX<S> &current_state,
+                            const std::vector<VectorX<S>> &goal_states,
+                            double deadline,
+                            const std::string &planner_name = "RRTConnect",
+                            double range = 0.0);
+
+  /// @brief Gets the path of the last successful call (empty if none)
+  const MatrixX<S> &getPath() const { return path_; }
+
+  /// @brief Forgets the previous path, the next call plans from scratch
+  void reset();
+
+ private:
+  OMPLPlannerTplPtr<S> planner_;
+  S resolution_;
+  std::vector<VectorX<S>> goal_states_;
+  MatrixX<S> path_;
+  size_t progress_ {};  // segment of path_ containing the current state
+  PathMonitorTplPtr<S> monitor_;
+
+  /// @brief Whether goal_states are the goal states of path_
+  bool isSameGoal(const std::vector<VectorX<S>> &goal_states) const;
+
+  /**
+   * @brief Advances progress_ to the segment nearest to state
+   * @returns the joint-space distance from state to that segment
+   */
+  S advance(const VectorX<S> &state);
+
+  /// @brief Checks a state, restoring the world state
+  bool checkState(const VectorX<S> &state) const;
+
+  /// @brief Checks the linear motion between two states, restoring the world state
+  bool checkMotion(const VectorX<S> &state1, const VectorX<S> &state2) const;
+
+  /// @brief Replaces path_ and its monitor
+  void setPath(const MatrixX<S> &path);
+};
+
+// Common Type Alias ==========================================================
+using ReplanningSessionf = ReplanningSessionTpl<float>;
+using ReplanningSessiond = ReplanningSessionTpl<double>;
+using ReplanningSessionfPtr = ReplanningSessionTplPtr<float>;
+using ReplanningSessiondPtr = ReplanningSessionTplPtr<double>;
+
+// Explicit Template Instantiation Declaration ================================
+#define DECLARE_TEMPLATE_REPLANNING_SESSION(S) \
+  extern template class ReplanResultTpl<S>;    \
+  extern template class ReplanningSessionTpl<S>
+
+DECLARE_TEMPLATE_REPLANNING_SESSION(float);
+DECLARE_TEMPLATE_REPLANNING_SESSION(double);
+
+}  // namespace mplib::ompl
@@ -0,0 +1,322 @@
+#include "shared_geometry.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "macros_utils.h"
+
+namespace mplib::fcl {
+
+// Explicit Template Instantiation Definition =================================
+#define DEFINE_TEMPLATE_SHARED_GEOMETRY(S) template class SharedGeometryStoreTpl<S>
+
+DEFINE_TEMPLATE_SHARED_GEOMETRY(float);
+DEFINE_TEMPLATE_SHARED_GEOMETRY(double);
+
+namespace {
+
+constexpr char kMagic[8] = "MPLIBSG";
+constexpr uint32_t kVersion = 1;
+
+enum class GeometryType : uint32_t { MESH, CONVEX, OCTREE };
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t scalar_size;  // sizeof(S) of the vertices
+  uint64_t num_entries;
+  uint64_t size;  // of the whole segment
+};
+
+/// @brief Read-only std::istream buffer over mapped memory
+struct MemoryBuffer : std::streambuf {
+  MemoryBuffer(const std::byte *data, size_t size) {
+    auto begin = reinterpret_cast<char *>(const_cast<std::byte *>(data));
+    setg(begin, begin, begin + size);
+  }
+};
+
+std::string errnoMessage(const std::string &what, const std::string &name) {
+  return what + " " + name + ": " + std::strerror(errno);
+}
+
+}  // namespace
+
+template <typename S>
+struct SharedGeometryStoreTpl<S>::Entry {
+  uint64_t key_offset, key_size;
+  GeometryType type;
+  uint32_t num_faces;  // of convex meshes
+  // Mesh: vertices (S[3]) and triangles (uint32_t[3])
+  // Convex: vertices (S[3]) and faces (int, fcl::Convex layout)
+  // Octree: binary octomap stream (bytes)
+  uint64_t offsets[2], counts[2];
+};
+
+template <typename S>
+SharedGeometryStoreTpl<S>::SharedGeometryStoreTpl(const std::string &name, bool owner)
+    : name_(name), owner_(owner) {}
+
+template <typename S>
+SharedGeometryStoreTpl<S>::~SharedGeometryStoreTpl() {
+  if (data_) munmap(const_cast<std::byte *>(data_), size_);
+  if (owner_) shm_unlink(name_.c_str());
+}
+
+template <typename S>
+std::shared_ptr<SharedGeometryStoreTpl<S>> SharedGeometryStoreTpl<S>::create(
+    const std::string &name,
+    const std::vector<std::pair<std::string, CollisionGeometryPtr>> &geometries) {
+  // Serialize everything into one buffer, arrays are 8-byte aligned
+  std::vector<Entry> entries(geometries.size());
+  std::vector<std::byte> buffer;
+  auto append = [&buffer](const void *data, size_t bytes) {
+    const size_t offset = (buffer.size() + 7) / 8 * 8;
+    buffer.resize(offset + bytes);
+    if (bytes > 0) std::memcpy(buffer.data() + offset, data, bytes);
+    return static_cast<uint64_t>(offset);
+  };
+  auto append_vertices = [&append](Entry &entry, const auto &vertices) {
+    std::vector<S> values;
+    for (const auto &vertex : vertices)
+      for (size_t k = 0; k < 3; k++) values.push_back(vertex[k]);
+    entry.offsets[0] = append(values.data(), values.size() * sizeof(S));
+    entry.counts[0] = values.size();
+  };
+  for (size_t i = 0; i < geometries.size(); i++) {
+    const auto &[key, geometry] = geometries[i];
+    auto &entry = entries[i];
+    entry.key_offset = append(key.data(), key.size());
+    entry.key_size = key.size();
+    entry.num_faces = 0;
+    entry.offsets[1] = entry.counts[1] = 0;
+    if (auto bvh = std::dynamic_pointer_cast<BVHModel_OBBRSS<S>>(geometry)) {
+      entry.type = GeometryType::MESH;
+      append_vertices(entry, std::vector<Vector3<S>>(
+                                 bvh->vertices, bvh->vertices + bvh->num_vertices));
+      std::vector<uint32_t> triangles;
+      for (int j = 0; j < bvh->num_tris; j++)
+        for (size_t k = 0; k < 3; k++) triangles.push_back(bvh->tri_indices[j][k]);
+      entry.offsets[1] = append(triangles.data(), triangles.size() * sizeof(uint32_t));
+      entry.counts[1] = triangles.size();
+    } else if (auto convex = std::dynamic_pointer_cast<Convex<S>>(geometry)) {
+      entry.type = GeometryType::CONVEX;
+      append_vertices(entry, convex->getVertices());
+      const auto &faces = convex->getFaces();
+      entry.num_faces = convex->getFaceCount();
+      entry.offsets[1] = append(faces.data(), faces.size() * sizeof(int));
+      entry.counts[1] = faces.size();
+    } else if (auto octree = std::dynamic_pointer_cast<SourceOcTreeTpl<S>>(geometry)) {
+      entry.type = GeometryType::OCTREE;
+      std::ostringstream stream;
+      octree->getSourceTree().writeBinaryConst(stream);
+      const auto bytes = stream.str();
+      entry.offsets[0] = append(bytes.data(), bytes.size());
+      entry.counts[0] = bytes.size();
+    } else
+      throw std::invalid_argument(
+          "Geometry " + key + " is not a BVHModel<OBBRSS>, Convex or SourceOcTree");
+  }
+
+  // Segment: header, entry table, buffer
+  const size_t data_offset = sizeof(Header) + entries.size() * sizeof(Entry);
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.scalar_size = sizeof(S);
+  header.num_entries = entries.size();
+  header.size = data_offset + buffer.size();
+  for (auto &entry : entries) {
+    entry.key_offset += data_offset;
+    for (auto &offset : entry.offsets) offset += data_offset;
+  }
+
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  ASSERT(fd >= 0, errnoMessage("Failed to create shared memory", name));
+  auto store = std::shared_ptr<SharedGeometryStoreTpl<S>>(
+      new SharedGeometryStoreTpl<S>(name, true));  // unlinks on failure
+  void *data = MAP_FAILED;
+  if (ftruncate(fd, header.size) == 0)
+    data = mmap(nullptr, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    throw std::runtime_error(errnoMessage("Failed to map shared memory", name));
+  }
+  auto *bytes = static_cast<std::byte *>(data);
+  std::memcpy(bytes, &header, sizeof(Header));
+  std::memcpy(bytes + sizeof(Header), entries.data(), entries.size() * sizeof(Entry));
+  std::memcpy(bytes + data_offset, buffer.data(), buffer.size());
+  munmap(data, header.size);
+
+  store->map(fd);
+  // The geometries are already built in this process
+  for (const auto &[key, geometry] : geometries) store->geometries_[key] = geometry;
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.stores.push_back(store);
+  return store;
+}
+
+template <typename S>
+std::shared_ptr<SharedGeometryStoreTpl<S>> SharedGeometryStoreTpl<S>::open(
+    const std::string &name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  ASSERT(fd >= 0, errnoMessage("Failed to open shared memory", name));
+  auto store = std::shared_ptr<SharedGeometryStoreTpl<S>>(
+      new SharedGeometryStoreTpl<S>(name, false));
+  store->map(fd);
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.stores.push_back(store);
+  return store;
+}
+
+template <typename S>
+void SharedGeometryStoreTpl<S>::unlink(const std::string &name) {
+  shm_unlink(name.c_str());
+}
+
+template <typename S>
+void SharedGeometryStoreTpl<S>::map(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error("Invalid shared geometry segment " + name_);
+  }
+  size_ = st.st_size;
+  auto *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping stays valid
+  ASSERT(data != MAP_FAILED, errnoMessage("Failed to map shared memory", name_));
+  data_ = static_cast<const std::byte *>(data);
+
+  const auto *header = reinterpret_cast<const Header *>(data_);
+  ASSERT(std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+             header->version == kVersion && header->size == size_,
+         "Invalid shared geometry segment " + name_);
+  ASSERT(header->scalar_size == sizeof(S),
+         "Shared geometry segment " + name_ + " has a different scalar type");
+  ASSERT(sizeof(Header) + header->num_entries * sizeof(Entry) <= size_,
+         "Invalid shared geometry segment " + name_);
+  const auto *entries = reinterpret_cast<const Entry *>(data_ + sizeof(Header));
+  for (size_t i = 0; i < header->num_entries; i++) {
+    const auto &entry = entries[i];
+    // Element sizes of the two arrays (int and uint32_t indices have the same size)
+    const size_t element_sizes[2] = {
+        entry.type == GeometryType::OCTREE ? 1 : sizeof(S), sizeof(uint32_t)};
+    bool valid = entry.key_offset + entry.key_size <= size_;
+    for (size_t j = 0; j < 2; j++)
+      valid &= entry.offsets[j] + entry.counts[j] * element_sizes[j] <= size_;
+    ASSERT(valid, "Invalid shared geometry segment " + name_);
+    entries_[std::string(reinterpret_cast<const char *>(data_ + entry.key_offset),
+                         entry.key_size)] = &entry;
+  }
+}
+
+template <typename S>
+std::string SharedGeometryStoreTpl<S>::getMeshKey(const std::string &mesh_path,
+                                                  const Vector3<S> &scale,
+                                                  bool convex) {
+  std::ostringstream key;
+  key << std::setprecision(std::numeric_limits<S>::max_digits10) << mesh_path
+      << "?scale=" << scale[0] << "," << scale[1] << "," << scale[2]
+      << (convex ? "&convex" : "");
+  return key.str();
+}
+
+template <typename S>
+typename SharedGeometryStoreTpl<S>::CollisionGeometryPtr
+SharedGeometryStoreTpl<S>::findMeshGeometry(const std::string &mesh_path,
+                                            const Vector3<S> &scale, bool convex) {
+  std::vector<std::shared_ptr<SharedGeometryStoreTpl<S>>> stores;
+  {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto it = registry.stores.begin(); it != registry.stores.end();)
+      if (auto store = it->lock()) {
+        stores.push_back(store);
+        it++;
+      } else
+        it = registry.stores.erase(it);
+  }
+  if (stores.empty()) return nullptr;
+  const auto key = getMeshKey(mesh_path, scale, convex);
+  for (const auto &store : stores)
+    if (auto geometry = store->getGeometry(key)) return geometry;
+  return nullptr;
+}
+
+template <typename S>
+std::vector<std::string> SharedGeometryStoreTpl<S>::getKeys() const {
+  std::vector<std::string> ret;
+  for (const auto &[key, entry] : entries_) ret.push_back(key);
+  return ret;
+}
+
+template <typename S>
+typename SharedGeometryStoreTpl<S>::CollisionGeometryPtr
+SharedGeometryStoreTpl<S>::getGeometry(const std::string &key) const {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return nullptr;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &geometry = geometries_[key];
+  if (!geometry) geometry = buildGeometry(*it->second);
+  return geometry;
+}
+
+template <typename S>
+typename SharedGeometryStoreTpl<S>::CollisionGeometryPtr
+SharedGeometryStoreTpl<S>::buildGeometry(const Entry &entry) const {
+  if (entry.type == GeometryType::OCTREE) {
+    MemoryBuffer buffer(data_ + entry.offsets[0], entry.counts[0]);
+    std::istream stream(&buffer);
+    auto tree = std::make_shared<octomap::OcTree>(0.1);  // resolution is read
+    ASSERT(tree->readBinary(stream), "Failed to read octree from " + name_);
+    return std::make_shared<SourceOcTreeTpl<S>>(tree);
+  }
+
+  const auto *values = reinterpret_cast<const S *>(data_ + entry.offsets[0]);
+  std::vector<Vector3<S>> vertices;
+  vertices.reserve(entry.counts[0] / 3);
+  for (size_t j = 0; j + 2 < entry.counts[0]; j += 3)
+    vertices.emplace_back(values[j], values[j + 1], values[j + 2]);
+
+  if (entry.type == GeometryType::CONVEX) {
+    const auto *faces = reinterpret_cast<const int *>(data_ + entry.offsets[1]);
+    return std::make_shared<Convex<S>>(
+        std::make_shared<const std::vector<Vector3<S>>>(std::move(vertices)),
+        entry.num_faces,
+        std::make_shared<const std::vector<int>>(faces, faces + entry.counts[1]),
+        true);
+  }
+
+  const auto *indices = reinterpret_cast<const uint32_t *>(data_ + entry.offsets[1]);
+  std::vector<Triangle> triangles;
+  triangles.reserve(entry.counts[1] / 3);
+  for (size_t j = 0; j + 2 < entry.counts[1]; j += 3)
+    triangles.emplace_back(indices[j], indices[j + 1], indices[j + 2]);
+  auto bvh = std::make_shared<BVHModel_OBBRSS<S>>();
+  bvh->beginModel();
+  bvh->addSubModel(vertices, triangles);
+  bvh->endModel();
+  return bvh;
+}
+
+template <typename S>
+typename SharedGeometryStoreTpl<S>::Registry &
+SharedGeometryStoreTpl<S>::getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+}  // namespace mplib::fcl
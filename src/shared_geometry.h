@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <octomap/OcTree.h>
+
+#include "macros_utils.h"
+#include "types.h"
+
+namespace mplib::fcl {
+
+// SourceOcTreeTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(SourceOcTreeTpl);
+
+/**
+ * @brief fcl::OcTree that keeps its octomap tree, which fcl::OcTree does not expose.
+ *  Octrees must be created as SourceOcTree to be added to a SharedGeometryStore.
+ */
+template <typename S>
+class SourceOcTreeTpl : public OcTree<S> {
+ public:
+  explicit SourceOcTreeTpl(const std::shared_ptr<const octomap::OcTree> &tree)
+      : OcTree<S>(tree), tree_(tree) {}
+
+  /// @brief Constructs an empty octree with given resolution
+  explicit SourceOcTreeTpl(S resolution)
+      : SourceOcTreeTpl(std::make_shared<const octomap::OcTree>(resolution)) {}
+
+  const octomap::OcTree &getSourceTree() const { return *tree_; }
+
+ private:
+  std::shared_ptr<const octomap::OcTree> tree_;
+};
+
+// Common Type Alias ==========================================================
+using SourceOcTreef = SourceOcTreeTpl<float>;
+using SourceOcTreed = SourceOcTreeTpl<double>;
+using SourceOcTreefPtr = SourceOcTreeTplPtr<float>;
+using SourceOcTreedPtr = SourceOcTreeTplPtr<double>;
+
+// SharedGeometryStoreTplPtr
+MPLIB_CLASS_TEMPLATE_FORWARD(SharedGeometryStoreTpl);
+
+/**
+ * @brief Immutable collision geometry in a POSIX shared-memory segment.
+ *  One process creates the segment from loaded geometries (triangle meshes, convex
+ *  meshes and octrees) and worker processes open it read-only. Geometries are keyed
+ *  by name; meshes loaded from files use getMeshKey(), so that FCLModel and
+ *  PlanningWorld take them from every open store instead of loading the files.
+ *
+ *  The segment holds the flat vertex, triangle / face and serialized octree data.
+ *  FCL and octomap own the memory of their geometries, so each process still builds
+ *  its own BVH (or octree) from the mapped data once, which is then shared by all
+ *  models of the process. This skips mesh file parsing and point cloud insertion,
+ *  but does not reduce the memory of each process: the built geometries are not
+ *  shared and the mapped data comes on top of them.
+ */
+template <typename S>
+class SharedGeometryStoreTpl {
+ public:
+  // Common type alias
+  using CollisionGeometryPtr = fcl::CollisionGeometryPtr<S>;
+
+  ~SharedGeometryStoreTpl();
+
+  SharedGeometryStoreTpl(const SharedGeometryStoreTpl &) = delete;
+  SharedGeometryStoreTpl &operator=(const SharedGeometryStoreTpl &) = delete;
+
+  /**
+   * @brief Creates a shared-memory segment holding the given geometries. The segment
+   *  is unlinked when the returned store is destroyed (processes that opened it keep
+   *  their mapping).
+   * @param name: name of the segment (e.g., "/mplib_geometry")
+   * @param geometries: pairs of key and geometry. Supported geometries are
+   *  BVHModel<OBBRSS>, Convex and SourceOcTree.
+   * @returns the created store (mapped read-only)
+   */
+  static std::shared_ptr<SharedGeometryStoreTpl<S>> create(
+      const std::string &name,
+      const std::vector<std::pair<std::string, CollisionGeometryPtr>> &geometries);
+
+  /**
+   * @brief Opens an existing segment read-only. While a store (opened or created) is
+   *  alive, meshes with a key in it are taken from it (see findMeshGeometry()).
+   * @param name: name of the segment
+   * @returns the opened store
+   */
+  static std::shared_ptr<SharedGeometryStoreTpl<S>> open(const std::string &name);
+
+  /// @brief Removes the segment name (e.g., left over by a crashed process)
+  static void unlink(const std::string &name);
+
+  /// @brief Gets the key of the mesh at mesh_path loaded with scale
+  static std::string getMeshKey(const std::string &mesh_path, const Vector3<S> &scale,
+                                bool convex);
+
+  /**
+   * @brief Gets the geometry of a mesh from the stores alive in this process
+   * @returns the geometry or nullptr if no store contains the mesh
+   */
+  static CollisionGeometryPtr findMeshGeometry(const std::string &mesh_path,
+                                               const Vector3<S> &scale, bool convex);
+
+  const std::string &getName() const { return name_; }
+
+  /// @brief Gets the size of the segment in bytes
+  size_t getSize() const { return size_; }
+
+  /// @brief Gets the keys of all geometries
+  std::vector<std::string> getKeys() const;
+
+  bool hasGeometry(const std::string &key) const { return entries_.count(key) > 0; }
+
+  /**
+   * @brief Gets the geometry with given key, built from the mapped data on the first
+   *  call and shared afterwards
+   * @returns the geometry or nullptr if key does not exist
+   */
+  CollisionGeometryPtr getGeometry(const std::string &key) const;
+
+ private:
+  struct Entry;
+
+  std::string name_;
+  bool owner_ {};
+  const std::byte *data_ {};
+  size_t size_ {};
+  std::unordered_map<std::string, const Entry *> entries_;
+  mutable std::unordered_map<std::string, CollisionGeometryPtr> geometries_;
+  mutable std::mutex mutex_;
+
+  SharedGeometryStoreTpl(const std::string &name, bool owner);
+
+  /// @brief Maps the segment of fd read-only and indexes its entries
+  void map(int fd);
+
+  /// @brief Builds the geometry of entry from the mapped data
+  CollisionGeometryPtr buildGeometry(const Entry &entry) const;
+
+  /// @brief Stores alive in this process, searched by findMeshGeometry()
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::weak_ptr<SharedGeometryStoreTpl<S>>> stores;
+  };
+
+  static Registry &getRegistry();
+};
+
+// Common Type Alias ==========================================================
+using SharedGeometryStoref = SharedGeometryStoreTpl<float>;
+using SharedGeometryStored = SharedGeometryStoreTpl<double>;
+using SharedGeometryStorefPtr = SharedGeometryStoreTplPtr<float>;
+using SharedGeometryStoredPtr = SharedGeometryStoreTplPtr<double>;
+
+// Explicit Template Instantiation Declaration ================================
+#define DECLARE_TEMPLATE_SHARED_GEOMETRY(S) \
+  extern template class SharedGeometryStoreTpl<S>
+
+DECLARE_TEMPLATE_SHARED_GEOMETRY(float);
+DECLARE_TEMPLATE_SHARED_GEOMETRY(double);
+
+}  // namespace mplib::fcl
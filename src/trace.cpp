@@ -0,0 +1,83 @@
+#include "trace.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "macros_utils.h"
+
+namespace mplib {
+
+namespace {
+
+/// @brief Small sequential thread ids (Chrome trace "tid"), in order of first span
+int getTraceThreadId() {
+  static std::atomic<int> next_id {0};
+  thread_local const int id = next_id++;
+  return id;
+}
+
+std::string escapeJson(const std::string &str) {
+  std::string ret;
+  for (const char c : str) {
+    if (c == '"' || c == '\\') ret += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20) ret += c;
+  }
+  return ret;
+}
+
+}  // namespace
+
+bool Tracer::isCompiledIn() {
+#ifdef MPLIB_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+void Tracer::start(const std::string &filename) {
+  ASSERT(isCompiledIn(), "mplib was built without MPLIB_ENABLE_TRACING");
+  std::lock_guard<std::mutex> lock(mutex_);
+  spans_.clear();
+  filename_ = filename;
+  recording_ = true;
+}
+
+void Tracer::stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!recording_) return;
+  recording_ = false;
+  std::ofstream file(filename_);
+  ASSERT(file, "Failed to open trace file " + filename_);
+  // Complete events ("ph": "X"), timestamps and durations in microseconds
+  const auto pid = getpid();
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (size_t i = 0; i < spans_.size(); i++) {
+    const auto &span = spans_[i];
+    file << (i ? ",\n" : "\n") << "{\"name\":\"" << escapeJson(span.name)
+         << "\",\"cat\":\"mplib\",\"ph\":\"X\",\"ts\":" << span.begin_us
+         << ",\"dur\":" << span.duration_us << ",\"pid\":" << pid
+         << ",\"tid\":" << span.thread_id << "}";
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  spans_.clear();
+}
+
+double Tracer::now() {
+  using Clock = std::chrono::steady_clock;
+  static const auto origin = Clock::now();
+  return std::chrono::duration<double, std::micro>(Clock::now() - origin).count();
+}
+
+void Tracer::addSpan(std::string name, double begin_us, double end_us) {
+  const int thread_id = getTraceThreadId();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!recording_) return;
+  spans_.push_back({std::move(name), begin_us, end_us - begin_us, thread_id});
+}
+
+}  // namespace mplib
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mplib {
+
+/**
+ * @brief Records timed spans of the planning pipeline and writes them as Chrome
+ *  trace JSON (viewable in chrome://tracing or Perfetto).
+ *  Spans in the library are added with the MPLIB_TRACE_SPAN macros, which compile
+ *  to nothing unless mplib is built with MPLIB_ENABLE_TRACING (CMake option of the
+ *  same name). Spans are recorded only between start() and stop().
+ */
+class Tracer {
+ public:
+  /// @brief Whether mplib was built with MPLIB_ENABLE_TRACING
+  static bool isCompiledIn();
+
+  /**
+   * @brief Starts recording spans, discarding the spans of any previous recording
+   * @param filename: file written by stop()
+   */
+  static void start(const std::string &filename);
+
+  /// @brief Stops recording and writes the recorded spans to the file of start()
+  static void stop();
+
+  static bool isRecording() { return recording_.load(std::memory_order_relaxed); }
+
+  /// @brief Microseconds since the first use of the tracer (trace timestamps)
+  static double now();
+
+  /// @brief Records a span (if recording) on the calling thread
+  static void addSpan(std::string name, double begin_us, double end_us);
+
+ private:
+  struct Span {
+    std::string name;
+    double begin_us, duration_us;
+    int thread_id;
+  };
+
+  inline static std::atomic<bool> recording_ {false};
+  inline static std::mutex mutex_;
+  inline static std::vector<Span> spans_;
+  inline static std::string filename_;
+};
+
+/// @brief Period of sampled spans of frequent events (e.g., validity checks)
+constexpr uint64_t kTraceSamplePeriod = 100;
+
+/// @brief Records a span from construction to destruction (see MPLIB_TRACE_SPAN)
+class TraceSpan {
+ public:
+  /// @param name: span name, must outlive the span (e.g., a string literal)
+  explicit TraceSpan(const char *name, bool enabled = true)
+      : name_(enabled && Tracer::isRecording() ? name : nullptr) {
+    if (name_) begin_us_ = Tracer::now();
+  }
+
+  ~TraceSpan() {
+    if (name_) Tracer::addSpan(name_, begin_us_, Tracer::now());
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+ private:
+  const char *name_;
+  double begin_us_ {};
+};
+
+}  // namespace mplib
+
+#define MPLIB_TRACE_CONCAT_IMPL(a, b) a##b
+#define MPLIB_TRACE_CONCAT(a, b) MPLIB_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef MPLIB_ENABLE_TRACING
+/// @brief Traces the rest of the enclosing scope as a span named name
+#define MPLIB_TRACE_SPAN(name) \
+  ::mplib::TraceSpan MPLIB_TRACE_CONCAT(mplib_trace_span_, __LINE__)(name)
+/// @brief Like MPLIB_TRACE_SPAN, but traces one in period calls (per thread)
+#define MPLIB_TRACE_SPAN_SAMPLED(name, period)                           \
+  static thread_local uint64_t MPLIB_TRACE_CONCAT(mplib_trace_count_,    \
+                                                  __LINE__) = 0;         \
+  ::mplib::TraceSpan MPLIB_TRACE_CONCAT(mplib_trace_span_, __LINE__)(    \
+      name, MPLIB_TRACE_CONCAT(mplib_trace_count_, __LINE__)++ % (period) == 0)
+#else
+#define MPLIB_TRACE_SPAN(name) static_cast<void>(0)
+#define MPLIB_TRACE_SPAN_SAMPLED(name, period) static_cast<void>(0)
+#endif
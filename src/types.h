@@ -48,9 +48,15 @@ using Matrix6X = Eigen::Matrix<S, 6, Eigen::Dynamic>;
 template <typename S>
 using MatrixX3 = Eigen::Matrix<S, Eigen::Dynamic, 3>;
 
+// Row-major so that each pose (xyz, wxyz) is contiguous, matching numpy's layout
+template <typename S>
+using MatrixX7 = Eigen::Matrix<S, Eigen::Dynamic, 7, Eigen::RowMajor>;
+
 template <typename S>
 using MatrixX = Eigen::Matrix<S, Eigen::Dynamic, Eigen::Dynamic>;
 
+using MatrixX2i = Eigen::Matrix<int, Eigen::Dynamic, 2>;
+
 using MatrixX3i = Eigen::Matrix<int, Eigen::Dynamic, 3>;
 
 template <typename S>
@@ -141,6 +147,9 @@ using OcTree = ::fcl::OcTree<S>;
 template <typename S>
 using CollisionObject = ::fcl::CollisionObject<S>;
 
+template <typename S>
+using AABB = ::fcl::AABB<S>;
+
 template <typename S>
 using CollisionObjectPtr = std::shared_ptr<CollisionObject<S>>;
 
@@ -5,6 +5,8 @@
 #include <urdf_model/link.h>
 #include <urdf_model/model.h>
 
+#include "shared_geometry.h"
+
 namespace mplib {
 
 // Explicit Template Instantiation Definition =================================
@@ -135,6 +137,9 @@ int dfs_build_mesh(const aiScene *scene, const aiNode *node, const Vector3<S> &s
 template <typename S>
 std::shared_ptr<fcl::BVHModel<fcl::OBBRSS<S>>> load_mesh_as_BVH(
     const std::string &mesh_path, const Vector3<S> &scale) {
+  if (auto geom = std::dynamic_pointer_cast<fcl::BVHModel<fcl::OBBRSS<S>>>(
+          fcl::SharedGeometryStoreTpl<S>::findMeshGeometry(mesh_path, scale, false)))
+    return geom;
   auto loader = AssimpLoader();  // TODO[Xinsong] change to a global loader so
                                  // we do not initialize it every time
   loader.load(mesh_path);
@@ -156,6 +161,9 @@ std::shared_ptr<fcl::BVHModel<fcl::OBBRSS<S>>> load_mesh_as_BVH(
 template <typename S>
 std::shared_ptr<fcl::Convex<S>> load_mesh_as_Convex(const std::string &mesh_path,
                                                     const Vector3<S> &scale) {
+  if (auto convex = std::dynamic_pointer_cast<fcl::Convex<S>>(
+          fcl::SharedGeometryStoreTpl<S>::findMeshGeometry(mesh_path, scale, true)))
+    return convex;
   auto loader = AssimpLoader();
   loader.load(mesh_path);
 
@@ -1,6 +1,29 @@
+import json
+import os
+
 import numpy as np
+import pytest
+from transforms3d.quaternions import quat2mat
 
 from mplib import Planner
+from mplib.pymp.fcl import (
+    Box,
+    CollisionObject,
+    CollisionRequest,
+    DistanceRequest,
+    SharedGeometryStore,
+    Sphere,
+)
+from mplib.pymp import perf_counters, trace
+from mplib.pymp.articulation import ArticulatedModel
+from mplib.pymp.ompl import (
+    BatchPlanOptions,
+    MotionValidatorType,
+    OMPLPlanner,
+    ReplanMode,
+    ReplanningSession,
+)
+from mplib.pymp.planning_world import CollisionReportLevel, PathMonitor
 
 PANDA_SPEC = {
     "urdf": "data/panda/panda.urdf",
@@ -50,5 +73,679 @@ def test_plan_screw():
     planner.plan_screw(pose, qpos)
 
 
+def test_link_and_collision_poses():
+    planner = Planner(**PANDA_SPEC)
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    planner.robot.set_qpos(qpos, True)
+    link_poses = planner.robot.get_link_poses()
+    assert link_poses.shape == (len(PANDA_SPEC["user_link_names"]), 7)
+    assert not link_poses.flags.writeable
+    for i in range(len(link_poses)):
+        assert np.allclose(link_poses[i], planner.pinocchio_model.get_link_pose(i))
+
+    col_objs = planner.robot.get_fcl_model().get_collision_objects()
+    col_poses = planner.robot.get_collision_poses()
+    assert col_poses.shape == (len(col_objs), 7)
+    for col_obj, pose in zip(col_objs, col_poses):
+        assert np.allclose(pose[:3], col_obj.get_translation())
+        assert np.allclose(quat2mat(pose[3:]), col_obj.get_rotation())
+
+
+def test_set_object_poses():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    world.add_normal_object("box", CollisionObject(Box([0.1, 0.1, 0.1])))
+    world.add_normal_object("sphere", CollisionObject(Sphere(0.05)))
+    world.set_normal_object_offset("sphere", [0, 0, 0.1, 1, 0, 0, 0])
+    poses = np.array([[0.5, 0, 0.2, 1, 0, 0, 0], [0.5, 0.3, 0.2, 0, 0, 0, 1]])
+    world.set_object_poses(["box", "sphere"], poses)
+    assert np.allclose(world.get_normal_object("box").get_translation(), [0.5, 0, 0.2])
+    # Offset is expressed in the object frame (rotated by pi around z)
+    sphere = world.get_normal_object("sphere")
+    assert np.allclose(sphere.get_translation(), [0.5, 0.3, 0.3])
+    assert np.allclose(sphere.get_rotation(), np.diag([-1, -1, 1]))
+
+
+def test_object_handles():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    handle = world.add_normal_object("box", CollisionObject(Box([0.1, 0.1, 0.1])))
+    sphere = world.add_normal_object("sphere", CollisionObject(Sphere(0.05)))
+    assert world.get_normal_object_handle("box") == handle
+    assert world.get_normal_object(handle) is world.get_normal_object("box")
+    # Re-adding an existing name keeps the handle
+    assert world.add_normal_object("box", CollisionObject(Sphere(0.1))) == handle
+
+    world.set_object_poses([handle], np.array([[0.5, 0, 0.2, 1, 0, 0, 0]]))
+    assert np.allclose(world.get_normal_object(handle).get_translation(), [0.5, 0, 0.2])
+
+    # Removal invalidates the handle, but not the handles of other objects
+    world.remove_normal_object("box")
+    assert world.get_normal_object(handle) is None
+    assert world.get_normal_object(sphere) is world.get_normal_object("sphere")
+    new_handle = world.add_normal_object("box", CollisionObject(Sphere(0.1)))
+    assert new_handle != handle
+    assert world.get_normal_object(handle) is None
+
+
+def test_collision_report_levels():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    world.add_normal_object("box", CollisionObject(Box([0.1, 0.1, 0.1])))
+    world.add_normal_object("box2", CollisionObject(Box([0.1, 0.1, 0.1]), [0, 0, 0.05]))
+    # Both boxes overlap with panda_link0
+    world.set_qpos_all(np.zeros(7))
+    full = world.collide_full()
+    assert len(full) > 1
+    assert world.collide()
+    assert len(world.collide_full(level=CollisionReportLevel.BOOL)) == 1
+    assert len(world.collide_full(level=CollisionReportLevel.PAIRS)) == len(full)
+
+    pairs = world.collide_report(level=CollisionReportLevel.PAIRS)
+    assert len(pairs) == len(full)
+    assert pairs.contact_points.shape == (0, 3)
+    contacts = world.collide_report(level=CollisionReportLevel.CONTACTS)
+    assert len(contacts) == len(full)
+    assert len(contacts.contact_points) >= len(full)
+
+
+def test_attached_body_pose_cache():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    link_id = planner.move_group_link_id
+    planner.update_attached_box([0.04, 0.04, 0.12], [0, 0, 0.14, 1, 0, 0, 0])
+    body = world.get_attached_object(f"robot_{link_id}_box")
+    obj = body.get_object()
+
+    version = planner.robot.get_state_version()
+    planner.robot.set_qpos(np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0]), True)
+    assert planner.robot.get_state_version() > version
+    world.collide()  # updates attached body poses
+    link_pose = planner.robot.get_link_poses()[link_id]
+    expected = link_pose[:3] + quat2mat(link_pose[3:]) @ [0, 0, 0.14]
+    assert np.allclose(obj.get_translation(), expected)
+
+    # Changing the attached pose is picked up without a state change
+    body.set_pose([0, 0, 0.2, 1, 0, 0, 0])
+    body.update_pose()
+    expected = link_pose[:3] + quat2mat(link_pose[3:]) @ [0, 0, 0.2]
+    assert np.allclose(obj.get_translation(), expected)
+
+    # A transform set elsewhere is overwritten without a state change
+    obj.set_transformation([1, 1, 1, 1, 0, 0, 0])
+    world.collide()
+    assert np.allclose(obj.get_translation(), expected)
+
+
+def test_self_collision_cache():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    # Contacts are never cached, so this request always checks every pair
+    uncached_request = CollisionRequest(enable_contact=True)
+    qpos = planner.pinocchio_model.get_random_configuration()
+    for _ in range(50):
+        # Only move the last joints so that most pairs can reuse cached results
+        qpos[4:] = planner.pinocchio_model.get_random_configuration()[4:]
+        planner.robot.set_qpos(qpos, True)
+        cached = {(c.link_name1, c.link_name2) for c in world.self_collide()}
+        uncached = {
+            (c.link_name1, c.link_name2) for c in world.self_collide(uncached_request)
+        }
+        assert cached == uncached
+
+    # Moving collision objects outside set_qpos() invalidates the cache
+    fcl_model = planner.robot.get_fcl_model()
+    planner.robot.set_qpos(np.zeros(9), True)
+    assert len(world.self_collide()) == 0
+    link_poses = planner.robot.get_link_poses().copy()
+    link_poses[7] = link_poses[1]  # move panda_link7 onto panda_link1
+    fcl_model.update_collision_objects(list(link_poses))
+    assert len(world.self_collide()) == len(world.self_collide(uncached_request)) > 0
+
+
+def test_collide_scene_subset():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    # The box overlaps with panda_link0, the sphere is far away
+    box = world.add_normal_object("box", CollisionObject(Box([0.1, 0.1, 0.1])))
+    sphere = world.add_normal_object("sphere", CollisionObject(Sphere(0.05), [2, 0, 0]))
+    world.set_qpos_all(np.zeros(7))
+    assert world.collide_with_others([box])
+    assert not world.collide_with_others([sphere])
+    assert world.collide([box, sphere])
+
+
+def test_displacement_bounds():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    planner.robot.set_qpos(planner.pinocchio_model.get_random_configuration(), True)
+    bounds = world.get_displacement_bounds()
+    link_names = planner.robot.get_fcl_model().get_collision_link_names()
+    assert bounds.shape == (len(link_names), planner.robot.get_qpos_dim())
+    assert np.all(bounds >= 0)
+    # The base does not move, the hand moves with every arm joint
+    assert np.all(bounds[link_names.index("panda_link0")] == 0)
+    assert np.all(bounds[link_names.index("panda_hand"), :7] > 0)
+
+
+def test_plan_max_displacement():
+    planner = Planner(**PANDA_SPEC)
+    # Check motions so that no point of the robot moves more than 2cm between checks
+    planner.planner.set_max_displacement(0.02)
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    result = planner.plan(pose, qpos)
+    assert result["status"] == "Success"
+
+
+def test_plan_motion_validator():
+    planner = Planner(**PANDA_SPEC)
+    assert planner.planner.get_motion_validator() == MotionValidatorType.SWEPT
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    for validator in [MotionValidatorType.CERTIFIED, MotionValidatorType.SWEPT]:
+        planner.planner.set_motion_validator(validator)
+        assert planner.planner.get_motion_validator() == validator
+        result = planner.plan(pose, qpos)
+        assert result["status"] == "Success"
+
+
+def test_plan_linear_nearest_neighbors():
+    planner = Planner(**PANDA_SPEC)
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    for enabled in [True, False]:
+        planner.planner.set_linear_nearest_neighbors(enabled)
+        for planner_name in ["RRTConnect", "RRTstar"]:
+            result = planner.plan(pose, qpos, planner_name=planner_name)
+            assert result["status"] == "Success"
+
+
+def test_plan_batch():
+    planner = Planner(**PANDA_SPEC)
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    poses = [[0.4, y, 0.12, 0, 1, 0, 0] for y in [-0.3, 0.0, 0.3]]
+    poses.append([2.0, 0, 0.12, 0, 1, 0, 0])  # out of reach
+    results = planner.plan_batch(poses, qpos, num_threads=2)
+    assert len(results) == len(poses)
+    for result in results[:3]:
+        assert result["status"] == "Success"
+        assert result["planning_time"] > 0 and result["path_length"] > 0
+    assert results[3]["status"].startswith("IK Failed")
+
+    # A failing query does not affect the others
+    start = qpos[planner.move_group_joint_indices]
+    options = BatchPlanOptions()
+    options.time = 0.2
+    options.num_threads = 2
+    batch = planner.planner.plan_batch([start], [[start + 0.1], [start + 100]], options)
+    assert batch[0].success and not batch[1].success
+    assert np.allclose(batch[0].path[0], start)
+    assert np.allclose(batch[0].path[-1], start + 0.1)
+    with pytest.raises(RuntimeError):
+        planner.planner.plan_batch([start, start], [[start]], options)
+
+
+def test_validate_trajectory():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    q1 = q0 + [1.0, 0, 0, 0, 0, 0, 0]
+    qs = np.array([q0, q1, q0])
+    assert world.validate_trajectory(qs, 0.01).valid
+
+    # Put a box around the hand at q1
+    planner.robot.set_qpos(q1)
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    world.add_normal_object("box", CollisionObject(Box([0.05] * 3), hand_pose[:3]))
+    planner.robot.set_qpos(q0)
+    version = planner.robot.get_state_version()
+    result = world.validate_trajectory(qs, 0.01, num_threads=4)
+    assert not result.valid
+    assert result.index == 1 and 0 < result.fraction <= 1
+    assert np.allclose(result.qpos, q0 + result.fraction * (q1 - q0))
+    assert result.collision.object_name2 == "box"
+    # The world itself is not modified
+    assert planner.robot.get_state_version() == version
+    assert world.clone().get_normal_object("box") is not world.get_normal_object("box")
+
+
+def test_path_monitor():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    q1 = q0 + [1.0, 0, 0, 0, 0, 0, 0]
+    planner.robot.set_qpos(q0)
+    monitor = PathMonitor(world, np.array([q0, q1, q0]), 0.01)
+    assert monitor.get_segment_count() == 3
+    assert monitor.update().valid
+    assert monitor.get_checked_segments() == []
+
+    # An object far from the path does not need any check
+    world.add_normal_object("far", CollisionObject(Box([0.05] * 3), [3, 0, 0]))
+    assert monitor.update().valid
+    assert monitor.get_changed_objects() == ["far"]
+    assert monitor.get_checked_segments() == []
+
+    # Put a box around the hand at q1
+    planner.robot.set_qpos(q1)
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    world.add_normal_object("box", CollisionObject(Box([0.05] * 3), hand_pose[:3]))
+    planner.robot.set_qpos(q0)
+    result = monitor.update()
+    assert not result.valid
+    assert result.index == 1 and 0 < result.fraction <= 1
+    assert result.collision.object_name2 == "box"
+    assert monitor.get_changed_objects() == ["box"]
+    assert monitor.get_invalid_segments() == [1, 2]
+    assert 0 not in monitor.get_checked_segments()
+    # The state of the world is restored
+    assert np.allclose(planner.robot.get_qpos()[:7], q0)
+
+    # Invalid segments become valid again once the obstacle is gone
+    world.remove_normal_object("box")
+    assert monitor.update().valid
+    assert monitor.get_invalid_segments() == []
+
+
+def test_replanning_session():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    q1 = q0 + [1.0, 0, 0, 0, 0, 0, 0]
+    planner.robot.set_qpos(q0)
+    session = ReplanningSession(planner.planner)
+    result = session.replan(q0, [q1], 1.0, range=0.1)
+    assert result.status == "Exact solution"
+    assert result.mode == ReplanMode.REPLANNED
+    path = result.path
+    assert len(path) > 3
+
+    # Nothing changed, the remaining path is reused
+    result = session.replan(q0, [q1], 1.0, range=0.1)
+    assert result.mode == ReplanMode.REUSED
+    assert np.allclose(result.path, path)
+    result = session.replan(path[2], [q1], 1.0, range=0.1)
+    assert result.mode == ReplanMode.REUSED
+    assert np.allclose(result.path, path[2:])
+
+    # A box around the hand in the middle of the path is avoided locally
+    planner.robot.set_qpos(path[len(path) // 2])
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    world.add_normal_object("box", CollisionObject(Box([0.05] * 3), hand_pose[:3]))
+    planner.robot.set_qpos(q0)
+    result = session.replan(path[2], [q1], 1.0, range=0.1)
+    assert result.status == "Exact solution"
+    assert result.mode == ReplanMode.REPAIRED
+    assert len(result.repaired_segments) > 0
+    assert np.allclose(result.path[0], path[2]) and np.allclose(result.path[-1], q1)
+    repaired_path = session.get_path()
+
+    # A box at the goal fails the repair and the full plan, the path is kept
+    planner.robot.set_qpos(q1)
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    world.add_normal_object("goal_box", CollisionObject(Box([0.05] * 3), hand_pose[:3]))
+    planner.robot.set_qpos(q0)
+    result = session.replan(path[2], [q1], 0.2, range=0.1)
+    assert result.status != "Exact solution"
+    assert np.allclose(session.get_path(), repaired_path)
+    world.remove_normal_object("goal_box")
+    result = session.replan(path[2], [q1], 1.0, range=0.1)
+    assert result.status == "Exact solution"
+    assert result.mode == ReplanMode.REUSED
+
+    # New goal states are planned from scratch
+    result = session.replan(q0, [q0], 1.0)
+    assert result.mode == ReplanMode.REPLANNED
+
+    # Planner.replan() keeps IK solutions and the path while valid
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    result = planner.replan(pose, qpos, deadline=1.0)
+    assert result["status"] == "Success"
+    assert result["mode"] == ReplanMode.REPLANNED
+    result2 = planner.replan(pose, qpos, deadline=1.0)
+    assert result2["mode"] == ReplanMode.REUSED
+    assert np.allclose(result2["position"], result["position"])
+
+    # The trajectory starts at the current qpos while executing
+    qpos[:7] = result["position"][len(result["position"]) // 2]
+    result3 = planner.replan(pose, qpos, deadline=1.0)
+    assert result3["status"] == "Success"
+    assert result3["time"][0] == 0 and np.allclose(result3["position"][0], qpos[:7])
+    assert result3["duration"] < result["duration"]
+
+
+def test_dynamic_object():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    world.set_qpos_all(np.zeros(7))
+    # The box moves from far away to the base of the robot
+    world.add_normal_object("box", CollisionObject(Box([0.1, 0.1, 0.1])))
+    poses = np.array([[2, 0, 0, 1, 0, 0, 0], [0, 0, 0, 1, 0, 0, 0]])
+    world.set_object_trajectory("box", np.array([0.0, 1.0]), poses)
+    assert world.get_dynamic_object_names() == ["box"]
+    assert not world.collide_at_time(0.0)
+    assert world.collide_at_time(1.0)
+    assert world.get_time() == 1.0
+    world.set_time(0.5)
+    assert np.allclose(world.get_normal_object("box").get_translation(), [1, 0, 0])
+
+    # Plan in (q, t) while the box approaches
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    q1 = q0 + [1.0, 0, 0, 0, 0, 0, 0]
+    status, path = planner.planner.plan_with_time(q0, 0.0, [q1], np.ones(7), 5.0)
+    assert status == "Exact solution"
+    assert np.all(np.diff(path[:, -1]) > 0)
+    assert np.allclose(path[0, :-1], q0) and np.allclose(path[-1, :-1], q1)
+
+    assert world.remove_object_trajectory("box")
+    assert world.get_dynamic_object_names() == []
+
+
+def test_plan_prioritized():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    assert world.get_planned_articulation_names() == ["robot"]
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    q1 = q0 + [1.0, 0, 0, 0, 0, 0, 0]
+
+    # An articulation with a joint trajectory is moved by set_time
+    world.set_articulation_trajectory("robot", np.array([0.0, 1.0]), np.array([q0, q1]))
+    world.set_time(0.5)
+    assert np.allclose(planner.robot.get_qpos()[:7], (q0 + q1) / 2)
+    assert world.remove_articulation_trajectory("robot")
+
+    status, path = planner.planner.plan_prioritized(q0, 0.0, [q1], np.ones(7), 5.0)
+    assert status == "Exact solution"
+    assert path.shape[1] == 8 and np.all(np.diff(path[:, -1]) > 0)
+    assert np.allclose(path[0, :-1], q0) and np.allclose(path[-1, :-1], q1)
+
+
+def make_facing_panda(tmp_path, x):
+    """A second panda named panda2 at (x, 0, 0), facing the first one"""
+    mesh_dir = os.path.abspath("data/panda/franka_description")
+    with open(PANDA_SPEC["urdf"], "r") as f:
+        urdf = f.read().replace("franka_description", mesh_dir)
+    with open(PANDA_SPEC["srdf"], "r") as f:
+        srdf = f.read()
+    origin = f'<origin rpy="0 0 {np.pi}" xyz="{x} 0 0"/>'
+    link0_start = urdf.index('<link name="panda_link0">')
+    link0_end = urdf.index("</link>", link0_start)
+    link0 = urdf[link0_start:link0_end].replace("<geometry>", origin + "<geometry>")
+    urdf = urdf[:link0_start] + link0 + urdf[link0_end:]
+    urdf = urdf.replace(
+        '<origin rpy="0 0 0" xyz="0 0 0.333"/>',
+        f'<origin rpy="0 0 {np.pi}" xyz="{x} 0 0.333"/>',
+    )
+    (tmp_path / "panda2.urdf").write_text(urdf.replace("panda_", "panda2_"))
+    (tmp_path / "panda2.srdf").write_text(srdf.replace("panda_", "panda2_"))
+    robot = ArticulatedModel(
+        str(tmp_path / "panda2.urdf"),
+        str(tmp_path / "panda2.srdf"),
+        joint_names=[
+            name.replace("panda_", "panda2_") for name in PANDA_SPEC["user_joint_names"]
+        ],
+        link_names=[
+            name.replace("panda_", "panda2_") for name in PANDA_SPEC["user_link_names"]
+        ],
+        verbose=False,
+        convex=True,
+    )
+    robot.set_move_group("panda2_hand")
+    return robot
+
+
+def test_plan_prioritized_two_arms(tmp_path):
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    world.add_articulation("robot2", make_facing_panda(tmp_path, 1.2), True)
+    assert world.get_planned_articulation_names() == ["robot", "robot2"]
+    ompl_planner = OMPLPlanner(world=world)
+    folded = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    reaching = np.array([0, 1.0, 0, -1.2, 0, 2.2, 0.8])
+    stretched = np.array([0, 1.3, 0, -0.6, 0, 1.9, 0.8])
+
+    # robot retracts from where robot2 reaches to, so robot2 has to wait for it
+    start = np.concatenate([reaching, folded])
+    goal = np.concatenate([folded, reaching])
+    for state in [start, goal]:
+        world.set_qpos_all(state)
+        assert not world.collide()
+    status, path = ompl_planner.plan_prioritized(start, 0.0, [goal], np.ones(14), 10.0)
+    assert status == "Exact solution"
+    assert path.shape[1] == 15 and np.all(np.diff(path[:, -1]) > 0)
+    assert np.allclose(path[0, :-1], start) and np.allclose(path[-1, :-1], goal)
+    for state in path[:, :-1]:
+        world.set_qpos_all(state)
+        assert not world.collide()
+    # robot2 arrives no earlier than robot
+    robot_arrival = path[np.argmax(np.all(np.isclose(path[:, :7], folded), 1)), -1]
+    robot2_moving = np.any(~np.isclose(path[:, 7:14], reaching), 1)
+    assert path[np.flatnonzero(robot2_moving)[-1] + 1, -1] >= robot_arrival
+
+    # The goals collide, so robot2 fails and the coupled fallback fails too
+    goal = np.concatenate([stretched, reaching])
+    world.set_qpos_all(goal)
+    assert world.collide()
+    status, path = ompl_planner.plan_prioritized(start, 0.0, [goal], np.ones(14), 10.0)
+    assert status != "Exact solution"
+
+
+def test_plan_fixed_joints():
+    planner = Planner(**PANDA_SPEC)
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    # Only the first joint is planned, the goal values of the others are ignored
+    q1 = q0 + [1.0, 0, 0, 0.1, 0, 0, 0]
+    fixed_joints = [False] + [True] * 6
+    status, path = planner.planner.plan(q0, [q1], fixed_joints=fixed_joints)
+    assert status == "Exact solution"
+    assert np.allclose(path[:, 1:], q0[1:])
+    assert np.isclose(path[-1, 0], q1[0])
+
+    # Nothing to plan if all joints are fixed
+    with pytest.raises(RuntimeError):
+        planner.planner.plan(q0, [q1], fixed_joints=[True] * 7)
+
+
+def test_compute_cartesian_path():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    planner.robot.set_qpos(q0)
+    link_id = planner.move_group_link_id
+    start_pose = planner.robot.get_link_poses()[link_id]
+    # Move the hand 10cm up
+    goal_pose = start_pose + [0, 0, 0.1, 0, 0, 0, 0]
+    result = world.compute_cartesian_path("robot", link_id, [goal_pose], 0.01, 5.0)
+    assert np.isclose(result.fraction, 1)
+    assert np.allclose(result.path[0], q0)
+    planner.robot.set_qpos(result.path[-1])
+    hand_pose = planner.robot.get_link_poses()[link_id]
+    assert np.allclose(hand_pose[:3], goal_pose[:3], atol=1e-3)
+
+    # A box at the goal blocks the path
+    planner.robot.set_qpos(q0)
+    world.add_normal_object("box", CollisionObject(Box([0.05] * 3), goal_pose[:3]))
+    result = world.compute_cartesian_path("robot", link_id, [goal_pose], 0.01, 5.0)
+    assert result.fraction < 1
+    # The world is not modified
+    assert np.allclose(planner.robot.get_qpos()[:7], q0)
+
+
+def test_distance_gradient():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    q0 = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8])
+    world.set_qpos_all(q0)
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    sphere_pos = hand_pose[:3] + [0.2, 0, 0]
+    world.add_normal_object("sphere", CollisionObject(Sphere(0.05), sphere_pos))
+
+    def sphere_distance(result):
+        # Distance and gradient of the pair between the hand and the sphere
+        for i, pair in enumerate(result.results):
+            if pair.link_name1 == "panda_hand" and pair.link_name2 == "sphere":
+                return result.distances[i], result.gradients[i]
+
+    result = world.distance_gradient(0)
+    assert result.gradients.shape == (len(result.results), 7)
+    assert np.all(np.diff(result.distances) >= 0)
+    distance, gradient = sphere_distance(result)
+    assert np.linalg.norm(gradient) > 0
+    # Compare with finite differences
+    eps = 1e-4
+    for j in range(7):
+        world.set_qpos_all(q0 + eps * np.eye(7)[j])
+        assert np.isclose(
+            (sphere_distance(world.distance_gradient(0))[0] - distance) / eps,
+            gradient[j],
+            atol=1e-2,
+        )
+
+    # Penetrating sphere, the gradient points out of the collision
+    world.set_qpos_all(q0)
+    sphere = world.get_normal_object("sphere")
+    sphere.set_transformation(np.concatenate([hand_pose[:3] + [0.06, 0, 0], [1, 0, 0, 0]]))
+    request = DistanceRequest(enable_signed_distance=True)
+    distance, gradient = sphere_distance(world.distance_gradient(0, request))
+    assert distance < 0 and np.linalg.norm(gradient) > 0
+    for j in range(7):
+        world.set_qpos_all(q0 + eps * np.eye(7)[j])
+        assert np.isclose(
+            (sphere_distance(world.distance_gradient(0, request))[0] - distance) / eps,
+            gradient[j],
+            atol=1e-2,
+        )
+
+
+def test_distance_within():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    world.set_qpos_all(np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8]))
+    hand_pose = planner.robot.get_link_poses()[planner.move_group_link_id]
+    sphere_pos = hand_pose[:3] + [0.2, 0, 0]
+    world.add_normal_object("sphere", CollisionObject(Sphere(0.05), sphere_pos))
+
+    cutoff = 0.3
+    report = world.distance_within(cutoff)
+    assert len(report) > 0
+    assert np.all(report.distances <= cutoff)
+    assert np.all(np.diff(report.distances) >= 0)
+    apart = report.distances > 0
+    assert np.allclose(np.linalg.norm(report.normals[apart], axis=1), 1)
+    assert np.allclose(
+        report.points1[apart]
+        + report.distances[apart, None] * report.normals[apart],
+        report.points2[apart],
+    )
+    names = [report.names[i] for i in report.link_ids[:, 1]]
+    assert "sphere" in names
+    # Same pairs as the unculled query, also with a single thread
+    all_distances = world.distance_gradient(0).distances
+    assert np.allclose(report.distances, all_distances[all_distances <= cutoff])
+    serial = world.distance_within(cutoff, num_threads=1)
+    assert np.allclose(serial.distances, report.distances)
+    assert len(world.distance_within(cutoff, max_pairs=2)) == min(2, len(report))
+
+
+def test_shared_geometry_store():
+    planner = Planner(**PANDA_SPEC)
+    world = planner.planning_world
+    points = np.random.RandomState(0).uniform(-0.1, 0.1, (100, 3)) + [0.5, 0, 0.3]
+    world.add_point_cloud("cloud", points)
+    geometries = world.get_shareable_geometries()
+    mesh_keys = [key for key, _ in planner.robot.get_fcl_model().get_mesh_geometries()]
+    assert len(mesh_keys) > 0
+
+    name = f"/mplib_test_{os.getpid()}"
+    SharedGeometryStore.unlink(name)
+    store = SharedGeometryStore.create(name, geometries)
+    assert sorted(store.get_keys()) == sorted(key for key, _ in geometries)
+
+    # A worker opens the segment and builds the geometries from it
+    opened = SharedGeometryStore.open(name)
+    assert sorted(opened.get_keys()) == sorted(store.get_keys())
+    assert all(opened.get_geometry(key) is not None for key in mesh_keys)
+    worker = Planner(**PANDA_SPEC)
+    worker.planning_world.add_shared_object("cloud", opened, [0, 0, 0, 1, 0, 0, 0])
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    for p in [planner, worker]:
+        p.robot.set_qpos(qpos, True)
+    assert len(worker.planning_world.collide_full()) == len(world.collide_full())
+
+    # The creator unlinks the segment, mapped stores stay valid
+    del store
+    with pytest.raises(RuntimeError):
+        SharedGeometryStore.open(name)
+    assert opened.get_geometry("cloud") is not None
+
+
+def test_perf_counters():
+    planner = Planner(**PANDA_SPEC)
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    assert not perf_counters.is_enabled()
+    assert "perf_counts" not in planner.plan(pose, qpos)
+
+    perf_counters.set_enabled(True)
+    try:
+        perf_counters.reset()
+        result = planner.plan(pose, qpos)
+        assert result["status"] == "Success"
+        counts = result["perf_counts"]
+        for name in ["narrowphase_self", "state_validity_check", "motion_check"]:
+            assert counts.counts[name] > 0 and counts.nanoseconds[name] > 0
+        assert counts.get_count(perf_counters.PerfCounter.FORWARD_KINEMATICS) > 0
+        # The totals also count IK and the start state check of plan()
+        total = perf_counters.get()
+        checks = perf_counters.PerfCounter.STATE_VALIDITY_CHECK
+        assert total.get_count(checks) >= counts.get_count(checks)
+
+        perf_counters.reset()
+        assert perf_counters.get_thread().get_count(checks) == 0
+    finally:
+        perf_counters.set_enabled(False)
+    before = perf_counters.get()
+    planner.plan(pose, qpos)
+    assert perf_counters.get().counts == before.counts
+
+
+def test_trace(tmp_path):
+    planner = Planner(**PANDA_SPEC)
+    pose = [0.4, 0.3, 0.12, 0, 1, 0, 0]
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    with trace.Span("untraced"):  # no-op when not recording
+        pass
+    if not trace.is_compiled_in():
+        with pytest.raises(RuntimeError):
+            trace.start(str(tmp_path / "trace.json"))
+        return
+
+    filename = tmp_path / "trace.json"
+    trace.start(str(filename))
+    assert trace.is_recording()
+    assert planner.plan(pose, qpos)["status"] == "Success"
+    trace.stop()
+    assert not trace.is_recording()
+    events = json.loads(filename.read_text())["traceEvents"]
+    names = {event["name"] for event in events}
+    assert {"ik", "ik_clik", "plan", "solve", "path_conversion", "topp"} <= names
+    assert "untraced" not in names
+    assert all(event["ph"] == "X" and event["dur"] >= 0 for event in events)
+
+
+def test_collide_report():
+    planner = Planner(**PANDA_SPEC)
+    qpos = np.array([0, 0.2, 0, -2.6, 0, 3.0, 0.8, 0, 0])
+    planner.robot.set_qpos(qpos, True)
+    collisions = planner.planning_world.collide_full()
+    report = planner.planning_world.collide_report()
+    assert len(report) == len(collisions)
+    for i, collision in enumerate(collisions):
+        assert report.names[report.link_ids[i, 0]] == collision.link_name1
+        assert report.names[report.link_ids[i, 1]] == collision.link_name2
+
+
 if __name__ == "__main__":
     test_plan()
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "macros_utils.h"
+#include "planning_protocol.h"
+#include "planning_service.h"
+
+using namespace mplib::server;
+
+namespace {
+
+/// @brief Appends values to a request payload
+struct Payload {
+  std::vector<char> bytes;
+
+  template <typename T>
+  Payload &add(const T &value) {
+    const auto *data = reinterpret_cast<const char *>(&value);
+    bytes.insert(bytes.end(), data, data + sizeof(T));
+    return *this;
+  }
+
+  Payload &addString(const std::string &value) {
+    add(static_cast<uint32_t>(value.size()));
+    bytes.insert(bytes.end(), value.begin(), value.end());
+    return *this;
+  }
+
+  Payload &addArray(const std::vector<double> &values) {
+    add(static_cast<uint32_t>(values.size()));
+    for (auto value : values) add(value);
+    return *this;
+  }
+};
+
+void readAll(int fd, void *data, size_t size) {
+  auto *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    const auto n = read(fd, bytes, size);
+    ASSERT(n > 0, "Failed to read the response");
+    bytes += n, size -= n;
+  }
+}
+
+/// @brief Sends a request over the client end and serves it on the server end
+Status request(WorldContext &context, const int fds[2], uint16_t type,
+               const Payload &payload) {
+  MessageHeader header {kProtocolMagic, 1, type, 0,
+                        static_cast<uint32_t>(payload.bytes.size())};
+  ASSERT(write(fds[0], &header, sizeof(header)) == sizeof(header) &&
+             write(fds[0], payload.bytes.data(), payload.bytes.size()) ==
+                 static_cast<ssize_t>(payload.bytes.size()),
+         "Failed to write the request");
+  ASSERT(serveRequest(context, fds[1]), "The request was not served");
+
+  readAll(fds[0], &header, sizeof(header));
+  std::vector<char> response(header.payload_size);
+  readAll(fds[0], response.data(), response.size());
+  ASSERT(header.magic == kProtocolMagic && header.request_id == 1,
+         "Invalid response header");
+  return static_cast<Status>(header.status);
+}
+
+}  // namespace
+
+int main() {
+  auto robot = std::make_shared<ArticulatedModel>(
+      "../data/panda/panda.urdf", "../data/panda/panda.srdf",
+      mplib::Vector3<S>(0, 0, -9.81), std::vector<std::string>(),
+      std::vector<std::string>(), false, false);
+  robot->setMoveGroup("panda_hand");
+  const auto &link_names = robot->getUserLinkNames();
+  const size_t move_group_link =
+      std::find(link_names.begin(), link_names.end(), "panda_hand") -
+      link_names.begin();
+  const PlanningWorld world({robot}, {"robot"});
+  auto context = createWorldContext(world, "robot", move_group_link);
+
+  int fds[2];
+  ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "Failed to create sockets");
+  const auto info = static_cast<uint16_t>(RequestType::INFO),
+             plan = static_cast<uint16_t>(RequestType::PLAN);
+  ASSERT(request(context, fds, info, Payload()) == Status::OK, "INFO failed");
+
+  const std::vector<double> start {0, 0.2, 0, -2.6, 0, 3.0, 0.8},
+      goal {1.0, 0.2, 0, -2.6, 0, 3.0, 0.8};
+  auto plan_request = [&start](const std::vector<std::vector<double>> &goals) {
+    Payload payload;
+    payload.add(1.0).add(0.0).addString("RRTConnect").addArray(start);
+    payload.add(static_cast<uint32_t>(goals.size()));
+    for (const auto &goal : goals) payload.addArray(goal);
+    return payload;
+  };
+  ASSERT(request(context, fds, plan, plan_request({goal})) == Status::OK,
+         "PLAN failed");
+
+  // Malformed requests are rejected before planning
+  ASSERT(request(context, fds, plan, plan_request({goal, {0, 0, 0}})) ==
+             Status::BAD_REQUEST,
+         "A goal of the wrong size was accepted");
+  Payload many_goals;
+  many_goals.add(1.0).add(0.0).addString("RRTConnect").addArray(start);
+  many_goals.add(UINT32_MAX);
+  ASSERT(request(context, fds, plan, many_goals) == Status::BAD_REQUEST,
+         "A goal count beyond the payload was accepted");
+  ASSERT(request(context, fds, plan, Payload().add(1.0)) == Status::BAD_REQUEST,
+         "A truncated request was accepted");
+  ASSERT(request(context, fds, 100, Payload()) == Status::BAD_REQUEST,
+         "An unknown request type was accepted");
+
+  // The connection is released when the client disconnects
+  close(fds[0]);
+  ASSERT(!serveRequest(context, fds[1]), "A closed connection was served");
+  close(fds[1]);
+}